@@ -4593,62 +4593,53 @@ static inline BYTE blend_color(BYTE dst, BYTE src, DWORD alpha)
     return (src * alpha + dst * (255 - alpha) + 127) / 255;
 }
 
+/* divide the two 16-bit lanes of val by 255, exact for lanes below 255 * 256 */
+static inline DWORD div_255_x2( DWORD val )
+{
+    return ((val + 0x00010001 + ((val >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
 static inline DWORD blend_argb_constant_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    return (blend_color( dst, src, alpha ) |
-            blend_color( dst >> 8, src >> 8, alpha ) << 8 |
-            blend_color( dst >> 16, src >> 16, alpha ) << 16 |
-            blend_color( dst >> 24, src >> 24, alpha ) << 24);
+    DWORD rb = div_255_x2( (src & 0x00ff00ff) * alpha + (dst & 0x00ff00ff) * (255 - alpha) + 0x007f007f );
+    DWORD ag = div_255_x2( ((src >> 8) & 0x00ff00ff) * alpha + ((dst >> 8) & 0x00ff00ff) * (255 - alpha) + 0x007f007f );
+    return rb | ag << 8;
 }
 
 static inline DWORD blend_argb_no_src_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    return (blend_color( dst, src, alpha ) |
-            blend_color( dst >> 8, src >> 8, alpha ) << 8 |
-            blend_color( dst >> 16, src >> 16, alpha ) << 16 |
-            blend_color( dst >> 24, 255, alpha ) << 24);
+    return blend_argb_constant_alpha( dst, src | 0xff000000, alpha );
 }
 
 static inline DWORD blend_argb( DWORD dst, DWORD src )
 {
-    BYTE b = (BYTE)src;
-    BYTE g = (BYTE)(src >> 8);
-    BYTE r = (BYTE)(src >> 16);
-    DWORD alpha  = (BYTE)(src >> 24);
-    return ((b     + ((BYTE)dst         * (255 - alpha) + 127) / 255) |
-            (g     + ((BYTE)(dst >> 8)  * (255 - alpha) + 127) / 255) << 8 |
-            (r     + ((BYTE)(dst >> 16) * (255 - alpha) + 127) / 255) << 16 |
-            (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
+    DWORD alpha = 255 - (src >> 24);
+    DWORD rb = div_255_x2( (dst & 0x00ff00ff) * alpha + 0x007f007f );
+    DWORD ag = div_255_x2( ((dst >> 8) & 0x00ff00ff) * alpha + 0x007f007f );
+    return ((src & 0x00ff00ff) + rb) | (((src >> 8) & 0x00ff00ff) + ag) << 8;
 }
 
 static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    BYTE b = ((BYTE)src         * alpha + 127) / 255;
-    BYTE g = ((BYTE)(src >> 8)  * alpha + 127) / 255;
-    BYTE r = ((BYTE)(src >> 16) * alpha + 127) / 255;
-    alpha  = ((BYTE)(src >> 24) * alpha + 127) / 255;
-    return ((b     + ((BYTE)dst         * (255 - alpha) + 127) / 255) |
-            (g     + ((BYTE)(dst >> 8)  * (255 - alpha) + 127) / 255) << 8 |
-            (r     + ((BYTE)(dst >> 16) * (255 - alpha) + 127) / 255) << 16 |
-            (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
+    DWORD rb = div_255_x2( (src & 0x00ff00ff) * alpha + 0x007f007f );
+    DWORD ag = div_255_x2( ((src >> 8) & 0x00ff00ff) * alpha + 0x007f007f );
+    return blend_argb( dst, rb | ag << 8 );
 }
 
 static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BLENDFUNCTION blend )
 {
+    DWORD dst = dst_r << 16 | dst_g << 8 | dst_b;
+
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
-        DWORD alpha = blend.SourceConstantAlpha;
-        BYTE src_b = ((BYTE)src         * alpha + 127) / 255;
-        BYTE src_g = ((BYTE)(src >> 8)  * alpha + 127) / 255;
-        BYTE src_r = ((BYTE)(src >> 16) * alpha + 127) / 255;
-        alpha      = ((BYTE)(src >> 24) * alpha + 127) / 255;
-        return ((src_b + (dst_b * (255 - alpha) + 127) / 255) |
-                (src_g + (dst_g * (255 - alpha) + 127) / 255) << 8 |
-                (src_r + (dst_r * (255 - alpha) + 127) / 255) << 16);
+        DWORD src_rb = div_255_x2( (src & 0x00ff00ff) * blend.SourceConstantAlpha + 0x007f007f );
+        DWORD src_ag = div_255_x2( ((src >> 8) & 0x00ff00ff) * blend.SourceConstantAlpha + 0x007f007f );
+        DWORD alpha = 255 - (src_ag >> 16);
+        DWORD rb = div_255_x2( (dst & 0x00ff00ff) * alpha + 0x007f007f );
+        DWORD g = (((dst >> 8) & 0xff) * alpha + 127) / 255;
+        return (src_rb + rb) | ((src_ag & 0xff) + g) << 8;
     }
-    return (blend_color( dst_b, src, blend.SourceConstantAlpha ) |
-            blend_color( dst_g, src >> 8, blend.SourceConstantAlpha ) << 8 |
-            blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
+    return blend_argb_constant_alpha( dst, src, blend.SourceConstantAlpha ) & 0x00ffffff;
 }
 
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
@@ -4663,7 +4654,12 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
 		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+		{
+		    /* fully transparent and opaque pixels are the common case */
+		    if (!src_ptr[x]) continue;
+		    if (src_ptr[x] >= 0xff000000) dst_ptr[x] = src_ptr[x];
+		    else dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+		}
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
 		for (x = 0; x < rc->right - rc->left; x++)
@@ -4729,8 +4725,13 @@ static void blend_rect_24(const dib_info *dst, const RECT *rc,
     {
         for (x = 0; x < rc->right - rc->left; x++)
         {
-            DWORD val = blend_rgb( dst_ptr[x * 3 + 2], dst_ptr[x * 3 + 1], dst_ptr[x * 3],
-                                   src_ptr[x], blend );
+            DWORD val;
+
+            /* a transparent pixel leaves the destination unchanged */
+            if (!src_ptr[x] && (blend.AlphaFormat & AC_SRC_ALPHA)) continue;
+
+            val = blend_rgb( dst_ptr[x * 3 + 2], dst_ptr[x * 3 + 1], dst_ptr[x * 3],
+                             src_ptr[x], blend );
             dst_ptr[x * 3]     = val;
             dst_ptr[x * 3 + 1] = val >> 8;
             dst_ptr[x * 3 + 2] = val >> 16;
@@ -5924,6 +5924,94 @@ static void test_D3DKMTCreateDCFromMemory( void )
     }
 }
 
+static void test_blit_performance(void)
+{
+    static const int width = 1024, height = 768, count = 20;
+    static const int depths[] = { 32, 24, 16 };
+    BITMAPINFO info;
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    BLENDFUNCTION blend;
+    DWORD *src_bits, ticks;
+    void *dst_bits;
+    int i, j, k;
+
+    if (!winetest_interactive)
+    {
+        skip("Run in interactive mode to run the blit performance tests.\n");
+        return;
+    }
+
+    hdc_src = CreateCompatibleDC(0);
+    hdc_dst = CreateCompatibleDC(0);
+
+    memset(&info, 0, sizeof(info));
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = width;
+    info.bmiHeader.biHeight = -height;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    bmp_src = CreateDIBSection(hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    ok(bmp_src != NULL, "CreateDIBSection failed\n");
+    /* premultiplied source with transparent, opaque and translucent areas */
+    for (i = 0; i < width * height; i++)
+    {
+        BYTE alpha = (i % width) < width / 3 ? 0 : (i % width) < 2 * width / 3 ? 0xff : i % 256;
+        BYTE color = (i * 7) % 256 * alpha / 255;
+        src_bits[i] = alpha ? (alpha << 24) | (color << 16) | (color << 8) | color : 0;
+    }
+    old_src = SelectObject(hdc_src, bmp_src);
+
+    for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+        info.bmiHeader.biBitCount = depths[i];
+        bmp_dst = CreateDIBSection(hdc_dst, &info, DIB_RGB_COLORS, &dst_bits, NULL, 0);
+        ok(bmp_dst != NULL, "CreateDIBSection failed for %d bpp\n", depths[i]);
+        old_dst = SelectObject(hdc_dst, bmp_dst);
+
+        ticks = GetTickCount();
+        for (j = 0; j < count; j++)
+            BitBlt(hdc_dst, 0, 0, width, height, hdc_src, 0, 0, SRCCOPY);
+        trace("%d bpp BitBlt SRCCOPY: %u ms\n", depths[i], GetTickCount() - ticks);
+
+        ticks = GetTickCount();
+        for (j = 0; j < count; j++)
+            BitBlt(hdc_dst, 0, 0, width, height, hdc_src, 0, 0, SRCINVERT);
+        trace("%d bpp BitBlt SRCINVERT: %u ms\n", depths[i], GetTickCount() - ticks);
+
+        ticks = GetTickCount();
+        for (j = 0; j < count; j++)
+            StretchBlt(hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width / 2, height / 2, SRCCOPY);
+        trace("%d bpp StretchBlt: %u ms\n", depths[i], GetTickCount() - ticks);
+
+        if (pGdiAlphaBlend)
+        {
+            for (k = 0; k < 2; k++)
+            {
+                blend.BlendOp = AC_SRC_OVER;
+                blend.BlendFlags = 0;
+                blend.SourceConstantAlpha = k ? 128 : 255;
+                blend.AlphaFormat = AC_SRC_ALPHA;
+
+                ticks = GetTickCount();
+                for (j = 0; j < count; j++)
+                    pGdiAlphaBlend(hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend);
+                trace("%d bpp AlphaBlend, constant alpha %u: %u ms\n", depths[i],
+                      blend.SourceConstantAlpha, GetTickCount() - ticks);
+            }
+        }
+
+        SelectObject(hdc_dst, old_dst);
+        DeleteObject(bmp_dst);
+    }
+
+    SelectObject(hdc_src, old_src);
+    DeleteObject(bmp_src);
+    DeleteDC(hdc_src);
+    DeleteDC(hdc_dst);
+}
+
 START_TEST(bitmap)
 {
     HMODULE hdll;
@@ -5971,4 +6059,5 @@ START_TEST(bitmap)
     test_SetDIBitsToDevice();
     test_SetDIBitsToDevice_RLE8();
     test_D3DKMTCreateDCFromMemory();
+    test_blit_performance();
 }
@@ -19,6 +19,7 @@
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#include <stdlib.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -367,6 +368,64 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return stat;
 }
 
+/* Blend a row of ARGB data directly into the bits of a 32bpp bitmap,
+ * giving the same results as GdipBitmapGetPixel/GdipBitmapSetPixel. */
+static void alpha_blend_32bpp_row(DWORD *dst, const ARGB *src, INT count,
+    PixelFormat dst_format, PixelFormat src_format)
+{
+    INT x;
+
+    for (x=0; x<count; x++)
+    {
+        ARGB dst_color, src_color = src[x];
+        BYTE a, r, g, b;
+
+        if (!(src_color & 0xff000000))
+            continue;
+
+        if ((src_color & 0xff000000) == 0xff000000)
+        {
+            dst[x] = dst_format == PixelFormat32bppRGB ? src_color & 0xffffff : src_color;
+            continue;
+        }
+
+        dst_color = dst[x];
+        if (dst_format == PixelFormat32bppRGB)
+            dst_color |= 0xff000000;
+        else if (dst_format == PixelFormat32bppPARGB)
+        {
+            a = dst_color >> 24;
+            if (a == 0)
+                dst_color = 0;
+            else
+            {
+                r = ((dst_color >> 16) & 0xff) * 255 / a;
+                g = ((dst_color >> 8) & 0xff) * 255 / a;
+                b = (dst_color & 0xff) * 255 / a;
+                dst_color = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+
+        if (src_format & PixelFormatPAlpha)
+            dst_color = color_over_fgpremult(dst_color, src_color);
+        else
+            dst_color = color_over(dst_color, src_color);
+
+        if (dst_format == PixelFormat32bppRGB)
+            dst_color &= 0xffffff;
+        else if (dst_format == PixelFormat32bppPARGB)
+        {
+            a = dst_color >> 24;
+            r = ((dst_color >> 16) & 0xff) * a / 255;
+            g = ((dst_color >> 8) & 0xff) * a / 255;
+            b = (dst_color & 0xff) * a / 255;
+            dst_color = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+
+        dst[x] = dst_color;
+    }
+}
+
 /* Draw ARGB data to the given graphics object */
 static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
@@ -374,6 +433,22 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
     GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
     INT x, y;
 
+    if (dst_bitmap->format == PixelFormat32bppARGB ||
+        dst_bitmap->format == PixelFormat32bppPARGB ||
+        dst_bitmap->format == PixelFormat32bppRGB)
+    {
+        INT left = max(dst_x, 0), top = max(dst_y, 0);
+        INT right = min(dst_x + src_width, dst_bitmap->width);
+        INT bottom = min(dst_y + src_height, dst_bitmap->height);
+
+        for (y=top; y<bottom; y++)
+            alpha_blend_32bpp_row((DWORD *)(dst_bitmap->bits + dst_bitmap->stride * y) + left,
+                (const ARGB *)(src + src_stride * (y - dst_y)) + (left - dst_x),
+                right - left, dst_bitmap->format, fmt);
+
+        return Ok;
+    }
+
     for (y=0; y<src_height; y++)
     {
         for (x=0; x<src_width; x++)
@@ -536,6 +611,96 @@ static GpStatus alpha_blend_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     return alpha_blend_pixels_hrgn(graphics, dst_x, dst_y, src, src_width, src_height, src_stride, NULL, fmt);
 }
 
+/* Large software fills are split in bands of rows rendered in parallel on the
+ * thread pool, smaller ones are rendered on the calling thread. */
+#define PARALLEL_MIN_PIXELS  (256 * 256)
+#define PARALLEL_BAND_HEIGHT 16
+#define PARALLEL_MAX_THREADS 8
+
+typedef void (*render_rows_func)(void *params, INT start, INT end);
+
+struct parallel_rows
+{
+    render_rows_func func;
+    void *params;
+    INT count;
+    LONG next;
+    LONG workers;
+    HANDLE done;
+};
+
+static void process_rows(struct parallel_rows *rows)
+{
+    INT start;
+
+    while ((start = InterlockedExchangeAdd(&rows->next, PARALLEL_BAND_HEIGHT)) < rows->count)
+        rows->func(rows->params, start, min(start + PARALLEL_BAND_HEIGHT, rows->count));
+}
+
+static void CALLBACK parallel_rows_callback(TP_CALLBACK_INSTANCE *instance, void *context)
+{
+    struct parallel_rows *rows = context;
+
+    process_rows(rows);
+
+    if (!InterlockedDecrement(&rows->workers))
+        SetEvent(rows->done);
+}
+
+static UINT get_render_thread_count(void)
+{
+    static UINT count;
+
+    if (!count)
+    {
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+        count = min(max(info.dwNumberOfProcessors, 1), PARALLEL_MAX_THREADS);
+    }
+
+    return count;
+}
+
+/* Call func for the rows in [0, count), using the thread pool for large areas. */
+static void render_rows(render_rows_func func, void *params, INT width, INT count)
+{
+    struct parallel_rows rows;
+    UINT i, threads = get_render_thread_count();
+
+    rows.func = func;
+    rows.params = params;
+    rows.count = count;
+    rows.next = 0;
+    rows.workers = 1;
+    rows.done = NULL;
+
+    threads = min(threads, (count + PARALLEL_BAND_HEIGHT - 1) / PARALLEL_BAND_HEIGHT);
+
+    if (threads > 1 && (LONGLONG)width * count >= PARALLEL_MIN_PIXELS &&
+        (rows.done = CreateEventW(NULL, TRUE, FALSE, NULL)))
+    {
+        for (i=1; i<threads; i++)
+        {
+            InterlockedIncrement(&rows.workers);
+            if (!TrySubmitThreadpoolCallback(parallel_rows_callback, &rows, NULL))
+            {
+                InterlockedDecrement(&rows.workers);
+                break;
+            }
+        }
+    }
+
+    process_rows(&rows);
+
+    if (rows.done)
+    {
+        if (InterlockedDecrement(&rows.workers))
+            WaitForSingleObject(rows.done, INFINITE);
+        CloseHandle(rows.done);
+    }
+}
+
 static ARGB blend_colors(ARGB start, ARGB end, REAL position)
 {
     INT start_a, end_a, final_a;
@@ -1113,6 +1278,75 @@ static BOOL brush_can_fill_pixels(GpBrush *brush)
     }
 }
 
+struct linear_gradient_rows
+{
+    GpLineGradient *brush;
+    DWORD *pixels;
+    UINT stride;
+    INT width;
+    REAL start, x_delta, y_delta;
+};
+
+static void fill_linear_gradient_rows(void *params, INT start, INT end)
+{
+    struct linear_gradient_rows *rows = params;
+    INT x, y;
+
+    for (y=start; y<end; y++)
+    {
+        DWORD *row = rows->pixels + y * rows->stride;
+
+        if (rows->x_delta == 0.0)
+        {
+            ARGB color = blend_line_gradient(rows->brush, rows->start + y * rows->y_delta);
+
+            for (x=0; x<rows->width; x++)
+                row[x] = color;
+        }
+        else
+        {
+            for (x=0; x<rows->width; x++)
+                row[x] = blend_line_gradient(rows->brush, rows->start + x * rows->x_delta + y * rows->y_delta);
+        }
+    }
+}
+
+struct texture_rows
+{
+    GpTexture *brush;
+    GpBitmap *bitmap;
+    GpRect src_area;
+    InterpolationMode interpolation;
+    PixelOffsetMode offset_mode;
+    DWORD *pixels;
+    UINT stride;
+    INT width;
+    GpPointF start;
+    REAL x_dx, x_dy, y_dx, y_dy;
+};
+
+static void fill_texture_rows(void *params, INT start, INT end)
+{
+    struct texture_rows *rows = params;
+    INT x, y;
+
+    for (y=start; y<end; y++)
+    {
+        DWORD *row = rows->pixels + y * rows->stride;
+
+        for (x=0; x<rows->width; x++)
+        {
+            GpPointF point;
+            point.X = rows->start.X + x * rows->x_dx + y * rows->y_dx;
+            point.Y = rows->start.Y + x * rows->x_dy + y * rows->y_dy;
+
+            row[x] = resample_bitmap_pixel(&rows->src_area, rows->brush->bitmap_bits,
+                rows->bitmap->width, rows->bitmap->height, &point, rows->brush->imageattributes,
+                rows->interpolation, rows->offset_mode);
+        }
+    }
+}
+
 static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     DWORD *argb_pixels, GpRect *fill_area, UINT cdwStride)
 {
@@ -1122,9 +1356,12 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     {
         int x, y;
         GpSolidFill *fill = (GpSolidFill*)brush;
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-                argb_pixels[x + y*cdwStride] = fill->color;
+        for (y=0; y<fill_area->Height; y++)
+        {
+            DWORD *row = argb_pixels + y*cdwStride;
+            for (x=0; x<fill_area->Width; x++)
+                row[x] = fill->color;
+        }
         return Ok;
     }
     case BrushTypeHatchFill:
@@ -1136,29 +1373,34 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         if (get_hatch_data(fill->hatchstyle, &hatch_data) != Ok)
             return NotImplemented;
 
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-            {
-                int hx, hy;
+        for (y=0; y<fill_area->Height; y++)
+        {
+            DWORD *row = argb_pixels + y*cdwStride;
+            int hy;
 
-                /* FIXME: Account for the rendering origin */
-                hx = (x + fill_area->X) % 8;
-                hy = (y + fill_area->Y) % 8;
+            /* FIXME: Account for the rendering origin */
+            hy = (y + fill_area->Y) % 8;
+
+            for (x=0; x<fill_area->Width; x++)
+            {
+                int hx = (x + fill_area->X) % 8;
 
                 if ((hatch_data[7-hy] & (0x80 >> hx)) != 0)
-                    argb_pixels[x + y*cdwStride] = fill->forecol;
+                    row[x] = fill->forecol;
                 else
-                    argb_pixels[x + y*cdwStride] = fill->backcol;
+                    row[x] = fill->backcol;
             }
+        }
 
         return Ok;
     }
     case BrushTypeLinearGradient:
     {
         GpLineGradient *fill = (GpLineGradient*)brush;
+        struct linear_gradient_rows rows;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
+        int y;
 
         draw_points[0].X = fill_area->X;
         draw_points[0].Y = fill_area->Y;
@@ -1184,18 +1426,23 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
         if (stat == Ok)
         {
-            REAL x_delta = draw_points[1].X - draw_points[0].X;
-            REAL y_delta = draw_points[2].X - draw_points[0].X;
-
-            for (y=0; y<fill_area->Height; y++)
+            rows.brush = fill;
+            rows.pixels = argb_pixels;
+            rows.stride = cdwStride;
+            rows.width = fill_area->Width;
+            rows.start = draw_points[0].X;
+            rows.x_delta = draw_points[1].X - draw_points[0].X;
+            rows.y_delta = draw_points[2].X - draw_points[0].X;
+
+            if (rows.y_delta == 0.0 && fill_area->Height)
             {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    REAL pos = draw_points[0].X + x * x_delta + y * y_delta;
-
-                    argb_pixels[x + y*cdwStride] = blend_line_gradient(fill, pos);
-                }
+                /* all the rows are identical */
+                fill_linear_gradient_rows(&rows, 0, 1);
+                for (y=1; y<fill_area->Height; y++)
+                    memcpy(argb_pixels + y*cdwStride, argb_pixels, fill_area->Width * sizeof(DWORD));
             }
+            else
+                render_rows(fill_linear_gradient_rows, &rows, fill_area->Width, fill_area->Height);
         }
 
         return stat;
@@ -1203,9 +1450,9 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     case BrushTypeTextureFill:
     {
         GpTexture *fill = (GpTexture*)brush;
+        struct texture_rows rows;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
         GpBitmap *bitmap;
         int src_stride;
         GpRect src_area;
@@ -1280,25 +1527,21 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
         if (stat == Ok)
         {
-            REAL x_dx = draw_points[1].X - draw_points[0].X;
-            REAL x_dy = draw_points[1].Y - draw_points[0].Y;
-            REAL y_dx = draw_points[2].X - draw_points[0].X;
-            REAL y_dy = draw_points[2].Y - draw_points[0].Y;
-
-            for (y=0; y<fill_area->Height; y++)
-            {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    GpPointF point;
-                    point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + y * x_dy + y * y_dy;
-
-                    argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
-                        &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
-                        &point, fill->imageattributes, graphics->interpolation,
-                        graphics->pixeloffset);
-                }
-            }
+            rows.brush = fill;
+            rows.bitmap = bitmap;
+            rows.src_area = src_area;
+            rows.interpolation = graphics->interpolation;
+            rows.offset_mode = graphics->pixeloffset;
+            rows.pixels = argb_pixels;
+            rows.stride = cdwStride;
+            rows.width = fill_area->Width;
+            rows.start = draw_points[0];
+            rows.x_dx = draw_points[1].X - draw_points[0].X;
+            rows.x_dy = draw_points[1].Y - draw_points[0].Y;
+            rows.y_dx = draw_points[2].X - draw_points[0].X;
+            rows.y_dy = draw_points[2].Y - draw_points[0].Y;
+
+            render_rows(fill_texture_rows, &rows, fill_area->Width, fill_area->Height);
         }
 
         return stat;
@@ -2923,6 +3166,49 @@ GpStatus WINGDIPAPI GdipDrawImagePointsI(GpGraphics *graphics, GpImage *image,
     return GdipDrawImagePoints(graphics, image, ptf, count);
 }
 
+struct resample_rows
+{
+    const GpRect *src_area;
+    LPBYTE src_data;
+    UINT width, height;
+    REAL srcx, srcy, srcwidth, srcheight;
+    GDIPCONST GpImageAttributes *attributes;
+    InterpolationMode interpolation;
+    PixelOffsetMode offset_mode;
+    const RECT *dst_area;
+    LPBYTE dst_data;
+    INT dst_stride;
+    GpPointF start;
+    REAL x_dx, x_dy, y_dx, y_dy;
+};
+
+static void resample_rows(void *params, INT start, INT end)
+{
+    struct resample_rows *rows = params;
+    INT x, y;
+
+    for (y=rows->dst_area->top + start; y<rows->dst_area->top + end; y++)
+    {
+        ARGB *dst_color = (ARGB*)(rows->dst_data + rows->dst_stride * (y - rows->dst_area->top));
+
+        for (x=rows->dst_area->left; x<rows->dst_area->right; x++, dst_color++)
+        {
+            GpPointF src_pointf;
+
+            src_pointf.X = rows->start.X + x * rows->x_dx + y * rows->y_dx;
+            src_pointf.Y = rows->start.Y + x * rows->x_dy + y * rows->y_dy;
+
+            if (src_pointf.X >= rows->srcx && src_pointf.X < rows->srcx + rows->srcwidth &&
+                src_pointf.Y >= rows->srcy && src_pointf.Y < rows->srcy + rows->srcheight)
+                *dst_color = resample_bitmap_pixel(rows->src_area, rows->src_data, rows->width, rows->height,
+                                                   &src_pointf, rows->attributes, rows->interpolation,
+                                                   rows->offset_mode);
+            else
+                *dst_color = 0;
+        }
+    }
+}
+
 static BOOL CALLBACK play_metafile_proc(EmfPlusRecordType record_type, unsigned int flags,
     unsigned int dataSize, const unsigned char *pStr, void *userdata)
 {
@@ -3027,7 +3313,7 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             RECT dst_area;
             GpRectF graphics_bounds;
             GpRect src_area;
-            int i, x, y, src_stride, dst_stride;
+            int i, src_stride, dst_stride;
             GpMatrix dst_to_src;
             REAL m11, m12, m21, m22, mdx, mdy;
             LPBYTE src_data, dst_data, dst_dyn_data=NULL;
@@ -3035,7 +3321,6 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             InterpolationMode interpolation = graphics->interpolation;
             PixelOffsetMode offset_mode = graphics->pixeloffset;
             GpPointF dst_to_src_points[3] = {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}};
-            REAL x_dx, x_dy, y_dx, y_dy;
             static const GpImageAttributes defaultImageAttributes = {WrapModeClamp, 0, FALSE};
 
             if (!imageAttributes)
@@ -3124,6 +3409,8 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
 
             if (do_resampling)
             {
+                struct resample_rows rows;
+
                 /* Transform the bits as needed to the destination. */
                 dst_data = dst_dyn_data = heap_alloc_zero(sizeof(ARGB) * (dst_area.right - dst_area.left) * (dst_area.bottom - dst_area.top));
                 if (!dst_data)
@@ -3136,30 +3423,28 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
 
                 GdipTransformMatrixPoints(&dst_to_src, dst_to_src_points, 3);
 
-                x_dx = dst_to_src_points[1].X - dst_to_src_points[0].X;
-                x_dy = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
-                y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
-                y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
-
-                for (x=dst_area.left; x<dst_area.right; x++)
-                {
-                    for (y=dst_area.top; y<dst_area.bottom; y++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
-                        src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
-
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
-
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                            *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                               imageAttributes, interpolation, offset_mode);
-                        else
-                            *dst_color = 0;
-                    }
-                }
+                rows.src_area = &src_area;
+                rows.src_data = src_data;
+                rows.width = bitmap->width;
+                rows.height = bitmap->height;
+                rows.srcx = srcx;
+                rows.srcy = srcy;
+                rows.srcwidth = srcwidth;
+                rows.srcheight = srcheight;
+                rows.attributes = imageAttributes;
+                rows.interpolation = interpolation;
+                rows.offset_mode = offset_mode;
+                rows.dst_area = &dst_area;
+                rows.dst_data = dst_data;
+                rows.dst_stride = dst_stride;
+                rows.start = dst_to_src_points[0];
+                rows.x_dx = dst_to_src_points[1].X - dst_to_src_points[0].X;
+                rows.x_dy = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
+                rows.y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
+                rows.y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
+
+                render_rows(resample_rows, &rows, dst_area.right - dst_area.left,
+                            dst_area.bottom - dst_area.top);
             }
             else
             {
@@ -4206,6 +4491,324 @@ end:
     return retval;
 }
 
+/* Antialiased fills compute the coverage of every pixel by intersecting the
+ * path with several sub-scanlines per row, the horizontal coverage of each
+ * span being exact. */
+#define AA_SUBSAMPLES 4
+
+struct aa_edge
+{
+    REAL x0, y0, y1;
+    REAL dxdy;
+    INT dir;
+};
+
+struct aa_crossing
+{
+    REAL x;
+    INT dir;
+};
+
+static int compare_aa_edges(const void *a, const void *b)
+{
+    const struct aa_edge *edge1 = a, *edge2 = b;
+
+    if (edge1->y0 < edge2->y0) return -1;
+    return edge1->y0 > edge2->y0;
+}
+
+static void add_aa_edge(struct aa_edge *edges, INT *count, const GpPointF *p1, const GpPointF *p2)
+{
+    struct aa_edge *edge = &edges[*count];
+
+    if (p1->Y == p2->Y)
+        return;
+
+    if (p1->Y < p2->Y)
+    {
+        edge->x0 = p1->X;
+        edge->y0 = p1->Y;
+        edge->y1 = p2->Y;
+        edge->dir = 1;
+    }
+    else
+    {
+        edge->x0 = p2->X;
+        edge->y0 = p2->Y;
+        edge->y1 = p1->Y;
+        edge->dir = -1;
+    }
+    edge->dxdy = (p2->X - p1->X) / (p2->Y - p1->Y);
+    (*count)++;
+}
+
+/* Add the coverage of the span [xa, xb) on one sub-scanline. Full pixels are
+ * accumulated as differences in cover, partial ones directly in partial. */
+static void add_aa_span(INT *cover, INT *partial, INT width, REAL xa, REAL xb)
+{
+    INT ia, ib;
+
+    if (xa < 0.0) xa = 0.0;
+    if (xb > width) xb = width;
+    if (xa >= xb) return;
+
+    ia = (INT)xa;
+    ib = (INT)xb;
+
+    if (ia == ib)
+    {
+        partial[ia] += gdip_round((xb - xa) * 255.0);
+        return;
+    }
+
+    partial[ia] += gdip_round((ia + 1 - xa) * 255.0);
+    cover[ia + 1] += 255;
+    cover[ib] -= 255;
+    if (ib < width)
+        partial[ib] += gdip_round((xb - ib) * 255.0);
+}
+
+/* Compute the 0-255 coverage of the pixels of area by a flattened path in device coordinates. */
+static GpStatus get_path_coverage(const GpPath *path, const GpRect *area, BYTE *mask)
+{
+    const GpPointF *points = path->pathdata.Points;
+    const BYTE *types = path->pathdata.Types;
+    struct aa_edge *edges, **active;
+    struct aa_crossing *crossings;
+    INT *cover, *partial;
+    INT i, j, x, y, s, figure_start = 0, edge_count = 0, active_count = 0, next_edge = 0;
+
+    edges = heap_alloc(path->pathdata.Count * sizeof(*edges));
+    active = heap_alloc(path->pathdata.Count * sizeof(*active));
+    crossings = heap_alloc(path->pathdata.Count * sizeof(*crossings));
+    cover = heap_alloc_zero(2 * (area->Width + 1) * sizeof(*cover));
+    if (!edges || !active || !crossings || !cover)
+    {
+        heap_free(edges);
+        heap_free(active);
+        heap_free(crossings);
+        heap_free(cover);
+        return OutOfMemory;
+    }
+    partial = cover + area->Width + 1;
+
+    /* build the edge list in area coordinates, closing all the figures */
+    for (i=0; i<path->pathdata.Count; i++)
+    {
+        GpPointF p1, p2;
+
+        if ((types[i] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            figure_start = i;
+        else
+        {
+            p1.X = points[i-1].X - area->X;
+            p1.Y = points[i-1].Y - area->Y;
+            p2.X = points[i].X - area->X;
+            p2.Y = points[i].Y - area->Y;
+            add_aa_edge(edges, &edge_count, &p1, &p2);
+        }
+
+        if (i == path->pathdata.Count - 1 ||
+            (types[i+1] & PathPointTypePathTypeMask) == PathPointTypeStart)
+        {
+            p1.X = points[i].X - area->X;
+            p1.Y = points[i].Y - area->Y;
+            p2.X = points[figure_start].X - area->X;
+            p2.Y = points[figure_start].Y - area->Y;
+            add_aa_edge(edges, &edge_count, &p1, &p2);
+        }
+    }
+
+    qsort(edges, edge_count, sizeof(*edges), compare_aa_edges);
+
+    for (y=0; y<area->Height; y++)
+    {
+        BYTE *row = mask + y * area->Width;
+        INT sum = 0;
+
+        for (s=0; s<AA_SUBSAMPLES; s++)
+        {
+            REAL sy = y + (s + 0.5) / AA_SUBSAMPLES;
+            INT winding = 0, crossing_count = 0;
+
+            while (next_edge < edge_count && edges[next_edge].y0 <= sy)
+                active[active_count++] = &edges[next_edge++];
+
+            for (i=0, j=0; i<active_count; i++)
+            {
+                struct aa_edge *edge = active[i];
+                struct aa_crossing crossing;
+                INT k;
+
+                if (edge->y1 <= sy) continue;
+                active[j++] = edge;
+
+                crossing.x = edge->x0 + (sy - edge->y0) * edge->dxdy;
+                crossing.dir = edge->dir;
+
+                /* the crossings stay almost sorted from one sub-scanline to the next */
+                for (k=crossing_count; k>0 && crossings[k-1].x > crossing.x; k--)
+                    crossings[k] = crossings[k-1];
+                crossings[k] = crossing;
+                crossing_count++;
+            }
+            active_count = j;
+
+            for (i=0; i<crossing_count-1; i++)
+            {
+                winding += crossings[i].dir;
+
+                if (path->fill == FillModeWinding ? winding != 0 : (winding & 1))
+                    add_aa_span(cover, partial, area->Width, crossings[i].x, crossings[i+1].x);
+            }
+        }
+
+        for (x=0; x<area->Width; x++)
+        {
+            INT value;
+
+            sum += cover[x];
+            value = (sum + partial[x] + AA_SUBSAMPLES / 2) / AA_SUBSAMPLES;
+            row[x] = max(0, min(value, 255));
+        }
+
+        memset(cover, 0, 2 * (area->Width + 1) * sizeof(*cover));
+    }
+
+    heap_free(edges);
+    heap_free(active);
+    heap_free(crossings);
+    heap_free(cover);
+
+    return Ok;
+}
+
+static GpStatus SOFTWARE_GdipFillPathAntialias(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF graphics_bounds;
+    GpRect area;
+    REAL min_x, min_y, max_x, max_y;
+    DWORD *pixel_data;
+    BYTE *mask;
+    INT i, count;
+
+    stat = gdi_transform_acquire(graphics);
+
+    if (stat == Ok)
+        stat = get_graphics_device_bounds(graphics, &graphics_bounds);
+
+    if (stat == Ok)
+        stat = get_graphics_transform(graphics, WineCoordinateSpaceGdiDevice,
+            CoordinateSpaceWorld, &world_to_device);
+
+    if (stat == Ok)
+    {
+        stat = GdipClonePath(path, &flat_path);
+
+        if (stat == Ok)
+        {
+            stat = GdipTransformPath(flat_path, &world_to_device);
+
+            if (stat == Ok)
+                stat = GdipFlattenPath(flat_path, NULL, 0.25);
+
+            if (stat != Ok)
+                GdipDeletePath(flat_path);
+        }
+    }
+
+    if (stat != Ok)
+    {
+        gdi_transform_release(graphics);
+        return stat;
+    }
+
+    if (!flat_path->pathdata.Count)
+    {
+        GdipDeletePath(flat_path);
+        gdi_transform_release(graphics);
+        return Ok;
+    }
+
+    min_x = max_x = flat_path->pathdata.Points[0].X;
+    min_y = max_y = flat_path->pathdata.Points[0].Y;
+    for (i=1; i<flat_path->pathdata.Count; i++)
+    {
+        min_x = min(min_x, flat_path->pathdata.Points[i].X);
+        min_y = min(min_y, flat_path->pathdata.Points[i].Y);
+        max_x = max(max_x, flat_path->pathdata.Points[i].X);
+        max_y = max(max_y, flat_path->pathdata.Points[i].Y);
+    }
+
+    min_x = max(min_x, floorf(graphics_bounds.X));
+    min_y = max(min_y, floorf(graphics_bounds.Y));
+    max_x = min(max_x, ceilf(graphics_bounds.X + graphics_bounds.Width));
+    max_y = min(max_y, ceilf(graphics_bounds.Y + graphics_bounds.Height));
+
+    if (min_x >= max_x || min_y >= max_y)
+    {
+        GdipDeletePath(flat_path);
+        gdi_transform_release(graphics);
+        return Ok;
+    }
+
+    area.X = floorf(min_x);
+    area.Y = floorf(min_y);
+    area.Width = ceilf(max_x) - area.X;
+    area.Height = ceilf(max_y) - area.Y;
+    count = area.Width * area.Height;
+
+    pixel_data = heap_alloc(count * sizeof(*pixel_data));
+    mask = heap_alloc(count);
+
+    if (!pixel_data || !mask)
+        stat = OutOfMemory;
+
+    if (stat == Ok)
+        stat = get_path_coverage(flat_path, &area, mask);
+
+    if (stat == Ok)
+    {
+        if (brush->bt == BrushTypeSolidColor)
+        {
+            ARGB color = ((GpSolidFill*)brush)->color;
+
+            for (i=0; i<count; i++)
+                pixel_data[i] = color;
+        }
+        else
+            stat = brush_fill_pixels(graphics, brush, pixel_data, &area, area.Width);
+    }
+
+    if (stat == Ok)
+    {
+        /* scale the alpha of the brush by the coverage */
+        for (i=0; i<count; i++)
+        {
+            UINT alpha;
+
+            if (mask[i] == 255) continue;
+
+            alpha = (pixel_data[i] >> 24) * mask[i];
+            alpha = (alpha + 1 + (alpha >> 8)) >> 8;
+            pixel_data[i] = alpha ? (pixel_data[i] & 0xffffff) | (alpha << 24) : 0;
+        }
+
+        stat = alpha_blend_pixels(graphics, area.X, area.Y, (BYTE *)pixel_data,
+            area.Width, area.Height, area.Width * 4, PixelFormat32bppARGB);
+    }
+
+    heap_free(pixel_data);
+    heap_free(mask);
+    GdipDeletePath(flat_path);
+    gdi_transform_release(graphics);
+
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -4214,7 +4817,9 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
-    /* FIXME: This could probably be done more efficiently without regions. */
+    if (graphics->smoothing == SmoothingModeAntiAlias ||
+        graphics->smoothing == SmoothingModeHighQuality)
+        return SOFTWARE_GdipFillPathAntialias(graphics, brush, path);
 
     stat = GdipCreateRegionPath(path, &rgn);
 
@@ -6733,6 +6733,197 @@ static void test_hdc_caching(void)
     DeleteObject(hbm);
 }
 
+static void test_antialiased_fill(void)
+{
+    GpStatus status;
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    GpSolidFill *brush;
+    ARGB color;
+
+    status = GdipCreateBitmapFromScan0(40, 30, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)bitmap, &graphics);
+    expect(Ok, status);
+    status = GdipCreateSolidFill(0xff0000ff, &brush);
+    expect(Ok, status);
+
+    status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, status);
+    status = GdipFillRectangle(graphics, (GpBrush *)brush, 10.5, 10.0, 20.0, 10.0);
+    expect(Ok, status);
+
+    status = GdipBitmapGetPixel(bitmap, 20, 15, &color);
+    expect(Ok, status);
+    ok(color == 0xff0000ff, "Expected 0xff0000ff, got %#x\n", color);
+
+    status = GdipBitmapGetPixel(bitmap, 5, 15, &color);
+    expect(Ok, status);
+    ok(color == 0, "Expected 0, got %#x\n", color);
+
+    status = GdipBitmapGetPixel(bitmap, 20, 25, &color);
+    expect(Ok, status);
+    ok(color == 0, "Expected 0, got %#x\n", color);
+
+    /* the left and right columns are half covered */
+    status = GdipBitmapGetPixel(bitmap, 10, 15, &color);
+    expect(Ok, status);
+    ok((color & 0xffffff) == 0xff && (color >> 24) >= 0x60 && (color >> 24) <= 0xa0,
+       "Expected partially transparent blue, got %#x\n", color);
+
+    status = GdipBitmapGetPixel(bitmap, 30, 15, &color);
+    expect(Ok, status);
+    ok((color & 0xffffff) == 0xff && (color >> 24) >= 0x60 && (color >> 24) <= 0xa0,
+       "Expected partially transparent blue, got %#x\n", color);
+
+    GdipDeleteBrush((GpBrush *)brush);
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage *)bitmap);
+}
+
+static void test_rotated_texture(void)
+{
+    GpStatus status;
+    GpBitmap *bitmap, *texture_bitmap;
+    GpGraphics *graphics;
+    GpTexture *texture;
+    ARGB color1, color2, color3;
+    UINT x, y;
+
+    status = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)bitmap, &graphics);
+    expect(Ok, status);
+    status = GdipSetInterpolationMode(graphics, InterpolationModeNearestNeighbor);
+    expect(Ok, status);
+
+    /* horizontal stripes, which become vertical once rotated */
+    status = GdipCreateBitmapFromScan0(8, 8, 0, PixelFormat32bppARGB, NULL, &texture_bitmap);
+    expect(Ok, status);
+    for (y = 0; y < 8; y++)
+        for (x = 0; x < 8; x++)
+            GdipBitmapSetPixel(texture_bitmap, x, y, y < 4 ? 0xffff0000 : 0xff0000ff);
+    status = GdipCreateTexture((GpImage *)texture_bitmap, WrapModeTile, &texture);
+    expect(Ok, status);
+    status = GdipRotateTextureTransform(texture, 90.0, MatrixOrderAppend);
+    expect(Ok, status);
+
+    status = GdipFillRectangleI(graphics, (GpBrush *)texture, 0, 0, 16, 16);
+    expect(Ok, status);
+
+    status = GdipBitmapGetPixel(bitmap, 2, 2, &color1);
+    expect(Ok, status);
+    status = GdipBitmapGetPixel(bitmap, 6, 2, &color2);
+    expect(Ok, status);
+    status = GdipBitmapGetPixel(bitmap, 2, 6, &color3);
+    expect(Ok, status);
+    ok(color1 == 0xffff0000 || color1 == 0xff0000ff, "got %08x\n", color1);
+    ok(color2 == 0xffff0000 || color2 == 0xff0000ff, "got %08x\n", color2);
+    ok(color1 != color2, "expected different colors, got %08x\n", color1);
+    ok(color1 == color3, "expected %08x, got %08x\n", color1, color3);
+
+    GdipDeleteBrush((GpBrush *)texture);
+    GdipDisposeImage((GpImage *)texture_bitmap);
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage *)bitmap);
+}
+
+static void test_rendering_performance(void)
+{
+    static const UINT width = 1024, height = 768;
+    GpStatus status;
+    GpBitmap *bitmap, *texture_bitmap;
+    GpGraphics *graphics;
+    GpSolidFill *solid;
+    GpLineGradient *gradient;
+    GpTexture *texture;
+    GpPen *pen;
+    GpPointF start = {0.0, 0.0}, end = {300.0, 200.0};
+    DWORD ticks;
+    UINT i, x, y;
+
+    if (!winetest_interactive)
+    {
+        skip("Run in interactive mode to run the rendering performance tests.\n");
+        return;
+    }
+
+    status = GdipCreateBitmapFromScan0(width, height, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateBitmapFromScan0(64, 64, 0, PixelFormat32bppARGB, NULL, &texture_bitmap);
+    expect(Ok, status);
+    for (y = 0; y < 64; y++)
+        for (x = 0; x < 64; x++)
+            GdipBitmapSetPixel(texture_bitmap, x, y, ((x ^ y) & 8) ? 0xff204080 : 0x80ffc000);
+
+    status = GdipCreateSolidFill(0xc0208040, &solid);
+    expect(Ok, status);
+    status = GdipCreateLineBrush(&start, &end, 0xff0000ff, 0x80ff0000, WrapModeTile, &gradient);
+    expect(Ok, status);
+    status = GdipCreateTexture((GpImage *)texture_bitmap, WrapModeTile, &texture);
+    expect(Ok, status);
+    status = GdipCreatePen1(0xff000000, 3.0, UnitPixel, &pen);
+    expect(Ok, status);
+
+    status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, status);
+
+    ticks = GetTickCount();
+    for (i = 0; i < 200; i++)
+    {
+        status = GdipFillEllipse(graphics, (GpBrush *)solid, (i * 37) % width, (i * 53) % height, 120.0, 80.0);
+        expect(Ok, status);
+    }
+    trace("solid ellipses: %u ms\n", GetTickCount() - ticks);
+
+    ticks = GetTickCount();
+    for (i = 0; i < 10; i++)
+    {
+        status = GdipFillRectangle(graphics, (GpBrush *)gradient, 0.0, 0.0, width, height);
+        expect(Ok, status);
+    }
+    trace("linear gradient fills: %u ms\n", GetTickCount() - ticks);
+
+    ticks = GetTickCount();
+    for (i = 0; i < 10; i++)
+    {
+        status = GdipFillRectangle(graphics, (GpBrush *)texture, 0.0, 0.0, width, height);
+        expect(Ok, status);
+    }
+    trace("texture fills: %u ms\n", GetTickCount() - ticks);
+
+    ticks = GetTickCount();
+    for (i = 0; i < 200; i++)
+    {
+        status = GdipDrawLine(graphics, pen, (i * 37) % width, 0.0, width - (i * 53) % width, height);
+        expect(Ok, status);
+    }
+    trace("wide lines: %u ms\n", GetTickCount() - ticks);
+
+    status = GdipSetInterpolationMode(graphics, InterpolationModeBilinear);
+    expect(Ok, status);
+
+    ticks = GetTickCount();
+    for (i = 0; i < 4; i++)
+    {
+        status = GdipDrawImageRectRect(graphics, (GpImage *)texture_bitmap, 0.0, 0.0, width, height,
+                                       0.0, 0.0, 64.0, 64.0, UnitPixel, NULL, NULL, NULL);
+        expect(Ok, status);
+    }
+    trace("scaled images: %u ms\n", GetTickCount() - ticks);
+
+    GdipDeletePen(pen);
+    GdipDeleteBrush((GpBrush *)texture);
+    GdipDeleteBrush((GpBrush *)gradient);
+    GdipDeleteBrush((GpBrush *)solid);
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage *)texture_bitmap);
+    GdipDisposeImage((GpImage *)bitmap);
+}
+
 START_TEST(graphics)
 {
     struct GdiplusStartupInput gdiplusStartupInput;
@@ -6824,6 +7015,9 @@ START_TEST(graphics)
     test_container_rects();
     test_GdipGraphicsSetAbort();
     test_cliphrgn_transform();
+    test_antialiased_fill();
+    test_rotated_texture();
+    test_rendering_performance();
     test_hdc_caching();
 
     GdiplusShutdown(gdiplusToken);
@@ -482,12 +482,7 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
         if(FAILED(hres))
             return hres;
 
-        /* FIXME: Potential optimization */
-        hres = push_instr_str(ctx, OP_str, member_expr->identifier);
-        if(FAILED(hres))
-            return hres;
-
-        hres = push_instr_uint(ctx, OP_memberid, flags);
+        hres = push_instr_bstr_uint(ctx, OP_member_ref, member_expr->identifier, flags);
         break;
     }
     DEFAULT_UNREACHABLE;
@@ -2239,6 +2234,7 @@ void release_bytecode(bytecode_t *code)
     heap_pool_free(&code->heap);
     heap_free(code->bstr_pool);
     heap_free(code->str_pool);
+    heap_free(code->prop_cache);
     heap_free(code->instrs);
     heap_free(code);
 }
@@ -2497,6 +2493,12 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args,
         return hres;
     }
 
+    compiler.code->prop_cache = heap_alloc_zero(compiler.code_off * sizeof(*compiler.code->prop_cache));
+    if(!compiler.code->prop_cache) {
+        release_bytecode(compiler.code);
+        return E_OUTOFMEMORY;
+    }
+
     *ret = compiler.code;
     return S_OK;
 }
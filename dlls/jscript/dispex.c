@@ -28,6 +28,11 @@ WINE_DEFAULT_DEBUG_CHANNEL(jscript);
 #define FDEX_VERSION_MASK 0xf0000000
 #define GOLDEN_RATIO 0x9E3779B9U
 
+/* objects with more properties get a unique shape id instead of a shared shape */
+#define SHAPE_MAX_PROPS 64
+/* same for properties added to a shape that already has that many transitions */
+#define SHAPE_MAX_CHILDREN 32
+
 typedef enum {
     PROP_JSVAL,
     PROP_BUILTIN,
@@ -53,6 +58,93 @@ struct _dispex_prop_t {
     int bucket_next;
 };
 
+/*
+ * Objects which got the same property names added in the same order share a shape,
+ * so a shape id tells where each property lives in the props array. Shapes form a
+ * transition tree per script context, rooted at the shape of objects without any
+ * property. Objects with too many properties, or getting a property that isn't
+ * among the transitions of a shape that already has too many of them, drop out of
+ * the tree and get a new unique shape id each time a property is added.
+ */
+struct _jsshape_t {
+    unsigned id;
+    unsigned hash;
+    unsigned children_cnt;
+    struct list children;
+    struct list entry;
+    WCHAR name[1];
+};
+
+static LONG last_shape_id;
+
+static unsigned alloc_shape_id(void)
+{
+    unsigned id;
+
+    /* zero is used for empty inline caches */
+    while(!(id = InterlockedIncrement(&last_shape_id)));
+    return id;
+}
+
+static jsshape_t *alloc_shape(const WCHAR *name, unsigned hash)
+{
+    size_t len = name ? strlenW(name) : 0;
+    jsshape_t *shape;
+
+    shape = heap_alloc(FIELD_OFFSET(jsshape_t, name[len+1]));
+    if(!shape)
+        return NULL;
+
+    shape->id = alloc_shape_id();
+    shape->hash = hash;
+    shape->children_cnt = 0;
+    list_init(&shape->children);
+    if(name)
+        memcpy(shape->name, name, (len+1)*sizeof(WCHAR));
+    else
+        shape->name[0] = 0;
+    return shape;
+}
+
+static void free_shape(jsshape_t *shape)
+{
+    jsshape_t *iter, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(iter, next, &shape->children, jsshape_t, entry)
+        free_shape(iter);
+    heap_free(shape);
+}
+
+void free_shapes(script_ctx_t *ctx)
+{
+    if(ctx->shape_root)
+        free_shape(ctx->shape_root);
+    ctx->shape_root = NULL;
+}
+
+static void update_shape(jsdisp_t *This, dispex_prop_t *prop)
+{
+    jsshape_t *iter, *shape = NULL;
+
+    if(This->shape && This->prop_cnt <= SHAPE_MAX_PROPS) {
+        LIST_FOR_EACH_ENTRY(iter, &This->shape->children, jsshape_t, entry) {
+            if(iter->hash == prop->hash && !strcmpW(iter->name, prop->name)) {
+                shape = iter;
+                break;
+            }
+        }
+
+        if(!shape && This->shape->children_cnt < SHAPE_MAX_CHILDREN
+           && (shape = alloc_shape(prop->name, prop->hash))) {
+            list_add_head(&This->shape->children, &shape->entry);
+            This->shape->children_cnt++;
+        }
+    }
+
+    This->shape = shape;
+    This->shape_id = shape ? shape->id : alloc_shape_id();
+}
+
 static inline DISPID prop_to_id(jsdisp_t *This, dispex_prop_t *prop)
 {
     return prop - This->props;
@@ -175,6 +267,8 @@ static inline dispex_prop_t* alloc_prop(jsdisp_t *This, const WCHAR *name, prop_
     bucket = get_props_idx(This, prop->hash);
     prop->bucket_next = This->props[bucket].bucket_head;
     This->props[bucket].bucket_head = This->prop_cnt++;
+
+    update_shape(This, prop);
     return prop;
 }
 
@@ -909,6 +1003,11 @@ HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *b
     if(prototype)
         jsdisp_addref(prototype);
 
+    if(!ctx->shape_root)
+        ctx->shape_root = alloc_shape(NULL, 0);
+    dispex->shape = ctx->shape_root;
+    dispex->shape_id = dispex->shape ? dispex->shape->id : alloc_shape_id();
+
     dispex->prop_cnt = 1;
     if(builtin_info->value_prop.invoke || builtin_info->value_prop.getter) {
         dispex->props[0].type = PROP_BUILTIN;
@@ -1051,6 +1150,23 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    HRESULT hres;
+
+    if(cache->shape_id == jsdisp->shape_id && jsdisp->props[cache->id].type != PROP_DELETED) {
+        *id = cache->id;
+        return S_OK;
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres)) {
+        cache->shape_id = jsdisp->shape_id;
+        cache->id = *id;
+    }
+    return hres;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
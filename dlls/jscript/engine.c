@@ -475,6 +475,21 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
     return hres;
 }
 
+static HRESULT disp_get_id_cached(script_ctx_t *ctx, IDispatch *disp, BSTR name, DWORD flags,
+        prop_cache_t *cache, DISPID *id)
+{
+    jsdisp_t *jsdisp;
+    HRESULT hres;
+
+    jsdisp = iface_to_jsdisp(disp);
+    if(!jsdisp)
+        return disp_get_id(ctx, disp, name, name, flags, id);
+
+    hres = jsdisp_get_id_cached(jsdisp, name, flags, cache, id);
+    jsdisp_release(jsdisp);
+    return hres;
+}
+
 static HRESULT disp_cmp(IDispatch *disp1, IDispatch *disp2, BOOL *ret)
 {
     IObjectIdentity *identity;
@@ -624,7 +639,7 @@ local_ref_t *lookup_local(const function_code_t *function, const WCHAR *identifi
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache, exprval_t *ret)
 {
     scope_chain_t *scope;
     named_item_t *item;
@@ -664,7 +679,10 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    if(cache)
+        hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
+    else
+        hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_disp_ref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -713,6 +731,12 @@ static inline BSTR get_op_bstr(script_ctx_t *ctx, int i)
     return frame->bytecode->instrs[frame->ip].u.arg[i].bstr;
 }
 
+static inline prop_cache_t *get_op_prop_cache(script_ctx_t *ctx)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    return frame->bytecode->prop_cache + frame->ip;
+}
+
 static inline unsigned get_op_uint(script_ctx_t *ctx, int i)
 {
     call_frame_t *frame = ctx->call_ctx;
@@ -1070,7 +1094,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = disp_get_id_cached(ctx, obj, arg, 0, get_op_prop_cache(ctx), &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1084,6 +1108,44 @@ static HRESULT interp_member(script_ctx_t *ctx)
     return stack_push(ctx, v);
 }
 
+/* ECMA-262 3rd Edition    11.2.1 */
+static HRESULT interp_member_ref(script_ctx_t *ctx)
+{
+    const BSTR name = get_op_bstr(ctx, 0);
+    const unsigned arg = get_op_uint(ctx, 1);
+    IDispatch *obj;
+    exprval_t ref;
+    jsval_t objv;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s %x\n", debugstr_w(name), arg);
+
+    objv = stack_pop(ctx);
+    hres = to_object(ctx, objv, &obj);
+    jsval_release(objv);
+    if(FAILED(hres))
+        return hres;
+
+    hres = disp_get_id_cached(ctx, obj, name, arg, get_op_prop_cache(ctx), &id);
+    if(SUCCEEDED(hres)) {
+        ref.type = EXPRVAL_IDREF;
+        ref.u.idref.disp = obj;
+        ref.u.idref.id = id;
+    }else {
+        IDispatch_Release(obj);
+        if(hres == DISP_E_UNKNOWNNAME && !(arg & fdexNameEnsure)) {
+            exprval_set_exception(&ref, JS_E_INVALID_PROPERTY);
+            hres = S_OK;
+        }else {
+            ERR("failed %08x\n", hres);
+            return hres;
+        }
+    }
+
+    return stack_push_exprval(ctx, &ref);
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_memberid(script_ctx_t *ctx)
 {
@@ -1229,7 +1291,7 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     exprval_t exprval;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, get_op_prop_cache(ctx), &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1258,7 +1320,7 @@ static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier)
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, get_op_prop_cache(ctx), &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1856,7 +1918,7 @@ static HRESULT interp_delete_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1967,7 +2029,7 @@ static HRESULT interp_typeofident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -2820,7 +2882,7 @@ static HRESULT bind_event_target(script_ctx_t *ctx, function_code_t *func, jsdis
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, func->event_target, &exprval);
+    hres = identifier_eval(ctx, func->event_target, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -56,6 +56,7 @@
     X(lt,         1, 0,0)                  \
     X(lteq,       1, 0,0)                  \
     X(member,     1, ARG_BSTR,   0)        \
+    X(member_ref, 1, ARG_BSTR,   ARG_UINT) \
     X(memberid,   1, ARG_UINT,   0)        \
     X(minus,      1, 0,0)                  \
     X(mod,        1, 0,0)                  \
@@ -179,6 +180,8 @@ typedef struct _bytecode_t {
     unsigned str_pool_size;
     unsigned str_cnt;
 
+    prop_cache_t *prop_cache; /* one entry per instruction */
+
     struct _bytecode_t *next;
 } bytecode_t;
 
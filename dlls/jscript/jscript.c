@@ -73,6 +73,7 @@ void script_release(script_ctx_t *ctx)
     if(ctx->cc)
         release_cc(ctx->cc);
     heap_pool_free(&ctx->tmp_heap);
+    free_shapes(ctx);
     if(ctx->last_match)
         jsstr_release(ctx->last_match);
     assert(!ctx->stack_top);
@@ -50,6 +50,7 @@ typedef struct _jsval_t jsval_t;
 typedef struct _jsstr_t jsstr_t;
 typedef struct _script_ctx_t script_ctx_t;
 typedef struct _dispex_prop_t dispex_prop_t;
+typedef struct _jsshape_t jsshape_t;
 
 typedef struct {
     void **blocks;
@@ -230,6 +231,9 @@ struct jsdisp_t {
 
     jsdisp_t *prototype;
 
+    jsshape_t *shape;
+    unsigned shape_id;
+
     const builtin_info_t *builtin_info;
 };
 
@@ -289,6 +293,15 @@ HRESULT jsdisp_propput_idx(jsdisp_t*,DWORD,jsval_t) DECLSPEC_HIDDEN;
 HRESULT jsdisp_propget_name(jsdisp_t*,LPCWSTR,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_idx(jsdisp_t*,DWORD,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_id(jsdisp_t*,const WCHAR*,DWORD,DISPID*) DECLSPEC_HIDDEN;
+
+/* Inline cache of a property lookup, valid as long as the object keeps the same shape. */
+typedef struct {
+    unsigned shape_id;
+    DISPID id;
+} prop_cache_t;
+
+HRESULT jsdisp_get_id_cached(jsdisp_t*,const WCHAR*,DWORD,prop_cache_t*,DISPID*) DECLSPEC_HIDDEN;
+void free_shapes(script_ctx_t*) DECLSPEC_HIDDEN;
 HRESULT disp_delete(IDispatch*,DISPID,BOOL*) DECLSPEC_HIDDEN;
 HRESULT disp_delete_name(script_ctx_t*,IDispatch*,jsstr_t*,BOOL*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_delete_idx(jsdisp_t*,DWORD) DECLSPEC_HIDDEN;
@@ -406,6 +419,8 @@ struct _script_ctx_t {
 
     heap_pool_t tmp_heap;
 
+    jsshape_t *shape_root;
+
     IDispatch *host_global;
 
     jsval_t *stack;
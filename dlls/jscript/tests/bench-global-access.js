@@ -0,0 +1,35 @@
+/*
+ * Global access benchmark: top level code using global variables,
+ * global functions and builtin objects.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+var counter = 0, total = 0, table = {};
+
+function bump(n) {
+    counter += n;
+    return counter;
+}
+
+for(var i = 0; i < 200000; i++) {
+    total += bump(i & 7);
+    total = Math.floor(total / 2);
+    table["k" + (i & 15)] = total;
+}
+
+var keys = 0;
+for(var k in table)
+    keys++;
@@ -0,0 +1,84 @@
+/*
+ * Property access benchmark: a small n-body simulation using objects
+ * which all have the same properties, and method calls through prototypes.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+function Vector(x, y, z) {
+    this.x = x;
+    this.y = y;
+    this.z = z;
+}
+
+Vector.prototype.add = function(v, f) {
+    this.x += v.x * f;
+    this.y += v.y * f;
+    this.z += v.z * f;
+};
+
+Vector.prototype.lengthSquared = function() {
+    return this.x * this.x + this.y * this.y + this.z * this.z;
+};
+
+function Body(x, y, z, vx, vy, vz, mass) {
+    this.position = new Vector(x, y, z);
+    this.velocity = new Vector(vx, vy, vz);
+    this.mass = mass;
+}
+
+function System(n) {
+    var i;
+
+    this.bodies = [];
+    for(i = 0; i < n; i++)
+        this.bodies.push(new Body(i, i * 0.5, -i, 0.1 * i, 0, -0.1 * i, 1 + i % 3));
+}
+
+System.prototype.advance = function(dt) {
+    var bodies = this.bodies, n = bodies.length, i, j, a, b, d, dist2, mag;
+
+    for(i = 0; i < n; i++) {
+        a = bodies[i];
+        for(j = i + 1; j < n; j++) {
+            b = bodies[j];
+            d = new Vector(a.position.x - b.position.x,
+                           a.position.y - b.position.y,
+                           a.position.z - b.position.z);
+            dist2 = d.lengthSquared() + 0.01;
+            mag = dt / (dist2 * Math.sqrt(dist2));
+            a.velocity.add(d, -b.mass * mag);
+            b.velocity.add(d, a.mass * mag);
+        }
+    }
+
+    for(i = 0; i < n; i++)
+        bodies[i].position.add(bodies[i].velocity, dt);
+};
+
+System.prototype.energy = function() {
+    var bodies = this.bodies, e = 0, i;
+
+    for(i = 0; i < bodies.length; i++)
+        e += 0.5 * bodies[i].mass * bodies[i].velocity.lengthSquared();
+    return e;
+};
+
+var system = new System(8);
+
+for(var step = 0; step < 2000; step++)
+    system.advance(0.01);
+
+var energy = system.energy();
@@ -1818,6 +1818,58 @@ function returnTest() {
 
 ok(returnTest() === undefined, "returnTest = " + returnTest());
 
+function testPropertyCache() {
+    var objs = [], pts, o, s, i, j;
+
+    function Point(x, y) {
+        this.x = x;
+        this.y = y;
+    }
+    Point.prototype.sum = function() { return this.x + this.y; };
+
+    objs.push(new Point(1, 2));
+    objs.push({y: 20, x: 10});
+    objs.push(new Point(100, 200));
+    o = new Point(1000, 2000);
+    delete o.x;
+    objs.push(o);
+
+    /* run the same instructions several times, so that they hit their caches */
+    for(j = 0; j < 3; j++) {
+        s = "";
+        for(i = 0; i < objs.length; i++)
+            s += objs[i].x + "," + objs[i].y + ";";
+        ok(s === "1,2;10,20;100,200;undefined,2000;", "[" + j + "] s = " + s);
+    }
+
+    delete objs[2].y;
+    objs[3].x = 3000;
+    for(i = 0; i < objs.length; i++)
+        objs[i].z = i;
+    s = "";
+    for(i = 0; i < objs.length; i++)
+        s += objs[i].x + "," + objs[i].y + "," + objs[i].z + ";";
+    ok(s === "1,2,0;10,20,1;100,undefined,2;3000,2000,3;", "s = " + s);
+
+    o = new Point(3, 4);
+    o.sum = function() { return -1; };
+    pts = [new Point(1, 2), o, new Point(5, 6)];
+    for(j = 0; j < 2; j++) {
+        s = "";
+        for(i = 0; i < pts.length; i++)
+            s += pts[i].sum() + ";";
+        ok(s === "3;-1;11;", "[" + j + "] s = " + s);
+    }
+
+    Point.prototype.sum = function() { return this.x * this.y; };
+    s = "";
+    for(i = 0; i < pts.length; i++)
+        s += pts[i].sum() + ";";
+    ok(s === "2;-1;30;", "s = " + s);
+}
+
+testPropertyCache();
+
 ActiveXObject = 1;
 ok(ActiveXObject === 1, "ActiveXObject = " + ActiveXObject);
 
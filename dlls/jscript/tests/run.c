@@ -2901,6 +2901,8 @@ static void run_benchmarks(void)
     run_benchmark("dna.js");
     run_benchmark("base64.js");
     run_benchmark("validateinput.js");
+    run_benchmark("propaccess.js");
+    run_benchmark("globalaccess.js");
 }
 
 static BOOL check_jscript(void)
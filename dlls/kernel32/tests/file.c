@@ -4964,6 +4964,60 @@ static void test_GetFileAttributesExW(void)
     ok(GetLastError() == ERROR_FILE_NOT_FOUND, "Expected error ERROR_FILE_NOT_FOUND, got %u\n", GetLastError());
 }
 
+static BOOL file_exists( const char *dir, const char *name )
+{
+    char path[2 * MAX_PATH];
+
+    sprintf( path, "%s\\%s", dir, name );
+    return GetFileAttributesA( path ) != INVALID_FILE_ATTRIBUTES;
+}
+
+static void create_empty_file( const char *dir, const char *name )
+{
+    char path[2 * MAX_PATH];
+    HANDLE file;
+
+    sprintf( path, "%s\\%s", dir, name );
+    file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %u\n", path, GetLastError() );
+    CloseHandle( file );
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    char temp_path[MAX_PATH], dir[MAX_PATH], path[2 * MAX_PATH];
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "tst", 0, dir );
+    DeleteFileA( dir );
+    ret = CreateDirectoryA( dir, NULL );
+    ok( ret, "CreateDirectory failed %u\n", GetLastError() );
+
+    create_empty_file( dir, "MixedCase.txt" );
+    Sleep( 1100 );  /* make sure the directory contents can be cached */
+
+    ok( file_exists( dir, "MIXEDCASE.TXT" ), "MIXEDCASE.TXT not found\n" );
+    ok( file_exists( dir, "mixedcase.txt" ), "mixedcase.txt not found\n" );
+    ok( !file_exists( dir, "MISSING.TXT" ), "MISSING.TXT found\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+
+    /* changes to the directory must be seen */
+    create_empty_file( dir, "NewFile.txt" );
+    ok( file_exists( dir, "NEWFILE.TXT" ), "NEWFILE.TXT not found\n" );
+
+    sprintf( path, "%s\\MixedCase.txt", dir );
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFile failed %u\n", GetLastError() );
+    ok( !file_exists( dir, "MIXEDCASE.TXT" ), "MIXEDCASE.TXT found after deletion\n" );
+
+    sprintf( path, "%s\\NewFile.txt", dir );
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFile failed %u\n", GetLastError() );
+    ret = RemoveDirectoryA( dir );
+    ok( ret, "RemoveDirectory failed %u\n", GetLastError() );
+}
+
 START_TEST(file)
 {
     InitFunctionPointers();
@@ -5022,4 +5076,5 @@ START_TEST(file)
     test_GetFinalPathNameByHandleW();
     test_SetFileInformationByHandle();
     test_GetFileAttributesExW();
+    test_case_insensitive_lookup();
 }
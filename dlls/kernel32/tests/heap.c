@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
@@ -892,6 +893,145 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+#define HEAP_THREAD_ALLOCS 256
+
+struct heap_thread_params
+{
+    HANDLE heap;
+    DWORD  iterations;
+};
+
+static DWORD WINAPI heap_thread( void *arg )
+{
+    struct heap_thread_params *params = arg;
+    BYTE *ptrs[HEAP_THREAD_ALLOCS];
+    SIZE_T size;
+    DWORD i, j;
+
+    for (i = 0; i < params->iterations; i++)
+    {
+        for (j = 0; j < HEAP_THREAD_ALLOCS; j++)
+        {
+            size = 1 + (i * 7 + j) % 500;
+            if (!(ptrs[j] = HeapAlloc( params->heap, 0, size ))) return 1;
+            memset( ptrs[j], j, size );
+        }
+        for (j = 0; j < HEAP_THREAD_ALLOCS; j++)
+        {
+            size = 1 + (i * 7 + j) % 500;
+            if (HeapSize( params->heap, 0, ptrs[j] ) != size) return 2;
+            if (ptrs[j][0] != (BYTE)j || ptrs[j][size - 1] != (BYTE)j) return 3;
+            if (!HeapFree( params->heap, 0, ptrs[j] )) return 4;
+        }
+    }
+    return 0;
+}
+
+/* allocate and free blocks from 1 up to max_count threads at once */
+static void run_heap_threads( HANDLE heap, const char *name, DWORD max_count, DWORD iterations )
+{
+    struct heap_thread_params params;
+    HANDLE threads[8];
+    DWORD i, count, code, start;
+
+    max_count = min( max_count, sizeof(threads) / sizeof(threads[0]) );
+    params.heap = heap;
+    params.iterations = iterations;
+
+    for (count = 1; count == 1 || count <= max_count; count *= 2)
+    {
+        start = GetTickCount();
+        for (i = 0; i < count; i++)
+        {
+            threads[i] = CreateThread( NULL, 0, heap_thread, &params, 0, NULL );
+            ok( threads[i] != NULL, "CreateThread failed %u\n", GetLastError() );
+        }
+        for (i = 0; i < count; i++)
+        {
+            WaitForSingleObject( threads[i], INFINITE );
+            GetExitCodeThread( threads[i], &code );
+            ok( !code, "%s heap: thread %u failed with %u\n", name, i, code );
+            CloseHandle( threads[i] );
+        }
+        if (winetest_debug > 1)
+            trace( "%s heap: %u threads, %u allocs each: %u ms\n", name, count,
+                   params.iterations * HEAP_THREAD_ALLOCS, GetTickCount() - start );
+    }
+}
+
+static void test_low_fragmentation_heap(void)
+{
+    PROCESS_HEAP_ENTRY entry;
+    HANDLE heap, std_heap;
+    SYSTEM_INFO si;
+    SIZE_T i, j;
+    ULONG info;
+    BYTE *ptr;
+    BOOL ret;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed %u\n", GetLastError() );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        skip( "low-fragmentation heap not supported\n" );
+        HeapDestroy( heap );
+        return;
+    }
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    /* freed blocks are reused with the right size and contents */
+    for (i = 1; i < 1024; i++)
+    {
+        if (!(ptr = HeapAlloc( heap, 0, i ))) break;
+        if (HeapSize( heap, 0, ptr ) != i) break;
+        memset( ptr, 0xcc, i );
+        if (!HeapFree( heap, 0, ptr )) break;
+        if (!(ptr = HeapAlloc( heap, HEAP_ZERO_MEMORY, i ))) break;
+        if (HeapSize( heap, 0, ptr ) != i) break;
+        for (j = 0; j < i; j++) if (ptr[j]) break;
+        if (j < i || !HeapFree( heap, 0, ptr )) break;
+    }
+    ok( i == 1024, "allocation of %lu bytes failed\n", i );
+
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    memset( &entry, 0, sizeof(entry) );
+    for (i = 0; HeapWalk( heap, &entry ); i++) ;
+    ok( i > 0, "no heap entries\n" );
+    ok( GetLastError() == ERROR_NO_MORE_ITEMS, "wrong error %u\n", GetLastError() );
+
+    /* concurrent allocations from a couple of threads */
+    run_heap_threads( heap, "low-fragmentation", 2, 2 );
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    if (winetest_interactive)
+    {
+        /* compare against a standard heap with up to one thread per cpu */
+        GetSystemInfo( &si );
+        std_heap = HeapCreate( 0, 0, 0 );
+        ok( std_heap != NULL, "HeapCreate failed %u\n", GetLastError() );
+        run_heap_threads( std_heap, "standard", si.dwNumberOfProcessors, 200 );
+        run_heap_threads( heap, "low-fragmentation", si.dwNumberOfProcessors, 200 );
+        ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+        HeapDestroy( std_heap );
+    }
+    else skip( "Run in interactive mode to run the heap performance tests.\n" );
+
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1385,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_low_fragmentation_heap();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
@@ -3516,6 +3516,121 @@ static void test_ResolveDelayLoadedAPI(void)
     DeleteFileA(dll_name);
 }
 
+/* check that the import address tables of a dll match the exports of the imported dlls */
+static void check_import_tables(const char *name)
+{
+    const IMAGE_IMPORT_DESCRIPTOR *descr;
+    const IMAGE_THUNK_DATA *names, *funcs;
+    HMODULE module, imported;
+    FARPROC proc;
+    ULONG size;
+
+    if (!(module = GetModuleHandleA(name))) return;
+    descr = pRtlImageDirectoryEntryToData(module, TRUE, IMAGE_DIRECTORY_ENTRY_IMPORT, &size);
+    for (; descr && descr->Name && descr->FirstThunk; descr++)
+    {
+        if (!(imported = GetModuleHandleA(RVAToAddr(descr->Name, module)))) continue;
+        names = RVAToAddr(U(*descr).OriginalFirstThunk ? U(*descr).OriginalFirstThunk : descr->FirstThunk, module);
+        funcs = RVAToAddr(descr->FirstThunk, module);
+        for (; names->u1.Ordinal; names++, funcs++)
+        {
+            if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal))
+                proc = GetProcAddress(imported, (LPSTR)IMAGE_ORDINAL(names->u1.Ordinal));
+            else
+            {
+                const IMAGE_IMPORT_BY_NAME *iibn = RVAToAddr(names->u1.AddressOfData, module);
+                proc = GetProcAddress(imported, (char *)iibn->Name);
+            }
+            ok((FARPROC)funcs->u1.Function == proc, "%s: import from %s resolved to %p instead of %p\n",
+               name, (char *)RVAToAddr(descr->Name, module), (void *)funcs->u1.Function, proc);
+        }
+    }
+}
+
+static void test_import_snapshot_child(void)
+{
+    check_import_tables("kernel32.dll");
+    check_import_tables("advapi32.dll");
+    check_import_tables("user32.dll");
+}
+
+static void run_snapshot_child(void)
+{
+    char cmdline[MAX_PATH + 32], **argv;
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    memset(&si, 0, sizeof(si));
+    si.cb = sizeof(si);
+    sprintf(cmdline, "\"%s\" loader import_snapshot", argv[0]);
+    ret = CreateProcessA(argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError());
+    if (!ret) return;
+    winetest_wait_child_process(pi.hProcess);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+}
+
+static BOOL get_file_info(const WCHAR *name, BY_HANDLE_FILE_INFORMATION *info)
+{
+    HANDLE file;
+    BOOL ret;
+
+    file = CreateFileW(name, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    ret = GetFileInformationByHandle(file, info);
+    CloseHandle(file);
+    return ret;
+}
+
+/* Wine specific: the first child saves its resolved imports, the second one reuses them */
+static void test_import_snapshot(void)
+{
+    char *(CDECL *pwine_get_unix_file_name)(const WCHAR *);
+    BY_HANDLE_FILE_INFORMATION info1, info2;
+    static const WCHAR prefixW[] = {'l','d','r',0};
+    WCHAR temp_path[MAX_PATH], snapshot_name[MAX_PATH];
+    char *unix_name;
+    BOOL ret;
+
+    pwine_get_unix_file_name = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "wine_get_unix_file_name");
+    if (!pwine_get_unix_file_name)
+    {
+        skip("import snapshot is specific to Wine\n");
+        return;
+    }
+
+    /* keep the snapshot out of the prefix */
+    GetTempPathW(MAX_PATH, temp_path);
+    GetTempFileNameW(temp_path, prefixW, 0, snapshot_name);
+    if (!(unix_name = pwine_get_unix_file_name(snapshot_name)))
+    {
+        skip("no unix name for %s\n", wine_dbgstr_w(snapshot_name));
+        DeleteFileW(snapshot_name);
+        return;
+    }
+    SetEnvironmentVariableA("WINEIMPORTSNAPSHOT", unix_name);
+    HeapFree(GetProcessHeap(), 0, unix_name);
+
+    run_snapshot_child();
+    ret = get_file_info(snapshot_name, &info1);
+    ok(ret, "GetFileInformationByHandle(%s) error %d\n", wine_dbgstr_w(snapshot_name), GetLastError());
+    ok(ret && info1.nFileSizeLow, "snapshot was not saved\n");
+
+    /* the snapshot is only replaced when some imports had to be resolved again */
+    run_snapshot_child();
+    ret = get_file_info(snapshot_name, &info2);
+    ok(ret, "GetFileInformationByHandle(%s) error %d\n", wine_dbgstr_w(snapshot_name), GetLastError());
+    ok(ret && info2.nFileIndexHigh == info1.nFileIndexHigh && info2.nFileIndexLow == info1.nFileIndexLow,
+       "imports were not resolved from the snapshot\n");
+
+    SetEnvironmentVariableA("WINEIMPORTSNAPSHOT", NULL);
+    ret = DeleteFileW(snapshot_name);
+    ok(ret, "DeleteFile(%s) error %d\n", wine_dbgstr_w(snapshot_name), GetLastError());
+}
+
 static void test_InMemoryOrderModuleList(void)
 {
     PEB_LDR_DATA *ldr = NtCurrentTeb()->Peb->LdrData;
@@ -3544,6 +3659,8 @@ START_TEST(loader)
     HANDLE ntdll, mapping, kernel32;
     SYSTEM_INFO si;
 
+    argc = winetest_get_mainargs(&argv);
+
     ntdll = GetModuleHandleA("ntdll.dll");
     kernel32 = GetModuleHandleA("kernel32.dll");
     pNtCreateSection = (void *)GetProcAddress(ntdll, "NtCreateSection");
@@ -3575,6 +3692,12 @@ START_TEST(loader)
     dos_header.e_magic = IMAGE_DOS_SIGNATURE;
     dos_header.e_lfanew = sizeof(dos_header);
 
+    if (argc > 2 && !strcmp(argv[2], "import_snapshot"))
+    {
+        test_import_snapshot_child();
+        return;
+    }
+
     mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, 4096, "winetest_loader");
     ok(mapping != 0, "CreateFileMapping failed\n");
     child_failures = MapViewOfFile(mapping, FILE_MAP_READ|FILE_MAP_WRITE, 0, 0, 4096);
@@ -3585,7 +3708,6 @@ START_TEST(loader)
     else
         *child_failures = -1;
 
-    argc = winetest_get_mainargs(&argv);
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -3601,4 +3723,5 @@ START_TEST(loader)
     test_import_resolution();
     test_ExitProcess();
     test_InMemoryOrderModuleList();
+    test_import_snapshot();
 }
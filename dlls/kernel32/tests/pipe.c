@@ -3283,6 +3283,147 @@ static void test_TransactNamedPipe(void)
     CloseHandle(server);
 }
 
+static DWORD CALLBACK echo_pipe_thread(void *arg)
+{
+    HANDLE pipe = arg;
+    char buf[4096];
+    DWORD size, written;
+
+    while (ReadFile(pipe, buf, sizeof(buf), &size, NULL) && size)
+        if (!WriteFile(pipe, buf, size, &written, NULL)) break;
+    return 0;
+}
+
+static void pipe_round_trips(HANDLE client, DWORD size, unsigned int count, const char *name)
+{
+    char buf[4096], expect[4096];
+    DWORD start, done, res_size;
+    unsigned int i;
+    BOOL res = TRUE;
+
+    start = GetTickCount();
+    for (i = 0; i < count && res; i++)
+    {
+        memset(expect, i, size);
+        res = WriteFile(client, expect, size, &res_size, NULL);
+        ok(res && res_size == size, "WriteFile returned %x(%u), size %u\n", res, GetLastError(), res_size);
+        for (done = 0; res && done < size; done += res_size)
+        {
+            res = ReadFile(client, buf + done, size - done, &res_size, NULL);
+            ok(res, "ReadFile failed: %u\n", GetLastError());
+        }
+        ok(!res || done == size, "read %u bytes, expected %u\n", done, size);
+        ok(!res || !memcmp(buf, expect, size), "%s: wrong data in round trip %u\n", name, i);
+    }
+    if (winetest_interactive)
+        trace("%s: %u round trips of %u bytes in %u ms\n", name, count, size, GetTickCount() - start);
+}
+
+static void test_pipe_performance(DWORD mode, const char *name)
+{
+    unsigned int count = winetest_interactive ? 100000 : 100;
+    DWORD read_mode = mode & PIPE_READMODE_MESSAGE;
+    HANDLE server, client, thread;
+    BOOL res;
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX, PIPE_WAIT | mode, 1, 65536, 65536,
+                              NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed: %u\n", GetLastError());
+    client = CreateFileA(PIPENAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+    res = SetNamedPipeHandleState(client, &read_mode, NULL, NULL);
+    ok(res, "SetNamedPipeHandleState failed: %u\n", GetLastError());
+
+    thread = CreateThread(NULL, 0, echo_pipe_thread, server, 0, NULL);
+    ok(thread != NULL, "CreateThread failed: %u\n", GetLastError());
+
+    pipe_round_trips(client, 32, count, name);
+    pipe_round_trips(client, 4096, count, name);
+
+    CloseHandle(client);
+    ok(!WaitForSingleObject(thread, 10000), "echo thread didn't exit\n");
+    CloseHandle(thread);
+    CloseHandle(server);
+}
+
+static void test_byte_mode_pipe(BOOL direct)
+{
+    HANDLE server, client;
+    DWORD size, avail;
+    char buf[16];
+    BOOL res;
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_WAIT, 1, 1024, 1024,
+                              NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed: %u\n", GetLastError());
+    client = CreateFileA(PIPENAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+
+    res = WriteFile(client, "hello", 5, &size, NULL);
+    ok(res && size == 5, "WriteFile returned %x(%u), size %u\n", res, GetLastError(), size);
+    res = WriteFile(client, "", 0, &size, NULL);
+    ok(res && !size, "WriteFile returned %x(%u), size %u\n", res, GetLastError(), size);
+
+    memset(buf, 0, sizeof(buf));
+    res = PeekNamedPipe(server, buf, sizeof(buf), &size, &avail, NULL);
+    ok(res, "PeekNamedPipe failed: %u\n", GetLastError());
+    ok(size == 5 && avail == 5, "PeekNamedPipe returned %u/%u bytes\n", size, avail);
+    ok(!memcmp(buf, "hello", 5), "wrong data %.*s\n", (int)size, buf);
+
+    /* byte mode reads can split and merge writes */
+    res = ReadFile(server, buf, 3, &size, NULL);
+    ok(res && size == 3, "ReadFile returned %x(%u), size %u\n", res, GetLastError(), size);
+    ok(!memcmp(buf, "hel", 3), "wrong data %.*s\n", (int)size, buf);
+    res = WriteFile(client, "world", 5, &size, NULL);
+    ok(res && size == 5, "WriteFile returned %x(%u), size %u\n", res, GetLastError(), size);
+    for (avail = 0; avail < 7; avail += size)
+    {
+        res = ReadFile(server, buf + avail, sizeof(buf) - avail, &size, NULL);
+        ok(res, "ReadFile failed: %u\n", GetLastError());
+        if (!res) break;
+    }
+    ok(avail == 7 && !memcmp(buf, "loworld", 7), "wrong data %.*s\n", (int)avail, buf);
+
+    res = WriteFile(server, "reply", 5, &size, NULL);
+    ok(res && size == 5, "WriteFile returned %x(%u), size %u\n", res, GetLastError(), size);
+    res = ReadFile(client, buf, sizeof(buf), &size, NULL);
+    ok(res && size == 5, "ReadFile returned %x(%u), size %u\n", res, GetLastError(), size);
+    ok(!memcmp(buf, "reply", 5), "wrong data %.*s\n", (int)size, buf);
+
+    res = DisconnectNamedPipe(server);
+    ok(res, "DisconnectNamedPipe failed: %u\n", GetLastError());
+    SetLastError(0xdeadbeef);
+    res = ReadFile(client, buf, sizeof(buf), &size, NULL);
+    ok(!res, "ReadFile succeeded\n");
+    /* the direct path only sees that the socket was shut down */
+    ok(GetLastError() == ERROR_PIPE_NOT_CONNECTED || (direct && GetLastError() == ERROR_BROKEN_PIPE),
+       "ReadFile failed with %u\n", GetLastError());
+
+    CloseHandle(client);
+    CloseHandle(server);
+}
+
+/* Wine specific: byte mode pipes created with WINEPIPEDIRECT=1 exchange their data
+ * through a socketpair instead of the server */
+static void test_direct_pipes(void)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA si = { sizeof(si) };
+    char **argv, buf[MAX_PATH];
+    BOOL res;
+
+    winetest_get_mainargs(&argv);
+    sprintf(buf, "\"%s\" pipe direct", argv[0]);
+    SetEnvironmentVariableA("WINEPIPEDIRECT", "1");
+    res = CreateProcessA(NULL, buf, NULL, NULL, FALSE, 0L, NULL, NULL, &si, &info);
+    SetEnvironmentVariableA("WINEPIPEDIRECT", NULL);
+    ok(res, "CreateProcess failed: %u\n", GetLastError());
+    if (!res) return;
+    winetest_wait_child_process(info.hProcess);
+    CloseHandle(info.hThread);
+    CloseHandle(info.hProcess);
+}
+
 START_TEST(pipe)
 {
     char **argv;
@@ -3305,6 +3446,13 @@ START_TEST(pipe)
         return;
     }
 
+    if (argc > 2 && !strcmp(argv[2], "direct"))
+    {
+        test_byte_mode_pipe(TRUE);
+        test_pipe_performance(PIPE_TYPE_BYTE | PIPE_READMODE_BYTE, "byte mode, direct");
+        return;
+    }
+
     if (test_DisconnectNamedPipe())
         return;
     test_CreateNamedPipe_instances_must_match();
@@ -3324,4 +3472,8 @@ START_TEST(pipe)
     test_overlapped_transport(TRUE, TRUE);
     test_overlapped_transport(FALSE, FALSE);
     test_TransactNamedPipe();
+    test_byte_mode_pipe(FALSE);
+    test_direct_pipes();
+    test_pipe_performance(PIPE_TYPE_BYTE | PIPE_READMODE_BYTE, "byte mode");
+    test_pipe_performance(PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE, "message mode");
 }
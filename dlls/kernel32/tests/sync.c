@@ -56,6 +56,7 @@ static NTSTATUS (WINAPI *pNtAllocateVirtualMemory)(HANDLE, PVOID *, ULONG, SIZE_
 static NTSTATUS (WINAPI *pNtFreeVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG);
 static NTSTATUS (WINAPI *pNtWaitForSingleObject)(HANDLE, BOOLEAN, const LARGE_INTEGER *);
 static NTSTATUS (WINAPI *pNtWaitForMultipleObjects)(ULONG,const HANDLE*,BOOLEAN,BOOLEAN,const LARGE_INTEGER*);
+static BOOL (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,OVERLAPPED_ENTRY*,ULONG,ULONG*,DWORD,BOOL);
 static PSLIST_ENTRY (__fastcall *pRtlInterlockedPushListSList)(PSLIST_HEADER list, PSLIST_ENTRY first,
                                                                PSLIST_ENTRY last, ULONG count);
 static PSLIST_ENTRY (WINAPI *pRtlInterlockedPushListSListEx)(PSLIST_HEADER list, PSLIST_ENTRY first,
@@ -868,6 +869,60 @@ static void CALLBACK timer_queue_cb6(PVOID p, BOOLEAN timedOut)
     }
 }
 
+static void test_completion_port_batch(void)
+{
+    OVERLAPPED_ENTRY entries[64];
+    ULONG count, i, total;
+    HANDLE port;
+    BOOL ret;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed err %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    ret = pGetQueuedCompletionStatusEx( port, entries, 64, &count, 0, FALSE );
+    ok( !ret, "GetQueuedCompletionStatusEx succeeded\n" );
+    ok( GetLastError() == WAIT_TIMEOUT, "wrong error %u\n", GetLastError() );
+
+    for (i = 0; i < 100; i++)
+    {
+        ret = PostQueuedCompletionStatus( port, i, 0x1000 + i, (OVERLAPPED *)(ULONG_PTR)(0x2000 + i) );
+        ok( ret, "PostQueuedCompletionStatus failed err %u\n", GetLastError() );
+    }
+
+    for (total = 0; total < 100; total += count)
+    {
+        memset( entries, 0xcc, sizeof(entries) );
+        count = 0;
+        ret = pGetQueuedCompletionStatusEx( port, entries, 64, &count, 1000, FALSE );
+        ok( ret, "GetQueuedCompletionStatusEx failed err %u\n", GetLastError() );
+        if (!ret) break;
+        ok( count == (total ? 36 : 64), "got %u entries\n", count );
+        for (i = 0; i < count; i++)
+        {
+            ok( entries[i].lpCompletionKey == 0x1000 + total + i, "%u: wrong key %lx\n",
+                total + i, entries[i].lpCompletionKey );
+            ok( entries[i].lpOverlapped == (OVERLAPPED *)(ULONG_PTR)(0x2000 + total + i),
+                "%u: wrong overlapped %p\n", total + i, entries[i].lpOverlapped );
+            ok( entries[i].dwNumberOfBytesTransferred == total + i, "%u: wrong size %u\n",
+                total + i, entries[i].dwNumberOfBytesTransferred );
+        }
+    }
+
+    SetLastError( 0xdeadbeef );
+    ret = pGetQueuedCompletionStatusEx( port, entries, 64, &count, 0, FALSE );
+    ok( !ret, "GetQueuedCompletionStatusEx succeeded\n" );
+    ok( GetLastError() == WAIT_TIMEOUT, "wrong error %u\n", GetLastError() );
+
+    CloseHandle( port );
+}
+
 static void test_timer_queue(void)
 {
     HANDLE q, t0, t1, t2, t3, t4, t5;
@@ -2665,6 +2720,7 @@ START_TEST(sync)
     pNtWaitForMultipleObjects = (void *)GetProcAddress(hntdll, "NtWaitForMultipleObjects");
     pRtlInterlockedPushListSList = (void *)GetProcAddress(hntdll, "RtlInterlockedPushListSList");
     pRtlInterlockedPushListSListEx = (void *)GetProcAddress(hntdll, "RtlInterlockedPushListSListEx");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
 
     argc = winetest_get_mainargs( &argv );
     if (argc >= 3)
@@ -2684,6 +2740,7 @@ START_TEST(sync)
     test_semaphore();
     test_waitable_timer();
     test_iocp_callback();
+    test_completion_port_batch();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
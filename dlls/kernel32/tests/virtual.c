@@ -490,6 +490,59 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+#define CHURN_BLOCKS 64
+
+static DWORD WINAPI alloc_churn_thread( void *arg )
+{
+    DWORD flags = MEM_RESERVE | MEM_COMMIT | (arg ? MEM_TOP_DOWN : 0);
+    DWORD *blocks[CHURN_BLOCKS] = { NULL };
+    MEMORY_BASIC_INFORMATION info;
+    DWORD old_prot, i;
+    SIZE_T ret;
+
+    for (i = 0; i < 4096; i++)
+    {
+        DWORD **slot = &blocks[i % CHURN_BLOCKS];
+
+        if (*slot)
+        {
+            ok( **slot == i - CHURN_BLOCKS, "%u: block %p overwritten %x\n", i, *slot, **slot );
+            ok( VirtualFree( *slot, 0, MEM_RELEASE ), "VirtualFree failed %u\n", GetLastError() );
+        }
+        *slot = VirtualAlloc( NULL, (i % 3 + 1) * 0x1000, flags, PAGE_READWRITE );
+        ok( *slot != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+        if (!*slot) break;
+        **slot = i;
+
+        ok( VirtualProtect( *slot, 0x1000, PAGE_READONLY, &old_prot ), "VirtualProtect failed %u\n", GetLastError() );
+        ok( old_prot == PAGE_READWRITE, "got old prot %x\n", old_prot );
+        ret = VirtualQuery( *slot, &info, sizeof(info) );
+        ok( ret == sizeof(info), "VirtualQuery failed %u\n", GetLastError() );
+        ok( info.AllocationBase == *slot, "%p: got allocation base %p\n", *slot, info.AllocationBase );
+        ok( info.State == MEM_COMMIT, "%p: got state %x\n", *slot, info.State );
+        ok( info.Protect == PAGE_READONLY, "%p: got protect %x\n", *slot, info.Protect );
+        ok( info.RegionSize == 0x1000, "%p: got size %lx\n", *slot, info.RegionSize );
+    }
+    for (i = 0; i < CHURN_BLOCKS; i++) if (blocks[i]) VirtualFree( blocks[i], 0, MEM_RELEASE );
+    return 0;
+}
+
+static void test_VirtualAlloc_threads(void)
+{
+    HANDLE threads[4];
+    DWORD i, start;
+
+    start = GetTickCount();
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+        threads[i] = CreateThread( NULL, 0, alloc_churn_thread, (void *)(ULONG_PTR)(i & 1), 0, NULL );
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+    {
+        ok( !WaitForSingleObject( threads[i], 60000 ), "thread %u did not finish\n", i );
+        CloseHandle( threads[i] );
+    }
+    if (winetest_debug > 1) trace( "alloc/protect/free churn took %u ms\n", GetTickCount() - start );
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -2304,6 +2357,83 @@ static void test_write_watch(void)
     VirtualFree( base, 0, MEM_RELEASE );
 }
 
+static void test_write_watch_gc(void)
+{
+    static const SIZE_T heap_size = 0x1000000;
+    DWORD start, cycle, written;
+    ULONG_PTR count, i;
+    void **results;
+    ULONG pagesize;
+    char *base, *ptr;
+    UINT ret;
+    BOOL res;
+
+    if (!pGetWriteWatch || !pResetWriteWatch)
+    {
+        win_skip( "GetWriteWatch not supported\n" );
+        return;
+    }
+
+    base = VirtualAlloc( 0, heap_size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE );
+    if (!base)
+    {
+        win_skip( "MEM_WRITE_WATCH not supported\n" );
+        return;
+    }
+    results = HeapAlloc( GetProcessHeap(), 0, (heap_size / 0x1000) * sizeof(*results) );
+
+    /* simulate a garbage collector that touches some of the heap and collects the dirty pages */
+    start = GetTickCount();
+    for (cycle = 0; cycle < 32; cycle++)
+    {
+        for (i = written = 0; i < heap_size; i += 0x1000 * (cycle % 7 + 1), written++)
+            base[i + cycle] = cycle;
+
+        count = heap_size / 0x1000;
+        ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, heap_size, results, &count, &pagesize );
+        ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+        ok( pagesize == 0x1000, "wrong page size %x\n", pagesize );
+        ok( count == written, "%u: got %lu pages instead of %u\n", cycle, count, written );
+        if (count)
+            ok( results[0] == base && results[count - 1] == base + (written - 1) * 0x1000 * (cycle % 7 + 1),
+                "%u: wrong results %p-%p\n", cycle, results[0], results[count - 1] );
+    }
+    if (winetest_debug > 1)
+        trace( "%u write watch cycles on %lu pages took %u ms\n", cycle, heap_size / 0x1000,
+               GetTickCount() - start );
+
+    count = heap_size / 0x1000;
+    ret = pGetWriteWatch( 0, base, heap_size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+    ok( !count, "got %lu pages\n", count );
+
+    /* pages decommitted and committed again are still watched */
+    res = VirtualFree( base + 0x10000, 0x4000, MEM_DECOMMIT );
+    ok( res, "VirtualFree failed %u\n", GetLastError() );
+    ptr = VirtualAlloc( base + 0x10000, 0x4000, MEM_COMMIT, PAGE_READWRITE );
+    ok( ptr == base + 0x10000, "VirtualAlloc failed %u\n", GetLastError() );
+    base[0x11000] = 1;
+    base[0x20000] = 1;
+
+    count = heap_size / 0x1000;
+    ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, heap_size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+    ok( count == 2, "got %lu pages\n", count );
+    if (count == 2)
+        ok( results[0] == base + 0x11000 && results[1] == base + 0x20000,
+            "wrong results %p %p\n", results[0], results[1] );
+
+    base[0x12000] = 1;
+    count = heap_size / 0x1000;
+    ret = pGetWriteWatch( 0, base, heap_size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+    ok( count == 1, "got %lu pages\n", count );
+    if (count == 1) ok( results[0] == base + 0x12000, "wrong result %p\n", results[0] );
+
+    HeapFree( GetProcessHeap(), 0, results );
+    VirtualFree( base, 0, MEM_RELEASE );
+}
+
 #if defined(__i386__) || defined(__x86_64__)
 
 static DWORD WINAPI stack_commit_func( void *arg )
@@ -4404,6 +4534,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_VirtualAlloc_threads();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
     test_NtAreMappedFilesTheSame();
@@ -4412,6 +4543,7 @@ START_TEST(virtual)
     test_IsBadWritePtr();
     test_IsBadCodePtr();
     test_write_watch();
+    test_write_watch_gc();
 #if defined(__i386__) || defined(__x86_64__)
     test_stack_commit();
 #endif
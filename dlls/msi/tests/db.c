@@ -9701,6 +9701,185 @@ static void test_select_column_names(void)
     ok(r == ERROR_SUCCESS , "failed to close database: %u\n", r);
 }
 
+static UINT count_query_rows( MSIHANDLE hdb, MSIHANDLE hrec, const char *query, UINT *count )
+{
+    MSIHANDLE hview, rec;
+    UINT r;
+
+    *count = 0;
+    r = MsiDatabaseOpenViewA( hdb, query, &hview );
+    if (r != ERROR_SUCCESS)
+        return r;
+
+    r = MsiViewExecute( hview, hrec );
+    while (r == ERROR_SUCCESS && (r = MsiViewFetch( hview, &rec )) == ERROR_SUCCESS)
+    {
+        (*count)++;
+        MsiCloseHandle( rec );
+    }
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+    return r == ERROR_NO_MORE_ITEMS ? ERROR_SUCCESS : r;
+}
+
+static void test_large_join(void)
+{
+    static const UINT files_per_component = 4;
+    UINT num_components = winetest_interactive ? 1000 : 100;  /* timings are only useful with many rows */
+    MSIHANDLE hdb, hrec, hview, rec;
+    char buf[MAX_PATH], buf2[MAX_PATH], expect[MAX_PATH];
+    UINT r, i, count, size, file;
+    DWORD ticks;
+
+    hdb = create_db();
+    ok( hdb, "failed to create db\n" );
+
+    r = create_component_table( hdb );
+    ok( r == ERROR_SUCCESS, "cannot create Component table: %u\n", r );
+
+    r = run_query( hdb, 0,
+            "CREATE TABLE `File` ( "
+            "`File` CHAR(72) NOT NULL, "
+            "`Component_` CHAR(72) NOT NULL, "
+            "`FileName` CHAR(255) NOT NULL, "
+            "`Sequence` LONG NOT NULL "
+            "PRIMARY KEY `File`)" );
+    ok( r == ERROR_SUCCESS, "cannot create File table: %u\n", r );
+
+    hrec = MsiCreateRecord( 4 );
+    for (i = 0; i < num_components; i++)
+    {
+        sprintf( buf, "comp%u", i );
+        MsiRecordSetStringA( hrec, 1, buf );
+        MsiRecordSetStringA( hrec, 2, "TARGETDIR" );
+        MsiRecordSetInteger( hrec, 3, i % 2 );
+        r = run_query( hdb, hrec, "INSERT INTO `Component` "
+                "(`Component`, `Directory_`, `Attributes`, `KeyPath`) VALUES (?, ?, ?, ?)" );
+        ok( r == ERROR_SUCCESS, "cannot add component: %u\n", r );
+    }
+    for (i = 0; i < num_components * files_per_component; i++)
+    {
+        sprintf( buf, "file%u", i );
+        MsiRecordSetStringA( hrec, 1, buf );
+        sprintf( buf, "comp%u", i / files_per_component );
+        MsiRecordSetStringA( hrec, 2, buf );
+        sprintf( buf, "file%u.dll", i );
+        MsiRecordSetStringA( hrec, 3, buf );
+        MsiRecordSetInteger( hrec, 4, i + 1 );
+        r = run_query( hdb, hrec, "INSERT INTO `File` "
+                "(`File`, `Component_`, `FileName`, `Sequence`) VALUES (?, ?, ?, ?)" );
+        ok( r == ERROR_SUCCESS, "cannot add file: %u\n", r );
+    }
+    MsiCloseHandle( hrec );
+
+    /* join used by the file costing and install actions */
+    ticks = GetTickCount();
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `File`, `Component`.`Component` FROM `File`, `Component` "
+                              "WHERE `Component_` = `Component`.`Component`", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %u\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %u\n", r );
+    count = 0;
+    while (MsiViewFetch( hview, &rec ) == ERROR_SUCCESS)
+    {
+        size = sizeof(buf);
+        MsiRecordGetStringA( rec, 1, buf, &size );
+        size = sizeof(buf2);
+        MsiRecordGetStringA( rec, 2, buf2, &size );
+        sscanf( buf, "file%u", &file );
+        sprintf( expect, "comp%u", file / files_per_component );
+        if (strcmp( buf2, expect ))
+            ok( 0, "file %s joined with %s\n", buf, buf2 );
+        count++;
+        MsiCloseHandle( rec );
+    }
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+    ok( count == num_components * files_per_component, "got %u rows\n", count );
+    if (winetest_interactive)
+        trace( "join of %u files and %u components: %u ms\n", count, num_components, GetTickCount() - ticks );
+
+    /* per component lookups, as done when selecting files and registry entries */
+    ticks = GetTickCount();
+    hrec = MsiCreateRecord( 1 );
+    for (i = 0; i < num_components; i++)
+    {
+        sprintf( buf, "comp%u", i );
+        MsiRecordSetStringA( hrec, 1, buf );
+        r = count_query_rows( hdb, hrec, "SELECT * FROM `File` WHERE `Component_` = ?", &count );
+        ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+        ok( count == files_per_component, "%s: got %u rows\n", buf, count );
+    }
+    if (winetest_interactive)
+        trace( "%u parameterized lookups: %u ms\n", num_components, GetTickCount() - ticks );
+
+    MsiRecordSetInteger( hrec, 1, 17 );
+    r = count_query_rows( hdb, hrec, "SELECT * FROM `File` WHERE `Sequence` = ?", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 1, "got %u rows\n", count );
+
+    MsiRecordSetStringA( hrec, 1, "comp7" );
+    r = count_query_rows( hdb, hrec, "SELECT * FROM `File` WHERE `Sequence` > 30 AND `Component_` = ?", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 2, "got %u rows\n", count );
+    MsiCloseHandle( hrec );
+
+    /* key lookup with parameters in the conditions before it */
+    hrec = MsiCreateRecord( 3 );
+    MsiRecordSetInteger( hrec, 1, 30 );
+    MsiRecordSetStringA( hrec, 2, "file31.dll" );
+    MsiRecordSetStringA( hrec, 3, "comp7" );
+    r = count_query_rows( hdb, hrec, "SELECT * FROM `File` WHERE `Sequence` > ? AND `FileName` <> ? "
+                          "AND `Component_` = ?", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 1, "got %u rows\n", count );
+    MsiCloseHandle( hrec );
+
+    sprintf( buf, "SELECT * FROM `File` WHERE `Sequence` = %u", num_components * files_per_component );
+    r = count_query_rows( hdb, 0, buf, &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 1, "got %u rows\n", count );
+
+    r = count_query_rows( hdb, 0, "SELECT * FROM `File` WHERE `Sequence` = 0", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 0, "got %u rows\n", count );
+
+    r = count_query_rows( hdb, 0, "SELECT * FROM `File` WHERE `Component_` = 'nonexistent'", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 0, "got %u rows\n", count );
+
+    r = count_query_rows( hdb, 0, "SELECT * FROM `Component` WHERE `KeyPath` = ''", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == num_components, "got %u rows\n", count );
+
+    r = count_query_rows( hdb, 0, "SELECT * FROM `Component` WHERE `Attributes` = 1 AND `Component` = 'comp3'", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 1, "got %u rows\n", count );
+
+    r = count_query_rows( hdb, 0, "SELECT * FROM `Component` WHERE `Component` = 'comp4' OR `Attributes` = 1", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == num_components / 2 + 1, "got %u rows\n", count );
+
+    /* the index must follow row updates and deletions */
+    r = run_query( hdb, 0, "UPDATE `File` SET `Component_` = 'comp1' WHERE `File` = 'file0'" );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    r = count_query_rows( hdb, 0, "SELECT * FROM `File` WHERE `Component_` = 'comp1'", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == files_per_component + 1, "got %u rows\n", count );
+
+    r = run_query( hdb, 0, "DELETE FROM `File` WHERE `Component_` = 'comp1'" );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    r = count_query_rows( hdb, 0, "SELECT * FROM `File` WHERE `Component_` = 'comp1'", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == 0, "got %u rows\n", count );
+    r = count_query_rows( hdb, 0, "SELECT * FROM `File` WHERE `Component_` = 'comp2'", &count );
+    ok( r == ERROR_SUCCESS, "query failed: %u\n", r );
+    ok( count == files_per_component, "got %u rows\n", count );
+
+    MsiCloseHandle( hdb );
+    DeleteFileA( msifile );
+}
+
 START_TEST(db)
 {
     test_msidatabase();
@@ -9756,4 +9935,5 @@ START_TEST(db)
     test_collation();
     test_embedded_nulls();
     test_select_column_names();
+    test_large_join();
 }
@@ -599,16 +599,168 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+static UINT count_wildcards( const struct expr *expr )
+{
+    switch (expr->type)
+    {
+    case EXPR_WILDCARD:
+        return 1;
+    case EXPR_COMPLEX:
+    case EXPR_STRCMP:
+        return count_wildcards( expr->u.expr.left ) + count_wildcards( expr->u.expr.right );
+    default:
+        return 0;
+    }
+}
+
+static BOOL is_key_column( const struct expr *expr, const JOINTABLE *table, int type )
+{
+    if (type == EXPR_STRCMP)
+    {
+        if (expr->type != EXPR_COL_NUMBER_STRING)
+            return FALSE;
+    }
+    else if (expr->type != EXPR_COL_NUMBER && expr->type != EXPR_COL_NUMBER32)
+        return FALSE;
+    return expr->u.column.parsed.table == table;
+}
+
+static BOOL is_key_value( const struct expr *expr, const UINT rows[] )
+{
+    switch (expr->type)
+    {
+    case EXPR_SVAL:
+    case EXPR_UVAL:
+    case EXPR_WILDCARD:
+        return TRUE;
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+    case EXPR_COL_NUMBER_STRING:
+        return rows[expr->u.column.parsed.table->table_index] != INVALID_ROW_INDEX;
+    default:
+        return FALSE;
+    }
+}
+
+/* looks for an equality between a column of table and a value known from the
+ * parameters or the rows already selected, among the top level AND operands */
+static const struct expr *find_key_expr( const struct expr *cond, const JOINTABLE *table,
+                                         const UINT rows[], UINT *rec_index )
+{
+    const struct expr *left, *right, *ret;
+    UINT start = *rec_index;
+
+    if (cond->type == EXPR_COMPLEX && cond->u.expr.op == OP_AND)
+    {
+        if ((ret = find_key_expr( cond->u.expr.left, table, rows, rec_index )))
+            return ret;
+        /* the left side may have moved the index before failing */
+        *rec_index = start + count_wildcards( cond->u.expr.left );
+        return find_key_expr( cond->u.expr.right, table, rows, rec_index );
+    }
+
+    if ((cond->type != EXPR_COMPLEX && cond->type != EXPR_STRCMP) || cond->u.expr.op != OP_EQ)
+        return NULL;
+
+    left = cond->u.expr.left;
+    right = cond->u.expr.right;
+    if (is_key_column( left, table, cond->type ) && is_key_value( right, rows ))
+        return cond;
+    if (is_key_column( right, table, cond->type ) && is_key_value( left, rows ))
+        return cond;
+    return NULL;
+}
+
+/* returns ERROR_SUCCESS if the rows of the table can be looked up through
+ * the column index, ERROR_NO_MORE_ITEMS if no row can match and
+ * ERROR_CONTINUE if the table has to be scanned */
+static UINT find_key( MSIWHEREVIEW *wv, MSIRECORD *record, const JOINTABLE *table,
+                      const UINT rows[], UINT *column, UINT *key )
+{
+    const struct expr *cond, *col, *value;
+    const WCHAR *str;
+    UINT r, rec_index = 0;
+    INT val;
+
+    if (!wv->cond || !table->view->ops->find_matching_rows)
+        return ERROR_CONTINUE;
+    if (!(cond = find_key_expr( wv->cond, table, rows, &rec_index )))
+        return ERROR_CONTINUE;
+
+    if (is_key_column( cond->u.expr.left, table, cond->type ) &&
+        is_key_value( cond->u.expr.right, rows ))
+    {
+        col = cond->u.expr.left;
+        value = cond->u.expr.right;
+        rec_index += count_wildcards( col );
+    }
+    else
+    {
+        col = cond->u.expr.right;
+        value = cond->u.expr.left;
+    }
+    *column = col->u.column.parsed.column;
+
+    if (cond->type == EXPR_COMPLEX)
+    {
+        wv->rec_index = rec_index;
+        r = WHERE_evaluate( wv, rows, (struct expr *)value, &val, record );
+        if (r != ERROR_SUCCESS)
+            return ERROR_CONTINUE;
+        /* undo the bias applied by WHERE_evaluate to the column values */
+        *key = (UINT)val + (col->type == EXPR_COL_NUMBER32 ? 0x80000000 : 0x8000);
+        return ERROR_SUCCESS;
+    }
+
+    if (value->type == EXPR_COL_NUMBER_STRING)
+    {
+        r = expr_fetch_value( &value->u.column, rows, key );
+        if (r != ERROR_SUCCESS || !*key)
+            return ERROR_CONTINUE;
+        return ERROR_SUCCESS;
+    }
+
+    if (value->type == EXPR_SVAL)
+        str = value->u.sval;
+    else if (value->type == EXPR_WILDCARD && record)
+        str = MSI_RecordGetString( record, rec_index + 1 );
+    else
+        return ERROR_CONTINUE;
+
+    /* empty strings match null columns too */
+    if (!str || !*str)
+        return ERROR_CONTINUE;
+    if (msi_string2id( wv->db->strings, str, -1, key ) != ERROR_SUCCESS)
+        return ERROR_NO_MORE_ITEMS;
+    return ERROR_SUCCESS;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
-    UINT r = ERROR_FUNCTION_FAILED;
+    JOINTABLE *table = *tables;
+    MSIITERHANDLE handle = NULL;
+    UINT r, column = 0, key = 0, row = 0;
+    BOOL indexed;
     INT val;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    r = find_key( wv, record, table, table_rows, &column, &key );
+    if (r == ERROR_NO_MORE_ITEMS)
+        return ERROR_SUCCESS;
+    indexed = (r == ERROR_SUCCESS);
+    r = ERROR_SUCCESS;
+
+    for (;;)
     {
+        if (indexed)
+        {
+            if (table->view->ops->find_matching_rows( table->view, column, key, &row, &handle ) != ERROR_SUCCESS)
+                break;
+        }
+        else if (row >= table->row_count)
+            break;
+
+        table_rows[table->table_index] = row++;
         val = 0;
         wv->rec_index = 0;
         r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
@@ -630,7 +782,7 @@ static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **ta
             }
         }
     }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
+    table_rows[table->table_index] = INVALID_ROW_INDEX;
     return r;
 }
 
@@ -216,6 +216,45 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static RTL_CRITICAL_SECTION dir_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* cache of directory contents used for case-insensitive lookups */
+struct lookup_cache_name
+{
+    ULONG        hash;          /* hash of the upper-case Unicode name */
+    int          len;           /* length of the Unicode name */
+    const WCHAR *nameW;         /* Unicode name */
+    const char  *unix_name;     /* corresponding Unix name */
+};
+
+struct lookup_cache
+{
+    struct list               entry;     /* entry in lookup_cache_list, most recently used first */
+    dev_t                     dev;       /* device and inode of the directory */
+    ino_t                     ino;
+    time_t                    mtime;     /* directory times when it was scanned */
+    time_t                    ctime;
+    unsigned int              count;     /* number of names */
+    unsigned int              mask;      /* size of the hash table - 1 */
+    int                      *table;     /* hash table of indices into names, -1 if empty */
+    char                     *data;      /* storage for the names */
+    struct lookup_cache_name  names[1];
+};
+
+#define LOOKUP_CACHE_MAX_DIRS 128
+
+static struct list lookup_cache_list = LIST_INIT( lookup_cache_list );
+static unsigned int lookup_cache_dirs;
+static unsigned int lookup_cache_hits, lookup_cache_misses, lookup_cache_scans;
+static ULONGLONG lookup_cache_scanned_names, lookup_cache_scan_time;
+
+static RTL_CRITICAL_SECTION lookup_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG lookup_cache_critsect_debug =
+{
+    0, 0, &lookup_cache_section,
+    { &lookup_cache_critsect_debug.ProcessLocksList, &lookup_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": lookup_cache_section") }
+};
+static RTL_CRITICAL_SECTION lookup_cache_section = { &lookup_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
 
 /* check if a given Unicode char is OK in a DOS short name */
 static inline BOOL is_invalid_dos_char( WCHAR ch )
@@ -2024,6 +2063,202 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 }
 
 
+/* case-insensitive hash of a Unicode name */
+static inline ULONG hash_lookup_name( const WCHAR *name, int len )
+{
+    ULONG hash = 0;
+    while (len--) hash = hash * 31 + toupperW( *name++ );
+    return hash;
+}
+
+static void free_lookup_cache( struct lookup_cache *cache )
+{
+    RtlFreeHeap( GetProcessHeap(), 0, cache->table );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->data );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+
+/***********************************************************************
+ *           scan_lookup_cache
+ *
+ * Read the contents of a directory into a new lookup cache.
+ */
+static struct lookup_cache *scan_lookup_cache( const char *unix_name, const struct stat *st )
+{
+    struct lookup_cache *cache, *new_cache;
+    LARGE_INTEGER start, end, freq;
+    unsigned int i, pos = 0, size = 64, data_pos = 0, data_size = 4096;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dirent *de;
+    char *data, *new_data;
+    DIR *dir;
+    int len, ret;
+
+    if (!(dir = opendir( unix_name ))) return NULL;
+    NtQueryPerformanceCounter( &start, &freq );
+
+    cache = RtlAllocateHeap( GetProcessHeap(), 0, FIELD_OFFSET( struct lookup_cache, names[size] ));
+    data = RtlAllocateHeap( GetProcessHeap(), 0, data_size );
+    if (!cache || !data) goto error;
+
+    while ((de = readdir( dir )))
+    {
+        len = strlen( de->d_name );
+        if ((ret = ntdll_umbstowcs( 0, de->d_name, len, buffer, MAX_DIR_ENTRY_LEN )) <= 0) continue;
+
+        if (pos == size)
+        {
+            size *= 2;
+            if (!(new_cache = RtlReAllocateHeap( GetProcessHeap(), 0, cache,
+                                                 FIELD_OFFSET( struct lookup_cache, names[size] ))))
+                goto error;
+            cache = new_cache;
+        }
+        while (data_pos + ret * sizeof(WCHAR) + len + 1 > data_size)
+        {
+            data_size *= 2;
+            if (!(new_data = RtlReAllocateHeap( GetProcessHeap(), 0, data, data_size ))) goto error;
+            data = new_data;
+        }
+        /* store offsets for now, the buffer may still move */
+        cache->names[pos].hash = hash_lookup_name( buffer, ret );
+        cache->names[pos].len = ret;
+        cache->names[pos].nameW = (const WCHAR *)(ULONG_PTR)data_pos;
+        memcpy( data + data_pos, buffer, ret * sizeof(WCHAR) );
+        data_pos += ret * sizeof(WCHAR);
+        cache->names[pos].unix_name = (const char *)(ULONG_PTR)data_pos;
+        memcpy( data + data_pos, de->d_name, len + 1 );
+        data_pos += (len + sizeof(WCHAR)) & ~(sizeof(WCHAR) - 1);
+        pos++;
+    }
+    closedir( dir );
+    dir = NULL;
+
+    cache->dev   = st->st_dev;
+    cache->ino   = st->st_ino;
+    cache->mtime = st->st_mtime;
+    cache->ctime = st->st_ctime;
+    cache->count = pos;
+    cache->data  = data;
+    for (cache->mask = 15; cache->mask < 2 * pos; cache->mask = cache->mask * 2 + 1) ;
+    if (!(cache->table = RtlAllocateHeap( GetProcessHeap(), 0, (cache->mask + 1) * sizeof(int) )))
+        goto error;
+    memset( cache->table, 0xff, (cache->mask + 1) * sizeof(int) );
+
+    for (i = 0; i < pos; i++)
+    {
+        unsigned int index = cache->names[i].hash & cache->mask;
+
+        cache->names[i].nameW = (const WCHAR *)(data + (ULONG_PTR)cache->names[i].nameW);
+        cache->names[i].unix_name = data + (ULONG_PTR)cache->names[i].unix_name;
+        while (cache->table[index] != -1) index = (index + 1) & cache->mask;
+        cache->table[index] = i;
+    }
+
+    NtQueryPerformanceCounter( &end, NULL );
+    lookup_cache_scans++;
+    lookup_cache_scanned_names += pos;
+    lookup_cache_scan_time += (end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart;
+    TRACE( "scanned %s: %u names; total %u hits %u misses %u scans, %s names in %s us\n",
+           debugstr_a(unix_name), pos, lookup_cache_hits, lookup_cache_misses, lookup_cache_scans,
+           wine_dbgstr_longlong(lookup_cache_scanned_names), wine_dbgstr_longlong(lookup_cache_scan_time) );
+    return cache;
+
+error:
+    if (dir) closedir( dir );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+    RtlFreeHeap( GetProcessHeap(), 0, data );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           find_file_in_lookup_cache
+ *
+ * Find a file in a directory using the cached directory contents.
+ * The file found is appended to unix_name at pos.
+ * Returns 1 if found, 0 if not found, -1 if the cache can't tell.
+ */
+static int find_file_in_lookup_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                      BOOLEAN check_short_names )
+{
+    struct lookup_cache *cache;
+    struct stat st;
+    ULONG hash;
+    unsigned int index;
+    int ret = -1;
+    BOOL valid = FALSE;
+
+    if (stat( unix_name, &st ) == -1) return -1;
+
+    RtlEnterCriticalSection( &lookup_cache_section );
+
+    LIST_FOR_EACH_ENTRY( cache, &lookup_cache_list, struct lookup_cache, entry )
+    {
+        if (cache->dev != st.st_dev || cache->ino != st.st_ino) continue;
+        list_remove( &cache->entry );
+        if (cache->mtime == st.st_mtime && cache->ctime == st.st_ctime)
+        {
+            list_add_head( &lookup_cache_list, &cache->entry );
+            valid = TRUE;
+        }
+        else  /* directory has changed */
+        {
+            free_lookup_cache( cache );
+            lookup_cache_dirs--;
+        }
+        break;
+    }
+
+    if (!valid)
+    {
+        time_t now = time( NULL );
+
+        if (!(cache = scan_lookup_cache( unix_name, &st ))) goto done;
+        /* changes in the same second as the scan wouldn't modify the times, so the */
+        /* contents can only be used for this lookup */
+        if (st.st_mtime < now && st.st_ctime < now)
+        {
+            list_add_head( &lookup_cache_list, &cache->entry );
+            if (++lookup_cache_dirs > LOOKUP_CACHE_MAX_DIRS)
+            {
+                struct lookup_cache *old = LIST_ENTRY( list_tail( &lookup_cache_list ), struct lookup_cache, entry );
+                list_remove( &old->entry );
+                free_lookup_cache( old );
+                lookup_cache_dirs--;
+            }
+            valid = TRUE;
+        }
+    }
+
+    hash = hash_lookup_name( name, length );
+    for (index = hash & cache->mask; cache->table[index] != -1; index = (index + 1) & cache->mask)
+    {
+        const struct lookup_cache_name *entry = &cache->names[cache->table[index]];
+
+        if (entry->hash != hash || entry->len != length || memicmpW( entry->nameW, name, length )) continue;
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, entry->unix_name );
+        ret = 1;
+        break;
+    }
+    if (ret == -1)
+    {
+        lookup_cache_misses++;
+        /* hashed short names are not cached, they always contain a '~' */
+        if (!check_short_names || !memchrW( name, '~', length )) ret = 0;
+    }
+    else lookup_cache_hits++;
+
+    if (!valid) free_lookup_cache( cache );
+
+done:
+    RtlLeaveCriticalSection( &lookup_cache_section );
+    return ret;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2075,6 +2310,14 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
+    /* try the cached directory contents */
+
+    switch (find_file_in_lookup_cache( unix_name, pos, name, length, is_name_8_dot_3 ))
+    {
+    case 1: goto success;
+    case 0: goto not_found;
+    }
+
     /* now look for it through the directory */
 
 #ifdef VFAT_IOCTL_READDIR_BOTH
@@ -712,6 +712,7 @@ static NTSTATUS get_io_timeouts( HANDLE handle, enum server_fd_type type, ULONG
         break;
     case FD_TYPE_SOCKET:
     case FD_TYPE_CHAR:
+    case FD_TYPE_PIPE:
         if (is_read) timeouts->interval = 0;  /* return as soon as we got something */
         break;
     default:
@@ -764,6 +765,7 @@ static NTSTATUS get_io_avail_mode( HANDLE handle, enum server_fd_type type, BOOL
     case FD_TYPE_MAILSLOT:
     case FD_TYPE_SOCKET:
     case FD_TYPE_CHAR:
+    case FD_TYPE_PIPE:
         *avail_mode = TRUE;
         break;
     default:
@@ -933,6 +935,14 @@ NTSTATUS WINAPI NtReadFile(HANDLE hFile, HANDLE hEvent,
                         goto done;
                     }
                     break;
+                case FD_TYPE_PIPE:
+                    if (!length)
+                    {
+                        status = STATUS_SUCCESS;
+                        goto done;
+                    }
+                    status = STATUS_PIPE_BROKEN;
+                    goto err;
                 default:
                     status = STATUS_PIPE_BROKEN;
                     goto err;
@@ -1302,7 +1312,7 @@ NTSTATUS WINAPI NtWriteFile(HANDLE hFile, HANDLE hEvent,
     for (;;)
     {
         /* zero-length writes on sockets may not work with plain write(2) */
-        if (!length && (type == FD_TYPE_MAILSLOT || type == FD_TYPE_SOCKET))
+        if (!length && (type == FD_TYPE_MAILSLOT || type == FD_TYPE_SOCKET || type == FD_TYPE_PIPE))
             result = send( unix_handle, buffer, 0, 0 );
         else
             result = write( unix_handle, (const char *)buffer + total, length - total );
@@ -3500,6 +3510,19 @@ NTSTATUS WINAPI NtUnlockFile( HANDLE hFile, PIO_STATUS_BLOCK io_status,
     return status;
 }
 
+/* the data of byte mode pipes created by this process goes through a socketpair, on request */
+static BOOL pipe_direct_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEPIPEDIRECT" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
 /******************************************************************
  *		NtCreateNamedPipeFile    (NTDLL.@)
  *
@@ -3538,7 +3561,8 @@ NTSTATUS WINAPI NtCreateNamedPipeFile( PHANDLE handle, ULONG access,
         req->flags = 
             (pipe_type ? NAMED_PIPE_MESSAGE_STREAM_WRITE   : 0) |
             (read_mode ? NAMED_PIPE_MESSAGE_STREAM_READ    : 0) |
-            (completion_mode ? NAMED_PIPE_NONBLOCKING_MODE : 0);
+            (completion_mode ? NAMED_PIPE_NONBLOCKING_MODE : 0) |
+            (pipe_direct_enabled() ? NAMED_PIPE_DIRECT     : 0);
         req->maxinstances = max_inst;
         req->outsize = outbound_quota;
         req->insize  = inbound_quota;
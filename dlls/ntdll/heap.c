@@ -85,6 +85,7 @@ typedef struct
 #define ARENA_PENDING_MAGIC    0xbedead
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
+#define ARENA_LFH_MAGIC        0x48464c    /* block cached by the low-fragmentation front end */
 
 #define ARENA_INUSE_FILLER     0x55
 #define ARENA_TAIL_FILLER      0xab
@@ -132,6 +133,26 @@ typedef union
     void       *alignment[4];
 } FREE_LIST_ENTRY;
 
+/* The low-fragmentation front end caches freed small blocks on lock-free lists, one per
+ * arena size, so that they can be reused without taking the heap lock. Cached blocks
+ * remain in-use arenas for the rest of the heap code. There are several sets of lists,
+ * threads being spread across them to reduce contention. */
+#define HEAP_LFH_MAX_SIZE     0x400  /* largest arena size handled by the front end */
+#define HEAP_LFH_NB_LISTS     (HEAP_LFH_MAX_SIZE / ALIGNMENT + 1)
+#define HEAP_LFH_AFFINITY     4      /* number of sets of lists */
+#define HEAP_LFH_MAX_DEPTH    64     /* max number of blocks cached on a list */
+#define HEAP_LFH_MAX_REGIONS  64     /* max number of sub-heaps whose blocks can be cached */
+
+typedef struct
+{
+    SLIST_HEADER lists[HEAP_LFH_AFFINITY][HEAP_LFH_NB_LISTS];
+    struct
+    {
+        const char *start;           /* first arena of the sub-heap */
+        const char *end;             /* end of the sub-heap */
+    } regions[HEAP_LFH_MAX_REGIONS]; /* sub-heaps, updated under the heap lock */
+} HEAP_LFH;
+
 struct tagHEAP;
 
 typedef struct tagSUBHEAP
@@ -164,6 +185,7 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    HEAP_LFH        *lfh;           /* Low-fragmentation front end, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -178,6 +200,10 @@ typedef struct tagHEAP
 #define HEAP_VALIDATE_ALL     0x20000000
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
+/* the front end bypasses the checks done by these flags */
+#define HEAP_LFH_UNSUPPORTED_FLAGS (HEAP_NO_SERIALIZE | HEAP_TAIL_CHECKING_ENABLED | \
+                                    HEAP_FREE_CHECKING_ENABLED | HEAP_PAGE_ALLOCS | HEAP_VALIDATE)
+
 static HEAP *processHeap;  /* main process heap */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
@@ -296,7 +322,7 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_LFH_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -515,6 +541,63 @@ static SUBHEAP *HEAP_FindSubHeap(
 }
 
 
+/***********************************************************************
+ *           lfh_add_region
+ *
+ * Let the front end cache the blocks of a sub-heap. Must be called with the heap lock held.
+ */
+static void lfh_add_region( HEAP_LFH *lfh, const SUBHEAP *subheap )
+{
+    unsigned int i;
+
+    for (i = 0; i < HEAP_LFH_MAX_REGIONS; i++)
+    {
+        if (lfh->regions[i].start) continue;
+        lfh->regions[i].end = (const char *)subheap->base + subheap->size;
+        lfh->regions[i].start = (const char *)subheap->base + subheap->headerSize;
+        return;
+    }
+    /* blocks of that sub-heap will simply bypass the front end */
+}
+
+
+/***********************************************************************
+ *           lfh_remove_region
+ *
+ * Forget about a sub-heap that is being freed. Must be called with the heap lock held.
+ */
+static void lfh_remove_region( HEAP_LFH *lfh, const SUBHEAP *subheap )
+{
+    unsigned int i;
+
+    for (i = 0; i < HEAP_LFH_MAX_REGIONS; i++)
+    {
+        if (lfh->regions[i].start != (const char *)subheap->base + subheap->headerSize) continue;
+        lfh->regions[i].start = NULL;
+        lfh->regions[i].end = NULL;
+        return;
+    }
+}
+
+
+/***********************************************************************
+ *           lfh_find_region
+ *
+ * Check without taking the heap lock that an arena is inside one of the sub-heaps.
+ */
+static BOOL lfh_find_region( const HEAP_LFH *lfh, const ARENA_INUSE *arena )
+{
+    unsigned int i;
+
+    for (i = 0; i < HEAP_LFH_MAX_REGIONS; i++)
+    {
+        const char *start = lfh->regions[i].start, *end = lfh->regions[i].end;
+        if ((const char *)arena >= start && (const char *)(arena + 1) <= end) return TRUE;
+    }
+    return FALSE;
+}
+
+
 /***********************************************************************
  *           HEAP_Commit
  *
@@ -680,6 +763,7 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
         list_remove( &pFree->entry );
         /* Remove the subheap from the list */
         list_remove( &subheap->entry );
+        if (subheap->heap->lfh) lfh_remove_region( subheap->heap->lfh, subheap );
         /* Free the memory */
         subheap->magic = 0;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -870,6 +954,179 @@ static BOOL validate_large_arena( HEAP *heap, const ARENA_LARGE *arena, BOOL qui
 }
 
 
+/***********************************************************************
+ *           lfh_switch_block
+ *
+ * Atomically change the magic of a block, fails if it's not in the expected state.
+ */
+static inline BOOL lfh_switch_block( ARENA_INUSE *arena, DWORD from, DWORD to, SIZE_T unused )
+{
+    union { ARENA_INUSE arena; LONG dw[2]; } old, new;
+
+    old.arena = *arena;
+    if (old.arena.magic != from) return FALSE;
+    new = old;
+    new.arena.magic = to;
+    new.arena.unused_bytes = unused;
+    /* the size field may be modified concurrently by the back end, only touch the magic */
+    return interlocked_cmpxchg( (LONG *)arena + 1, new.dw[1], old.dw[1] ) == old.dw[1];
+}
+
+
+/***********************************************************************
+ *           lfh_get_lists
+ *
+ * Get the set of lists used by the current thread.
+ */
+static inline SLIST_HEADER *lfh_get_lists( HEAP_LFH *lfh, unsigned int offset )
+{
+    ULONG tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    return lfh->lists[((tid >> 2) + offset) % HEAP_LFH_AFFINITY];
+}
+
+
+/***********************************************************************
+ *           lfh_alloc
+ *
+ * Allocate a block from the front end; return NULL if no cached block is available.
+ */
+static void *lfh_alloc( HEAP_LFH *lfh, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    unsigned int i;
+
+    for (i = 0; i < HEAP_LFH_AFFINITY; i++)
+    {
+        SLIST_HEADER *list = &lfh_get_lists( lfh, i )[rounded_size / ALIGNMENT];
+        SLIST_ENTRY *entry;
+        ARENA_INUSE *arena;
+
+        if (!RtlQueryDepthSList( list ) || !(entry = RtlInterlockedPopEntrySList( list ))) continue;
+
+        arena = (ARENA_INUSE *)entry - 1;
+        if (!lfh_switch_block( arena, ARENA_LFH_MAGIC, ARENA_INUSE_MAGIC,
+                               (arena->size & ARENA_SIZE_MASK) - size ))
+        {
+            ERR( "cached block %p has been corrupted\n", entry );
+            continue;
+        }
+        initialize_block( arena + 1, size, arena->unused_bytes, flags );
+        return arena + 1;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           lfh_free
+ *
+ * Cache a block in the front end; return FALSE if it has to be freed by the back end,
+ * which also takes care of reporting invalid pointers. The arena is only accessed once
+ * it is known to be inside one of the sub-heaps.
+ */
+static BOOL lfh_free( HEAP_LFH *lfh, ARENA_INUSE *arena )
+{
+    SLIST_HEADER *list;
+    SIZE_T size;
+
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+    if (!lfh_find_region( lfh, arena )) return FALSE;
+    if (arena->size & ARENA_FLAG_FREE) return FALSE;
+    if ((size = arena->size & ARENA_SIZE_MASK) > HEAP_LFH_MAX_SIZE) return FALSE;
+
+    list = &lfh_get_lists( lfh, 0 )[size / ALIGNMENT];
+    if (RtlQueryDepthSList( list ) >= HEAP_LFH_MAX_DEPTH) return FALSE;
+    if (!lfh_switch_block( arena, ARENA_INUSE_MAGIC, ARENA_LFH_MAGIC, 0 )) return FALSE;
+
+    RtlInterlockedPushEntrySList( list, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           lfh_enable
+ *
+ * Enable the low-fragmentation front end of a heap.
+ */
+static NTSTATUS lfh_enable( HEAP *heap )
+{
+    void *ptr = NULL;
+    SIZE_T size = sizeof(HEAP_LFH);
+    SUBHEAP *subheap;
+    NTSTATUS status;
+
+    if (heap->lfh) return STATUS_SUCCESS;
+    if ((heap->flags & HEAP_LFH_UNSUPPORTED_FLAGS) || RUNNING_ON_VALGRIND) return STATUS_UNSUCCESSFUL;
+
+    if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &size, MEM_COMMIT, PAGE_READWRITE )))
+        return status;
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lfh)
+    {
+        LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+            lfh_add_region( ptr, subheap );
+        heap->lfh = ptr;
+        ptr = NULL;
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    if (ptr)  /* already enabled by another thread */
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &size, MEM_RELEASE );
+    }
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           lfh_disable
+ *
+ * Disable the front end and give the cached blocks back to the heap.
+ * Only used during process initialization, when debug flags are set.
+ */
+static void lfh_disable( HEAP *heap )
+{
+    HEAP_LFH *lfh = heap->lfh;
+    SLIST_ENTRY *entry;
+    SIZE_T size = 0;
+    void *addr = lfh;
+    unsigned int i, j;
+
+    heap->lfh = NULL;
+    for (i = 0; i < HEAP_LFH_AFFINITY; i++)
+    {
+        for (j = 0; j < HEAP_LFH_NB_LISTS; j++)
+        {
+            while ((entry = RtlInterlockedPopEntrySList( &lfh->lists[i][j] )))
+            {
+                lfh_switch_block( (ARENA_INUSE *)entry - 1, ARENA_LFH_MAGIC, ARENA_INUSE_MAGIC, 0 );
+                RtlFreeHeap( heap, 0, entry );
+            }
+        }
+    }
+    NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+}
+
+
+/***********************************************************************
+ *           lfh_enabled_by_default
+ *
+ * Check whether the front end should be enabled for all heaps.
+ */
+static BOOL lfh_enabled_by_default(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEHEAPLFH" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
+
 /***********************************************************************
  *           HEAP_CreateSubHeap
  */
@@ -916,6 +1173,7 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
         list_add_head( &heap->subheap_list, &subheap->entry );
+        if (heap->lfh) lfh_add_region( heap->lfh, subheap );
     }
     else
     {
@@ -1214,7 +1472,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_LFH_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1429,7 +1688,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_LFH_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1473,6 +1732,8 @@ void heap_set_debug_flags( HANDLE handle )
 
     if (RUNNING_ON_VALGRIND) flags = 0; /* no sense in validating since Valgrind catches accesses */
 
+    if ((flags & HEAP_LFH_UNSUPPORTED_FLAGS) && heap->lfh) lfh_disable( heap );
+
     heap->flags |= flags;
     heap->force_flags |= flags & ~(HEAP_VALIDATE | HEAP_DISABLE_COALESCE_ON_FREE);
 
@@ -1563,6 +1824,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T totalSize, SIZE_T c
     if (!(subheap = HEAP_CreateSubHeap( NULL, addr, flags, commitSize, totalSize ))) return 0;
 
     heap_set_debug_flags( subheap->heap );
+    if (lfh_enabled_by_default()) lfh_enable( subheap->heap );
 
     /* link it into the per-process heap list */
     if (processHeap)
@@ -1638,6 +1900,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh)
+    {
+        size = 0;
+        addr = heapPtr->lfh;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1683,6 +1951,16 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && rounded_size <= HEAP_LFH_MAX_SIZE)
+    {
+        void *ret = lfh_alloc( heapPtr->lfh, flags, size, rounded_size );
+        if (ret)
+        {
+            TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+            return ret;
+        }
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1766,13 +2044,20 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+    if (heapPtr->lfh && lfh_free( heapPtr->lfh, pInUse ))
+    {
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
@@ -2133,7 +2418,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2181,7 +2467,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_LFH_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2246,6 +2532,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2254,7 +2542,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        *(ULONG *)info = (heapPtr && heapPtr->lfh) ? 2 : 0; /* low-fragmentation or standard heap */
         return STATUS_SUCCESS;
 
     default:
@@ -2268,6 +2557,27 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        TRACE("%p: compatibility %u\n", heap, *(ULONG *)info );
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* the front end can't be disabled once enabled */
+            return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:
+            return lfh_enable( heapPtr );
+        default:
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
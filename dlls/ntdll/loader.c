@@ -23,10 +23,18 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdio.h>
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_DLFCN_H
+# include <dlfcn.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -38,6 +46,7 @@
 
 #include "wine/exception.h"
 #include "wine/library.h"
+#include "wine/list.h"
 #include "wine/unicode.h"
 #include "wine/debug.h"
 #include "wine/server.h"
@@ -49,6 +58,7 @@ WINE_DECLARE_DEBUG_CHANNEL(relay);
 WINE_DECLARE_DEBUG_CHANNEL(snoop);
 WINE_DECLARE_DEBUG_CHANNEL(loaddll);
 WINE_DECLARE_DEBUG_CHANNEL(imports);
+WINE_DECLARE_DEBUG_CHANNEL(loadtime);
 
 #ifdef _WIN64
 #define DEFAULT_SECURITY_COOKIE_64  (((ULONGLONG)0x00002b99 << 32) | 0x2ddfa232)
@@ -83,6 +93,23 @@ static const char * const reason_names[] =
 
 static const WCHAR dllW[] = {'.','d','l','l',0};
 
+/* hash table of the names exported by a module */
+struct export_hash
+{
+    unsigned int mask;      /* size of the table - 1 */
+    DWORD        table[1];  /* index in the names array + 1, 0 for empty buckets */
+};
+
+/* identity of a builtin module in the import snapshot */
+struct snapshot_module
+{
+    ULONGLONG base;   /* address of the module */
+    ULONGLONG dev;    /* device and inode of the .so file */
+    ULONGLONG ino;
+    ULONGLONG size;   /* size and modification time of the .so file */
+    ULONGLONG mtime;
+};
+
 /* internal representation of 32bit modules. per process. */
 typedef struct _wine_modref
 {
@@ -92,6 +119,8 @@ typedef struct _wine_modref
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
+    struct export_hash   *export_hash;
+    struct snapshot_module snapshot;
 } WINE_MODREF;
 
 /* info about the current builtin dll load */
@@ -122,6 +151,7 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 static RTL_CRITICAL_SECTION loader_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
 static WINE_MODREF *cached_modref;
+static ULONGLONG load_time_nested;  /* time spent in nested loads, for the loadtime channel */
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
@@ -138,6 +168,40 @@ static inline void *get_rva( HMODULE module, DWORD va )
     return (void *)((char *)module + va);
 }
 
+/* get the current time in microseconds, for the loadtime channel */
+static ULONGLONG get_load_time(void)
+{
+    LARGE_INTEGER counter, freq;
+
+    NtQueryPerformanceCounter( &counter, &freq );
+    return counter.QuadPart / freq.QuadPart * 1000000 +
+           counter.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart;
+}
+
+/* start timing a load or init phase; return 0 if the loadtime channel is disabled */
+static ULONGLONG start_load_time( ULONGLONG *nested )
+{
+    if (!TRACE_ON(loadtime)) return 0;
+    *nested = load_time_nested;
+    load_time_nested = 0;
+    return get_load_time();
+}
+
+/* finish timing a phase started with start_load_time, and trace it if a name is given */
+static void end_load_time( const WCHAR *name, const char *phase, const char *type, NTSTATUS status,
+                           ULONGLONG start, ULONGLONG nested )
+{
+    ULONGLONG total;
+
+    if (!start) return;
+    total = get_load_time() - start;
+    if (name)
+        TRACE_(loadtime)( "phase=%s dll=%s type=%s status=%08x total_us=%s self_us=%s\n",
+                          phase, debugstr_w(name), type, status, wine_dbgstr_longlong(total),
+                          wine_dbgstr_longlong(total - load_time_nested) );
+    load_time_nested = nested + total;
+}
+
 /* check whether the file name contains a path */
 static inline BOOL contains_path( LPCWSTR name )
 {
@@ -572,6 +636,50 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+/* hash function for export names (FNV-1a) */
+static inline unsigned int hash_export_name( const char *name )
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name) hash = (hash ^ (unsigned char)*name++) * 16777619;
+    return hash;
+}
+
+/*************************************************************************
+ *		get_export_hash
+ *
+ * Get the export names hash table of a module, NULL for small export tables.
+ * The loader_section must be locked while calling this function.
+ */
+static const struct export_hash *get_export_hash( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    struct export_hash *hash;
+    WINE_MODREF *wm;
+    unsigned int i, pos, mask;
+
+    if (exports->NumberOfNames < 64) return NULL;
+    if (!(wm = get_modref( module ))) return NULL;
+    if (wm->export_hash) return wm->export_hash;
+
+    for (mask = 127; mask < 2 * exports->NumberOfNames - 1; mask = mask * 2 + 1) ;
+    if (!(hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                  offsetof( struct export_hash, table[mask + 1] ))))
+        return NULL;
+    hash->mask = mask;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( module, names[i] )) & mask;
+        while (hash->table[pos]) pos = (pos + 1) & mask;
+        hash->table[pos] = i + 1;
+    }
+    TRACE( "built export hash for %s: %u names\n",
+           debugstr_w(wm->ldr.BaseDllName.Buffer), exports->NumberOfNames );
+    return wm->export_hash = hash;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -583,6 +691,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 {
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
+    const struct export_hash *hash;
     int min = 0, max = exports->NumberOfNames - 1;
 
     /* first check the hint */
@@ -593,7 +702,21 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
+    /* then look it up in the hash table */
+    if ((hash = get_export_hash( module, exports )))
+    {
+        unsigned int pos = hash_export_name( name ) & hash->mask;
+
+        for ( ; hash->table[pos]; pos = (pos + 1) & hash->mask)
+        {
+            DWORD idx = hash->table[pos] - 1;
+            if (!strcmp( get_rva( module, names[idx] ), name ))
+                return find_ordinal_export( module, exports, exp_size, ordinals[idx], load_path );
+        }
+        return NULL;
+    }
+
+    /* otherwise do a binary search */
     while (min <= max)
     {
         int res, pos = (min + max) / 2;
@@ -608,6 +731,331 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 }
 
 
+/*
+ * The import snapshot is a cache in the prefix of the resolved import address tables
+ * of builtin modules. It is written by a process once its dlls are attached, and used by
+ * the next ones as long as both the importing and the imported modules are the same files
+ * loaded at the same addresses, which is normally the case for the core dlls.
+ */
+
+#define IMPORT_SNAPSHOT_MAGIC    0x70616e73  /* "snap" */
+#define IMPORT_SNAPSHOT_VERSION  1
+#define IMPORT_SNAPSHOT_MAX_SIZE (1024 * 1024)
+
+struct snapshot_header
+{
+    DWORD magic;          /* IMPORT_SNAPSHOT_MAGIC */
+    DWORD version;        /* IMPORT_SNAPSHOT_VERSION */
+    DWORD count;          /* number of records */
+    DWORD size;           /* total size of the records */
+    char  build_id[64];   /* Wine build that wrote the snapshot */
+};
+
+/* resolved import address table of an import descriptor */
+struct snapshot_record
+{
+    struct snapshot_module module;   /* importing module */
+    struct snapshot_module import;   /* imported module */
+    DWORD                  descr;    /* rva of the import descriptor */
+    DWORD                  count;    /* number of entries in the address table */
+    ULONGLONG              thunks[1];
+};
+
+/* record resolved by the current process, to be saved in the snapshot */
+struct pending_record
+{
+    struct list            entry;
+    struct snapshot_record rec;
+};
+
+static char *snapshot_data;      /* records loaded from the snapshot file */
+static DWORD snapshot_size;
+static BOOL snapshot_done;       /* the startup dlls are attached, stop recording */
+static const char *snapshot_path; /* file set with WINEIMPORTSNAPSHOT, instead of the prefix one */
+static struct list pending_records = LIST_INIT( pending_records );
+
+/* the import snapshot is written to the prefix, or to the absolute path
+ * WINEIMPORTSNAPSHOT is set to, and is only enabled on request */
+static BOOL import_snapshot_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+#ifdef HAVE_DLADDR
+        const char *env = getenv( "WINEIMPORTSNAPSHOT" );
+        /* relay and snoop thunks are allocated at run time */
+        enabled = env && (atoi( env ) || env[0] == '/') && !TRACE_ON(relay) && !TRACE_ON(snoop);
+        if (enabled && env[0] == '/') snapshot_path = env;
+#else
+        enabled = 0;
+#endif
+    }
+    return enabled;
+}
+
+/* get the identity of a builtin module, given an address inside its .so file */
+static BOOL get_snapshot_module( WINE_MODREF *wm, const void *addr, struct snapshot_module *id )
+{
+#ifdef HAVE_DLADDR
+    Dl_info info;
+    struct stat st;
+
+    if (!wm->snapshot.base)
+    {
+        if (!(wm->ldr.Flags & LDR_WINE_INTERNAL)) return FALSE;
+        if (!dladdr( addr, &info ) || !info.dli_fname || info.dli_fname[0] != '/') return FALSE;
+        if (stat( info.dli_fname, &st ) == -1) return FALSE;
+        wm->snapshot.dev   = st.st_dev;
+        wm->snapshot.ino   = st.st_ino;
+        wm->snapshot.size  = st.st_size;
+        wm->snapshot.mtime = st.st_mtime;
+        wm->snapshot.base  = (ULONG_PTR)wm->ldr.BaseAddress;
+    }
+    *id = wm->snapshot;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+static char *get_snapshot_file_name( const char *suffix )
+{
+    static const char name[] = "/.import-snapshot";
+    const char *dir = snapshot_path ? snapshot_path : wine_get_config_dir();
+    char *ret;
+
+    if (!(ret = RtlAllocateHeap( GetProcessHeap(), 0, strlen(dir) + sizeof(name) + strlen(suffix) )))
+        return NULL;
+    strcpy( ret, dir );
+    if (!snapshot_path) strcat( ret, name );
+    strcat( ret, suffix );
+    return ret;
+}
+
+/* load the snapshot file, if it was written by the same Wine build */
+static void load_import_snapshot(void)
+{
+    static BOOL loaded;
+    struct snapshot_header header;
+    char *name;
+    int fd;
+
+    if (loaded) return;
+    loaded = TRUE;
+
+    if (!(name = get_snapshot_file_name( "" ))) return;
+    if ((fd = open( name, O_RDONLY )) != -1)
+    {
+        if (read( fd, &header, sizeof(header) ) == sizeof(header) &&
+            header.magic == IMPORT_SNAPSHOT_MAGIC &&
+            header.version == IMPORT_SNAPSHOT_VERSION &&
+            header.size <= IMPORT_SNAPSHOT_MAX_SIZE &&
+            !strncmp( header.build_id, wine_get_build_id(), sizeof(header.build_id) ) &&
+            (snapshot_data = RtlAllocateHeap( GetProcessHeap(), 0, header.size )))
+        {
+            if (read( fd, snapshot_data, header.size ) == header.size)
+            {
+                snapshot_size = header.size;
+                TRACE_(imports)( "loaded %u records from %s\n", header.count, debugstr_a(name) );
+            }
+            else
+            {
+                RtlFreeHeap( GetProcessHeap(), 0, snapshot_data );
+                snapshot_data = NULL;
+            }
+        }
+        close( fd );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, name );
+}
+
+static inline SIZE_T snapshot_record_size( const struct snapshot_record *rec )
+{
+    return offsetof( struct snapshot_record, thunks[rec->count] );
+}
+
+/* return the next record of the snapshot data, or NULL at the end */
+static const struct snapshot_record *next_snapshot_record( const char **ptr )
+{
+    const struct snapshot_record *rec = (const struct snapshot_record *)*ptr;
+    SIZE_T left = snapshot_data + snapshot_size - *ptr;
+
+    if (left < offsetof( struct snapshot_record, thunks )) return NULL;
+    if (rec->count > (left - offsetof( struct snapshot_record, thunks )) / sizeof(rec->thunks[0]))
+        return NULL;
+    *ptr += snapshot_record_size( rec );
+    return rec;
+}
+
+/*************************************************************************
+ *		apply_import_snapshot
+ *
+ * Fill the import address table of a descriptor from the snapshot.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL apply_import_snapshot( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr,
+                                   WINE_MODREF *imp, const IMAGE_EXPORT_DIRECTORY *exports,
+                                   IMAGE_THUNK_DATA *thunk_list, DWORD count )
+{
+    struct snapshot_module id, imp_id;
+    const struct snapshot_record *rec;
+    const char *ptr;
+    DWORD i, rva = (const char *)descr - (const char *)module;
+
+    if (!import_snapshot_enabled()) return FALSE;
+    load_import_snapshot();
+    if (!snapshot_data) return FALSE;
+    if (!get_snapshot_module( current_modref, descr, &id )) return FALSE;
+    if (!get_snapshot_module( imp, exports, &imp_id )) return FALSE;
+
+    ptr = snapshot_data;
+    while ((rec = next_snapshot_record( &ptr )))
+    {
+        if (rec->descr != rva || memcmp( &rec->module, &id, sizeof(id) )) continue;
+        if (rec->count != count || memcmp( &rec->import, &imp_id, sizeof(imp_id) )) return FALSE;
+        for (i = 0; i < count; i++) thunk_list[i].u1.Function = rec->thunks[i];
+        TRACE_(imports)( "--- %u entries for %s from snapshot\n", count,
+                         debugstr_w(imp->ldr.BaseDllName.Buffer) );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*************************************************************************
+ *		record_import_snapshot
+ *
+ * Remember the resolved import address table of a descriptor for the snapshot.
+ * The loader_section must be locked while calling this function.
+ */
+static void record_import_snapshot( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr,
+                                    WINE_MODREF *imp, const IMAGE_EXPORT_DIRECTORY *exports,
+                                    const IMAGE_THUNK_DATA *thunk_list, DWORD count )
+{
+    ULONG_PTR start = (ULONG_PTR)imp->ldr.BaseAddress, end = start + imp->ldr.SizeOfImage;
+    struct pending_record *pending;
+    DWORD i;
+
+    if (snapshot_done || !import_snapshot_enabled()) return;
+
+    /* stubs and exports forwarded to other modules can't be checked later */
+    for (i = 0; i < count; i++)
+        if (thunk_list[i].u1.Function < start || thunk_list[i].u1.Function >= end) return;
+
+    if (!(pending = RtlAllocateHeap( GetProcessHeap(), 0,
+                                     offsetof( struct pending_record, rec.thunks[count] ))))
+        return;
+    if (!get_snapshot_module( current_modref, descr, &pending->rec.module ) ||
+        !get_snapshot_module( imp, exports, &pending->rec.import ))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, pending );
+        return;
+    }
+    pending->rec.descr = (const char *)descr - (const char *)module;
+    pending->rec.count = count;
+    for (i = 0; i < count; i++) pending->rec.thunks[i] = thunk_list[i].u1.Function;
+    list_add_tail( &pending_records, &pending->entry );
+}
+
+/* check whether an old record is replaced by one resolved by the current process */
+static BOOL is_record_pending( const struct snapshot_record *rec )
+{
+    struct pending_record *pending;
+
+    LIST_FOR_EACH_ENTRY( pending, &pending_records, struct pending_record, entry )
+        if (pending->rec.module.base == rec->module.base && pending->rec.descr == rec->descr)
+            return TRUE;
+    return FALSE;
+}
+
+/*************************************************************************
+ *		save_import_snapshot
+ *
+ * Write the snapshot file once the startup dlls have been attached, if some
+ * of their imports had to be resolved. The file is replaced atomically.
+ * The loader_section must be locked while calling this function.
+ */
+static void save_import_snapshot(void)
+{
+    struct pending_record *pending, *next;
+    const struct snapshot_record *rec;
+    struct snapshot_header header;
+    const char *ptr;
+    const char *build_id = wine_get_build_id();
+    char suffix[16], *name = NULL, *tmp_name = NULL;
+    DWORD old_count = 0, old_size = 0;
+    int fd;
+
+    snapshot_done = TRUE;
+    if (list_empty( &pending_records )) goto done;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic   = IMPORT_SNAPSHOT_MAGIC;
+    header.version = IMPORT_SNAPSHOT_VERSION;
+    memcpy( header.build_id, build_id, min( strlen(build_id), sizeof(header.build_id) ));
+    LIST_FOR_EACH_ENTRY( pending, &pending_records, struct pending_record, entry )
+    {
+        header.count++;
+        header.size += snapshot_record_size( &pending->rec );
+    }
+    if (header.size > IMPORT_SNAPSHOT_MAX_SIZE) goto done;
+
+    /* keep the records of other modules, unless the file is getting too large */
+    ptr = snapshot_data;
+    while (snapshot_data && (rec = next_snapshot_record( &ptr )))
+    {
+        if (is_record_pending( rec )) continue;
+        old_count++;
+        old_size += snapshot_record_size( rec );
+    }
+    if (header.size + old_size > IMPORT_SNAPSHOT_MAX_SIZE) old_count = old_size = 0;
+    header.count += old_count;
+    header.size += old_size;
+
+    sprintf( suffix, ".%04x", HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess ));
+    if (!(name = get_snapshot_file_name( "" ))) goto done;
+    if (!(tmp_name = get_snapshot_file_name( suffix ))) goto done;
+    if ((fd = open( tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) == -1) goto done;
+
+    if (write( fd, &header, sizeof(header) ) != sizeof(header)) goto failed;
+    LIST_FOR_EACH_ENTRY( pending, &pending_records, struct pending_record, entry )
+    {
+        SIZE_T size = snapshot_record_size( &pending->rec );
+        if (write( fd, &pending->rec, size ) != size) goto failed;
+    }
+    ptr = snapshot_data;
+    while (old_count && (rec = next_snapshot_record( &ptr )))
+    {
+        SIZE_T size = snapshot_record_size( rec );
+        if (is_record_pending( rec )) continue;
+        if (write( fd, rec, size ) != size) goto failed;
+    }
+    if (close( fd ) || rename( tmp_name, name ))
+    {
+        WARN( "failed to save import snapshot %s\n", debugstr_a(name) );
+        unlink( tmp_name );
+    }
+    else TRACE_(imports)( "saved %u records to %s\n", header.count, debugstr_a(name) );
+    goto done;
+
+failed:
+    WARN( "failed to write import snapshot %s\n", debugstr_a(tmp_name) );
+    close( fd );
+    unlink( tmp_name );
+done:
+    RtlFreeHeap( GetProcessHeap(), 0, tmp_name );
+    RtlFreeHeap( GetProcessHeap(), 0, name );
+    LIST_FOR_EACH_ENTRY_SAFE( pending, next, &pending_records, struct pending_record, entry )
+    {
+        list_remove( &pending->entry );
+        RtlFreeHeap( GetProcessHeap(), 0, pending );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, snapshot_data );
+    snapshot_data = NULL;
+    snapshot_size = 0;
+}
+
+
 /*************************************************************************
  *		import_dll
  *
@@ -627,8 +1075,8 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     const char *name = get_rva( module, descr->Name );
     DWORD len = strlen(name);
     PVOID protect_base;
-    SIZE_T protect_size = 0;
-    DWORD protect_old;
+    SIZE_T protect_size;
+    DWORD protect_old, thunk_count = 0;
 
     thunk_list = get_rva( module, (DWORD)descr->FirstThunk );
     if (descr->u.OriginalFirstThunk)
@@ -674,15 +1122,18 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
 
     /* unprotect the import address table since it can be located in
      * readonly section */
-    while (import_list[protect_size].u1.Ordinal) protect_size++;
+    while (import_list[thunk_count].u1.Ordinal) thunk_count++;
     protect_base = thunk_list;
-    protect_size *= sizeof(*thunk_list);
+    protect_size = thunk_count * sizeof(*thunk_list);
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base,
                             &protect_size, PAGE_READWRITE, &protect_old );
 
     imp_mod = wmImp->ldr.BaseAddress;
     exports = RtlImageDirectoryEntryToData( imp_mod, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &exp_size );
 
+    if (exports && apply_import_snapshot( module, descr, wmImp, exports, thunk_list, thunk_count ))
+        goto done;
+
     if (!exports)
     {
         /* set all imported function to deadbeef */
@@ -746,6 +1197,8 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         import_list++;
         thunk_list++;
     }
+    record_import_snapshot( module, descr, wmImp, exports, get_rva( module, (DWORD)descr->FirstThunk ),
+                            thunk_count );
 
 done:
     /* restore old protection of the import address table */
@@ -1162,6 +1615,8 @@ static NTSTATUS MODULE_InitDLL( WINE_MODREF *wm, UINT reason, LPVOID lpReserved
     NTSTATUS status = STATUS_SUCCESS;
     DLLENTRYPROC entry = wm->ldr.EntryPoint;
     void *module = wm->ldr.BaseAddress;
+    const char *type = (wm->ldr.Flags & LDR_WINE_INTERNAL) ? "builtin" : "native";
+    ULONGLONG start = 0, nested = 0;
     BOOL retv = FALSE;
 
     /* Skip calls for modules loaded with special load flags */
@@ -1170,11 +1625,16 @@ static NTSTATUS MODULE_InitDLL( WINE_MODREF *wm, UINT reason, LPVOID lpReserved
     if (wm->ldr.TlsIndex != -1) call_tls_callbacks( wm->ldr.BaseAddress, reason );
     if (!entry || !(wm->ldr.Flags & LDR_IMAGE_IS_DLL)) return STATUS_SUCCESS;
 
-    if (TRACE_ON(relay))
+    if (TRACE_ON(relay) || TRACE_ON(loadtime))
     {
         size_t len = min( wm->ldr.BaseDllName.Length, sizeof(mod_name)-sizeof(WCHAR) );
         memcpy( mod_name, wm->ldr.BaseDllName.Buffer, len );
         mod_name[len / sizeof(WCHAR)] = 0;
+    }
+    if (reason == DLL_PROCESS_ATTACH) start = start_load_time( &nested );
+
+    if (TRACE_ON(relay))
+    {
         TRACE_(relay)("\1Call PE DLL (proc=%p,module=%p %s,reason=%s,res=%p)\n",
                       entry, module, debugstr_w(mod_name), reason_names[reason], lpReserved );
     }
@@ -1204,6 +1664,7 @@ static NTSTATUS MODULE_InitDLL( WINE_MODREF *wm, UINT reason, LPVOID lpReserved
     else
         TRACE("(%p,%s,%p) - RETURN %d\n", module, reason_names[reason], lpReserved, retv );
 
+    end_load_time( mod_name, "init", type, status, start, nested );
     return status;
 }
 
@@ -2360,9 +2821,12 @@ static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_
     struct stat st;
     HANDLE handle;
     NTSTATUS nts;
+    ULONGLONG start, nested = 0;
 
     TRACE( "looking for %s in %s\n", debugstr_w(libname), debugstr_w(load_path) );
 
+    start = start_load_time( &nested );
+
     *pwm = NULL;
     filename = buffer;
     size = sizeof(buffer);
@@ -2371,9 +2835,14 @@ static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_
         nts = find_dll_file( load_path, libname, filename, &size, pwm, &handle, &st );
         if (nts == STATUS_SUCCESS) break;
         if (filename != buffer) RtlFreeHeap( GetProcessHeap(), 0, filename );
-        if (nts != STATUS_BUFFER_TOO_SMALL) return nts;
-        /* grow the buffer and retry */
-        if (!(filename = RtlAllocateHeap( GetProcessHeap(), 0, size ))) return STATUS_NO_MEMORY;
+        if (nts == STATUS_BUFFER_TOO_SMALL &&
+            !(filename = RtlAllocateHeap( GetProcessHeap(), 0, size ))) nts = STATUS_NO_MEMORY;
+        if (nts != STATUS_BUFFER_TOO_SMALL)
+        {
+            end_load_time( libname, "load", "none", nts, start, nested );
+            return nts;
+        }
+        /* retry with the grown buffer */
     }
 
     if (*pwm)  /* found already loaded module */
@@ -2384,6 +2853,7 @@ static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_
               debugstr_w((*pwm)->ldr.FullDllName.Buffer), debugstr_w(libname),
               (*pwm)->ldr.BaseAddress, (*pwm)->ldr.LoadCount);
         if (filename != buffer) RtlFreeHeap( GetProcessHeap(), 0, filename );
+        end_load_time( NULL, NULL, NULL, STATUS_SUCCESS, start, nested );
         return STATUS_SUCCESS;
     }
 
@@ -2447,12 +2917,16 @@ static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_
               (*pwm)->ldr.BaseAddress);
         if (handle) NtClose( handle );
         if (filename != buffer) RtlFreeHeap( GetProcessHeap(), 0, filename );
+        end_load_time( (*pwm)->ldr.FullDllName.Buffer, "load",
+                       ((*pwm)->ldr.Flags & LDR_WINE_INTERNAL) ? "builtin" : "native",
+                       nts, start, nested );
         return nts;
     }
 
     WARN("Failed to load module %s; status=%x\n", debugstr_w(libname), nts);
     if (handle) NtClose( handle );
     if (filename != buffer) RtlFreeHeap( GetProcessHeap(), 0, filename );
+    end_load_time( libname, "load", "none", nts, start, nested );
     return nts;
 }
 
@@ -2966,6 +3440,7 @@ static void free_modref( WINE_MODREF *wm )
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -3163,6 +3638,7 @@ NTSTATUS attach_dlls( CONTEXT *context, void **entry )
             NtTerminateProcess( GetCurrentProcess(), status );
         }
         attach_implicitly_loaded_dlls( context );
+        save_import_snapshot();
         virtual_release_address_space();
     }
     else
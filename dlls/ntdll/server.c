@@ -205,11 +205,21 @@ static DECLSPEC_NORETURN void server_protocol_perror( const char *err )
  */
 static unsigned int send_request( const struct __server_request_info *req )
 {
+    char *shm = ntdll_get_thread_data()->request_shm;
     unsigned int i;
     int ret;
 
-    if (!req->u.req.request_header.request_size)
+    if (!req->u.req.request_header.request_size ||
+        (shm && req->u.req.request_header.request_size <= REQUEST_SHM_SIZE))
     {
+        /* the data is passed in shared memory, the pipe is only used to wake up the server */
+        for (i = 0; i < req->data_count; i++)
+        {
+            if (!virtual_check_buffer_for_read( req->data[i].ptr, req->data[i].size ))
+                return STATUS_ACCESS_VIOLATION;
+            memcpy( shm, req->data[i].ptr, req->data[i].size );
+            shm += req->data[i].size;
+        }
         if ((ret = write( ntdll_get_thread_data()->request_fd, &req->u.req,
                           sizeof(req->u.req) )) == sizeof(req->u.req)) return STATUS_SUCCESS;
 
@@ -270,9 +280,15 @@ static void read_reply_data( void *buffer, size_t size )
  */
 static inline unsigned int wait_reply( struct __server_request_info *req )
 {
+    const void *shm = ntdll_get_thread_data()->request_shm;
+    data_size_t size;
+
     read_reply_data( &req->u.reply, sizeof(req->u.reply) );
-    if (req->u.reply.reply_header.reply_size)
-        read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
+    if ((size = req->u.reply.reply_header.reply_size))
+    {
+        if (shm && size <= REQUEST_SHM_SIZE) memcpy( req->reply_data, shm, size );
+        else read_reply_data( req->reply_data, size );
+    }
     return req->u.reply.reply_header.error;
 }
 
@@ -324,6 +340,73 @@ unsigned int wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Perform several independent server calls with a single round trip.
+ *
+ * PARAMS
+ *     reqs  [I/O] Array of requests, set up like for wine_server_call
+ *     count [I]   Number of requests
+ *
+ * RETURNS
+ *     The status of the batch itself; the status of each request
+ *     is returned in its reply header.
+ *
+ * NOTES
+ *     The requests are executed in order, but none of them can depend
+ *     on the result of a previous one. Blocking requests aren't allowed.
+ */
+unsigned int CDECL wine_server_call_batch( void **reqs, unsigned int count )
+{
+    struct __server_request_info **infos = (struct __server_request_info **)reqs;
+    char stack_buffer[1024], *buffer = stack_buffer, *ptr;
+    data_size_t req_size = 0, reply_size = 0, size;
+    unsigned int i, j, ret;
+
+    for (i = 0; i < count; i++)
+    {
+        req_size += sizeof(infos[i]->u.req) + infos[i]->u.req.request_header.request_size;
+        reply_size += sizeof(infos[i]->u.reply) + infos[i]->u.req.request_header.reply_size;
+    }
+    size = max( req_size, reply_size );
+    if (size > sizeof(stack_buffer) && !(buffer = RtlAllocateHeap( GetProcessHeap(), 0, size )))
+        return STATUS_NO_MEMORY;
+
+    for (i = 0, ptr = buffer; i < count; i++)
+    {
+        memcpy( ptr, &infos[i]->u.req, sizeof(infos[i]->u.req) );
+        ptr += sizeof(infos[i]->u.req);
+        for (j = 0; j < infos[i]->data_count; j++)
+        {
+            memcpy( ptr, infos[i]->data[j].ptr, infos[i]->data[j].size );
+            ptr += infos[i]->data[j].size;
+        }
+    }
+
+    SERVER_START_REQ( batch )
+    {
+        wine_server_add_data( req, buffer, req_size );
+        wine_server_set_reply( req, buffer, reply_size );
+        if (!(ret = wine_server_call( req )))
+        {
+            for (i = 0, ptr = buffer; i < count; i++)
+            {
+                memcpy( &infos[i]->u.reply, ptr, sizeof(infos[i]->u.reply) );
+                ptr += sizeof(infos[i]->u.reply);
+                size = infos[i]->u.reply.reply_header.reply_size;
+                if (size) memcpy( infos[i]->reply_data, ptr, size );
+                ptr += size;
+            }
+        }
+    }
+    SERVER_END_REQ;
+
+    if (buffer != stack_buffer) RtlFreeHeap( GetProcessHeap(), 0, buffer );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -981,6 +1064,40 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_map_fast_sync_shm
+ *
+ * Map the shared memory of fast synchronization objects, return NULL if not supported.
+ */
+void *server_map_fast_sync_shm(void)
+{
+    static void *fast_sync_shm;
+    sigset_t sigset;
+    obj_handle_t fd_handle;
+    void *ptr;
+    int fd;
+
+    /* fd_cache_section also protects against other threads receiving fds */
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    if (!fast_sync_shm)
+    {
+        SERVER_START_REQ( get_fast_sync_shm )
+        {
+            if (!wine_server_call( req ) && (fd = receive_fd( &fd_handle )) != -1)
+            {
+                ptr = mmap( NULL, reply->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+                if (ptr != MAP_FAILED) fast_sync_shm = ptr;
+                close( fd );
+            }
+        }
+        SERVER_END_REQ;
+    }
+    ptr = fast_sync_shm;
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    return ptr;
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle   (NTDLL.@)
  *
@@ -1041,6 +1158,70 @@ int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *uni
 }
 
 
+/***********************************************************************
+ *           wine_server_prefetch_fds   (NTDLL.@)
+ *
+ * Retrieve the Unix file descriptors of several handles with a single
+ * server call, and store them in the fd cache.
+ *
+ * PARAMS
+ *     handles [I] Wine file handles.
+ *     count   [I] Number of handles.
+ *
+ * RETURNS
+ *     nothing
+ *
+ * NOTES
+ *     This is only a hint, errors are ignored. The descriptors are
+ *     retrieved the usual way with wine_server_handle_to_fd.
+ */
+void CDECL wine_server_prefetch_fds( const HANDLE *handles, unsigned int count )
+{
+    struct __server_request_info reqs[8];
+    void *ptrs[8];
+    HANDLE wanted[8];
+    struct get_handle_fd_request *req;
+    const struct get_handle_fd_reply *reply;
+    obj_handle_t fd_handle;
+    unsigned int i, n, access;
+    sigset_t sigset;
+    int fd;
+
+    count = min( count, sizeof(reqs) / sizeof(reqs[0]) );
+
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    for (i = n = 0; i < count; i++)
+    {
+        if (get_cached_fd( handles[i], &fd, NULL, &access, NULL ) != STATUS_INVALID_HANDLE) continue;
+        req = SERVER_INIT_BATCH_REQ( &reqs[n], get_handle_fd );
+        req->handle = wine_server_obj_handle( handles[i] );
+        wanted[n] = handles[i];
+        ptrs[n] = &reqs[n];
+        n++;
+    }
+
+    /* a single request isn't worth a batch, let the caller fetch it */
+    if (n > 1 && !wine_server_call_batch( ptrs, n ))
+    {
+        for (i = 0; i < n; i++)
+        {
+            reply = &reqs[i].u.reply.get_handle_fd_reply;
+            if (reply->__header.error)
+            {
+                if (reply->cacheable) add_fd_to_cache( wanted[i], reply->__header.error, FD_TYPE_INVALID, 0, 0 );
+                continue;
+            }
+            /* the server sent the fds in the order of the requests */
+            if ((fd = receive_fd( &fd_handle )) == -1) continue;
+            assert( wine_server_ptr_handle(fd_handle) == wanted[i] );
+            if (!reply->cacheable || !add_fd_to_cache( wanted[i], fd, reply->type, reply->access, reply->options ))
+                close( fd );
+        }
+    }
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
 /***********************************************************************
  *           wine_server_release_fd   (NTDLL.@)
  *
@@ -1465,6 +1646,36 @@ void server_init_process_done(void)
 }
 
 
+/***********************************************************************
+ *           init_request_shm
+ *
+ * Map the shared memory used to pass the data of the requests of the current thread.
+ */
+static void init_request_shm(void)
+{
+    sigset_t sigset;
+    obj_handle_t fd_handle;
+    void *ptr = NULL;
+    int fd;
+
+    /* fd_cache_section also protects against other threads receiving fds */
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    SERVER_START_REQ( get_request_shm )
+    {
+        if (!wine_server_call( req ) && (fd = receive_fd( &fd_handle )) != -1)
+        {
+            ptr = mmap( NULL, reply->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            /* the server uses the shared memory from now on, we can't go back to the pipe */
+            if (ptr == MAP_FAILED) server_protocol_perror( "mmap" );
+            close( fd );
+        }
+    }
+    SERVER_END_REQ;
+    ntdll_get_thread_data()->request_shm = ptr;
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
 /***********************************************************************
  *           server_init_thread
  *
@@ -1521,6 +1732,7 @@ size_t server_init_thread( void *entry_point, BOOL *suspend )
     switch (ret)
     {
     case STATUS_SUCCESS:
+        init_request_shm();
         if (arch)
         {
             if (!strcmp( arch, "win32" ) && (is_win64 || is_wow64))
@@ -42,6 +42,13 @@
 #ifdef HAVE_SCHED_H
 # include <sched.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#include <limits.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -55,6 +62,7 @@
 #include "winternl.h"
 #include "wine/server.h"
 #include "wine/debug.h"
+#include "wine/library.h"
 #include "ntdll_misc.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(ntdll);
@@ -166,6 +174,471 @@ NTSTATUS validate_open_object_attributes( const OBJECT_ATTRIBUTES *attr )
     return STATUS_SUCCESS;
 }
 
+/*
+ *	Fast synchronization objects
+ *
+ * Unnamed events, semaphores and mutexes can keep their state in memory
+ * shared with the server, so that waiting and signaling doesn't require
+ * a server call. The server takes an object over by setting the
+ * FAST_SYNC_DEMOTED flag, after which we have to go through requests.
+ */
+
+#ifdef __linux__
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+union fast_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        int          index;         /* slot index + 1, 0 if the object can't be handled here */
+        unsigned int type : 8;      /* FAST_SYNC_* type of the object */
+        unsigned int access : 3;    /* FAST_SYNC_ACCESS_* rights of the handle */
+        unsigned int cached : 1;    /* the entry has been retrieved from the server */
+    } s;
+};
+
+C_ASSERT( sizeof(union fast_sync_cache_entry) == sizeof(LONG64) );
+
+#define FAST_SYNC_ACCESS_QUERY   0x1  /* same value as EVENT/SEMAPHORE/MUTANT_QUERY_STATE */
+#define FAST_SYNC_ACCESS_MODIFY  0x2  /* same value as EVENT/SEMAPHORE_MODIFY_STATE */
+#define FAST_SYNC_ACCESS_WAIT    0x4  /* SYNCHRONIZE */
+
+#define FAST_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(union fast_sync_cache_entry))
+#define FAST_SYNC_CACHE_ENTRIES     128
+
+static union fast_sync_cache_entry *fast_sync_cache[FAST_SYNC_CACHE_ENTRIES];
+static union fast_sync_cache_entry fast_sync_cache_initial_block[FAST_SYNC_CACHE_BLOCK_SIZE];
+static struct fast_sync_slot *fast_sync_slots;
+static int fast_sync_supported = -1;
+static int futex_waitv_supported = 1;
+
+struct futex_waitv
+{
+    ULONG64      val;
+    ULONG64      uaddr;
+    unsigned int flags;
+    unsigned int reserved;
+};
+
+static inline LONG64 fast_sync_xchg64( LONG64 *dest, LONG64 val )
+{
+    LONG64 tmp = *dest;
+    while (interlocked_cmpxchg64( dest, val, tmp ) != tmp) tmp = *dest;
+    return tmp;
+}
+
+static inline unsigned int fast_sync_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle(handle) >> 2) - 1;
+    *entry = idx / FAST_SYNC_CACHE_BLOCK_SIZE;
+    return idx % FAST_SYNC_CACHE_BLOCK_SIZE;
+}
+
+/* map the shared memory on first use */
+static BOOL init_fast_sync(void)
+{
+    if (fast_sync_supported == -1)
+    {
+        fast_sync_slots = server_map_fast_sync_shm();
+        fast_sync_supported = (fast_sync_slots != NULL);
+    }
+    return fast_sync_supported;
+}
+
+/* make sure that the cache block of a handle is allocated */
+static union fast_sync_cache_entry *get_fast_sync_cache_block( unsigned int entry )
+{
+    void *ptr;
+
+    if (fast_sync_cache[entry]) return fast_sync_cache[entry];
+
+    if (!entry) ptr = fast_sync_cache_initial_block;
+    else if ((ptr = wine_anon_mmap( NULL, FAST_SYNC_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry),
+                                    PROT_READ | PROT_WRITE, 0 )) == MAP_FAILED)
+        return NULL;
+
+    if (interlocked_cmpxchg_ptr( (void **)&fast_sync_cache[entry], ptr, NULL ) && entry)
+        munmap( ptr, FAST_SYNC_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry) );
+    return fast_sync_cache[entry];
+}
+
+/* retrieve the fast sync information for a handle, querying the server if needed */
+static union fast_sync_cache_entry get_fast_sync_entry( HANDLE handle )
+{
+    unsigned int entry, idx = fast_sync_handle_to_index( handle, &entry );
+    union fast_sync_cache_entry cache, *block;
+    NTSTATUS ret;
+
+    cache.data = 0;
+    if (entry >= FAST_SYNC_CACHE_ENTRIES || !init_fast_sync()) return cache;
+
+    if (fast_sync_cache[entry])
+    {
+        cache.data = interlocked_cmpxchg64( &fast_sync_cache[entry][idx].data, 0, 0 );
+        if (cache.s.cached) return cache;
+    }
+
+    SERVER_START_REQ( get_fast_sync_obj )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!(ret = wine_server_call( req )))
+        {
+            cache.s.index  = reply->index + 1;
+            cache.s.type   = reply->type;
+            cache.s.access = (reply->access & (FAST_SYNC_ACCESS_QUERY | FAST_SYNC_ACCESS_MODIFY)) |
+                             ((reply->access & SYNCHRONIZE) ? FAST_SYNC_ACCESS_WAIT : 0);
+        }
+    }
+    SERVER_END_REQ;
+
+    /* don't remember invalid handles, they may become valid later */
+    if (ret && ret != STATUS_NOT_IMPLEMENTED) return cache;
+
+    cache.s.cached = 1;
+    if ((block = get_fast_sync_cache_block( entry )))
+        interlocked_cmpxchg64( &block[idx].data, cache.data, 0 );
+    return cache;
+}
+
+/* the server took the object over, remember to use requests from now on */
+static NTSTATUS fast_sync_demoted( HANDLE handle )
+{
+    unsigned int entry, idx = fast_sync_handle_to_index( handle, &entry );
+    union fast_sync_cache_entry cache;
+
+    cache.data = 0;
+    cache.s.cached = 1;
+    if (entry < FAST_SYNC_CACHE_ENTRIES && fast_sync_cache[entry])
+        fast_sync_xchg64( &fast_sync_cache[entry][idx].data, cache.data );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+/* get the slot of an object of one of the given types, if the handle has the required access */
+static struct fast_sync_slot *get_fast_sync_slot( HANDLE handle, unsigned int types,
+                                                  unsigned int access, int *type )
+{
+    union fast_sync_cache_entry cache;
+
+    if (!fast_sync_supported) return NULL;
+    cache = get_fast_sync_entry( handle );
+    if (!cache.s.index || !(types & (1 << cache.s.type))) return NULL;
+    if ((cache.s.access & access) != access) return NULL;
+    if (type) *type = cache.s.type;
+    return &fast_sync_slots[cache.s.index - 1];
+}
+
+#define FAST_SYNC_EVENT_TYPES ((1 << FAST_SYNC_AUTO_EVENT) | (1 << FAST_SYNC_MANUAL_EVENT))
+
+void remove_fast_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = fast_sync_handle_to_index( handle, &entry );
+
+    if (entry < FAST_SYNC_CACHE_ENTRIES && fast_sync_cache[entry])
+        fast_sync_xchg64( &fast_sync_cache[entry][idx].data, 0 );
+}
+
+/* notify the threads waiting on a slot that its state has changed */
+static void wake_fast_sync( struct fast_sync_slot *slot )
+{
+    interlocked_xchg_add( &slot->seq, 1 );
+    if (slot->waiters) syscall( __NR_futex, &slot->seq, 1 /* FUTEX_WAKE */, INT_MAX, NULL, 0, 0 );
+}
+
+static NTSTATUS fast_set_event( HANDLE handle )
+{
+    struct fast_sync_slot *slot;
+    __int64 state, prev;
+
+    if (!(slot = get_fast_sync_slot( handle, FAST_SYNC_EVENT_TYPES, FAST_SYNC_ACCESS_MODIFY, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    for (state = slot->state; ; state = prev)
+    {
+        if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+        if ((prev = interlocked_cmpxchg64( &slot->state, state | 1, state )) == state) break;
+    }
+    if (!(state & 1)) wake_fast_sync( slot );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_reset_event( HANDLE handle )
+{
+    struct fast_sync_slot *slot;
+    __int64 state, prev;
+
+    if (!(slot = get_fast_sync_slot( handle, FAST_SYNC_EVENT_TYPES, FAST_SYNC_ACCESS_MODIFY, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    for (state = slot->state; ; state = prev)
+    {
+        if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+        if ((prev = interlocked_cmpxchg64( &slot->state, state & ~1, state )) == state) break;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_event( HANDLE handle, EVENT_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *slot;
+    __int64 state;
+    int type;
+
+    if (!(slot = get_fast_sync_slot( handle, FAST_SYNC_EVENT_TYPES, FAST_SYNC_ACCESS_QUERY, &type )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    state = interlocked_cmpxchg64( &slot->state, 0, 0 );
+    if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+    info->EventType  = (type == FAST_SYNC_MANUAL_EVENT) ? NotificationEvent : SynchronizationEvent;
+    info->EventState = state & 1;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    struct fast_sync_slot *slot;
+    __int64 state, prev;
+    unsigned int current;
+
+    if (!(slot = get_fast_sync_slot( handle, 1 << FAST_SYNC_SEMAPHORE, FAST_SYNC_ACCESS_MODIFY, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    for (state = slot->state; ; state = prev)
+    {
+        if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+        current = (unsigned int)state;
+        if (current + count < current || current + count > slot->max)
+            return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+        if ((prev = interlocked_cmpxchg64( &slot->state, state + count, state )) == state) break;
+    }
+    if (previous) *previous = current;
+    if (count) wake_fast_sync( slot );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_semaphore( HANDLE handle, SEMAPHORE_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *slot;
+    __int64 state;
+
+    if (!(slot = get_fast_sync_slot( handle, 1 << FAST_SYNC_SEMAPHORE, FAST_SYNC_ACCESS_QUERY, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    state = interlocked_cmpxchg64( &slot->state, 0, 0 );
+    if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+    info->CurrentCount = (unsigned int)state;
+    info->MaximumCount = slot->max;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_mutant( HANDLE handle, LONG *prev_count )
+{
+    struct fast_sync_slot *slot;
+    __int64 state, prev, new_state;
+    unsigned int count;
+    DWORD tid = GetCurrentThreadId();
+
+    if (!(slot = get_fast_sync_slot( handle, 1 << FAST_SYNC_MUTEX, 0, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    for (state = slot->state; ; state = prev)
+    {
+        if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+        count = (state >> FAST_SYNC_MUTEX_COUNT_SHIFT) & FAST_SYNC_MUTEX_COUNT_MAX;
+        if (!count || (DWORD)state != tid) return STATUS_MUTANT_NOT_OWNED;
+        new_state = (count == 1) ? 0 : state - ((__int64)1 << FAST_SYNC_MUTEX_COUNT_SHIFT);
+        if ((prev = interlocked_cmpxchg64( &slot->state, new_state, state )) == state) break;
+    }
+    if (prev_count) *prev_count = 1 - count;
+    if (count == 1) wake_fast_sync( slot );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_query_mutant( HANDLE handle, MUTANT_BASIC_INFORMATION *info )
+{
+    struct fast_sync_slot *slot;
+    __int64 state;
+    unsigned int count;
+
+    if (!(slot = get_fast_sync_slot( handle, 1 << FAST_SYNC_MUTEX, FAST_SYNC_ACCESS_QUERY, NULL )))
+        return STATUS_NOT_IMPLEMENTED;
+
+    state = interlocked_cmpxchg64( &slot->state, 0, 0 );
+    if (state & FAST_SYNC_DEMOTED) return fast_sync_demoted( handle );
+    count = (state >> FAST_SYNC_MUTEX_COUNT_SHIFT) & FAST_SYNC_MUTEX_COUNT_MAX;
+    info->CurrentCount   = 1 - count;
+    info->OwnedByCaller  = count && (DWORD)state == GetCurrentThreadId();
+    info->AbandonedState = FALSE;  /* abandoned mutexes are always demoted */
+    return STATUS_SUCCESS;
+}
+
+/* try to grab an object, return 1 on success, 0 if not signaled and -1 if it has been demoted */
+static int try_acquire_fast_sync( struct fast_sync_slot *slot, int type, DWORD tid )
+{
+    __int64 state, prev, new_state;
+    unsigned int count;
+
+    for (state = slot->state; ; state = prev)
+    {
+        if (state & FAST_SYNC_DEMOTED) return -1;
+        switch (type)
+        {
+        case FAST_SYNC_MANUAL_EVENT:
+            return state & 1;
+        case FAST_SYNC_AUTO_EVENT:
+            if (!(state & 1)) return 0;
+            new_state = state & ~1;
+            break;
+        case FAST_SYNC_SEMAPHORE:
+            if (!(unsigned int)state) return 0;
+            new_state = state - 1;
+            break;
+        case FAST_SYNC_MUTEX:
+            count = (state >> FAST_SYNC_MUTEX_COUNT_SHIFT) & FAST_SYNC_MUTEX_COUNT_MAX;
+            if (!count) new_state = tid | ((__int64)1 << FAST_SYNC_MUTEX_COUNT_SHIFT);
+            else if ((DWORD)state != tid) return 0;
+            else if (count == FAST_SYNC_MUTEX_COUNT_MAX) return -1;  /* let the server deal with it */
+            else new_state = state + ((__int64)1 << FAST_SYNC_MUTEX_COUNT_SHIFT);
+            break;
+        default:
+            return -1;
+        }
+        if ((prev = interlocked_cmpxchg64( &slot->state, new_state, state )) == state) return 1;
+    }
+}
+
+/* wait for any of the objects without going through the server */
+/* a relative timeout is made absolute, in case the server has to finish the wait */
+static NTSTATUS fast_wait( DWORD count, const HANDLE *handles, LARGE_INTEGER *timeout )
+{
+    struct fast_sync_slot *slots[MAXIMUM_WAIT_OBJECTS];
+    int types[MAXIMUM_WAIT_OBJECTS];
+    struct futex_waitv waitv[MAXIMUM_WAIT_OBJECTS];
+    struct timespec end, *end_ptr = NULL;
+    BOOL poll = FALSE;
+    DWORD i, tid;
+    int ret;
+
+    if (!fast_sync_supported || (count > 1 && !futex_waitv_supported)) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+        if (!(slots[i] = get_fast_sync_slot( handles[i], ~0u, FAST_SYNC_ACCESS_WAIT, &types[i] )))
+            return STATUS_NOT_IMPLEMENTED;
+
+    if (timeout && timeout->QuadPart != TIMEOUT_INFINITE)
+    {
+        LARGE_INTEGER now;
+        timeout_t diff;
+
+        NtQuerySystemTime( &now );
+        if (timeout->QuadPart < 0) timeout->QuadPart = now.QuadPart - timeout->QuadPart;
+        if ((diff = timeout->QuadPart - now.QuadPart) <= 0) poll = TRUE;
+        else
+        {
+            clock_gettime( CLOCK_MONOTONIC, &end );
+            end.tv_sec  += diff / 10000000;
+            end.tv_nsec += (diff % 10000000) * 100;
+            if (end.tv_nsec >= 1000000000)
+            {
+                end.tv_sec++;
+                end.tv_nsec -= 1000000000;
+            }
+            end_ptr = &end;
+        }
+    }
+
+    tid = GetCurrentThreadId();
+    for (;;)
+    {
+        for (i = 0; i < count; i++)
+        {
+            waitv[i].val      = slots[i]->seq;
+            waitv[i].uaddr    = (ULONG_PTR)&slots[i]->seq;
+            waitv[i].flags    = 2;  /* FUTEX2_SIZE_U32 */
+            waitv[i].reserved = 0;
+        }
+        for (i = 0; i < count; i++)
+        {
+            switch (try_acquire_fast_sync( slots[i], types[i], tid ))
+            {
+            case 1: return STATUS_WAIT_0 + i;
+            case -1: return fast_sync_demoted( handles[i] );
+            }
+        }
+        if (poll) break;
+
+        for (i = 0; i < count; i++) interlocked_xchg_add( &slots[i]->waiters, 1 );
+        if (count == 1)  /* FUTEX_WAIT_BITSET uses an absolute CLOCK_MONOTONIC timeout */
+            ret = syscall( __NR_futex, &slots[0]->seq, 9 /* FUTEX_WAIT_BITSET */,
+                           (int)waitv[0].val, end_ptr, NULL, ~0u );
+        else
+            ret = syscall( __NR_futex_waitv, waitv, count, 0, end_ptr, CLOCK_MONOTONIC );
+        for (i = 0; i < count; i++) interlocked_xchg_add( &slots[i]->waiters, -1 );
+
+        if (ret == -1 && errno == ETIMEDOUT) break;
+        if (ret == -1 && errno == ENOSYS)
+        {
+            futex_waitv_supported = 0;
+            return STATUS_NOT_IMPLEMENTED;
+        }
+    }
+
+    /* same as server_select() */
+    NtYieldExecution();
+    return STATUS_TIMEOUT;
+}
+
+#else  /* __linux__ */
+
+void remove_fast_sync_from_cache( HANDLE handle )
+{
+}
+
+static NTSTATUS fast_set_event( HANDLE handle )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_reset_event( HANDLE handle )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_event( HANDLE handle, EVENT_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_semaphore( HANDLE handle, SEMAPHORE_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_mutant( HANDLE handle, LONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_query_mutant( HANDLE handle, MUTANT_BASIC_INFORMATION *info )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_wait( DWORD count, const HANDLE *handles, LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
 /*
  *	Semaphores
  */
@@ -245,6 +718,12 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 
     if (len != sizeof(SEMAPHORE_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_semaphore( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -266,6 +745,10 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
     NTSTATUS ret;
+
+    if ((ret = fast_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -346,6 +829,8 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 
     /* FIXME: set NumberOfThreadsReleased */
 
+    if ((ret = fast_set_event( handle )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -366,6 +851,8 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+    if ((ret = fast_reset_event( handle )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -430,6 +917,12 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 
     if (len != sizeof(EVENT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_event( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(EVENT_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_event )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -510,6 +1003,8 @@ NTSTATUS WINAPI NtReleaseMutant( IN HANDLE handle, OUT PLONG prev_count OPTIONAL
 {
     NTSTATUS    status;
 
+    if ((status = fast_release_mutant( handle, prev_count )) != STATUS_NOT_IMPLEMENTED) return status;
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -541,6 +1036,12 @@ NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
 
     if (len != sizeof(MUTANT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((ret = fast_query_mutant( handle, out )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!ret && ret_len) *ret_len = sizeof(MUTANT_BASIC_INFORMATION);
+        return ret;
+    }
+
     SERVER_START_REQ( query_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1022,9 +1523,22 @@ static NTSTATUS wait_objects( DWORD count, const HANDLE *handles,
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    LARGE_INTEGER abs_timeout;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if (!alertable && (wait_any || count == 1))
+    {
+        if (timeout)
+        {
+            abs_timeout = *timeout;
+            timeout = &abs_timeout;
+        }
+        ret = fast_wait( count, handles, timeout ? &abs_timeout : NULL );
+        if (ret != STATUS_NOT_IMPLEMENTED) return ret;
+    }
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1331,6 +1845,72 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from completion object's queue
+ *
+ * PARAMS
+ *      port      [I] HANDLE to I/O completion object
+ *      info      [O] array of completion messages
+ *      count     [I] number of entries in info
+ *      written   [O] number of messages retrieved
+ *      timeout   [I] optional wait time in NTDLL format
+ *      alertable [I] whether the wait is alertable
+ *
+ * NOTES
+ *  All the messages available are fetched with a single server request.
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    completion_msg_t msgs[64];
+    NTSTATUS status;
+    ULONG i, size, max, done = 0;
+
+    TRACE("(%p, %p, %u, %p, %p, %u)\n", port, info, count, written, timeout, alertable);
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+
+    for (;;)
+    {
+        while (done < count)
+        {
+            size = max = min( count - done, sizeof(msgs) / sizeof(msgs[0]) );
+
+            SERVER_START_REQ( remove_completions )
+            {
+                req->handle = wine_server_obj_handle( port );
+                wine_server_set_reply( req, msgs, max * sizeof(msgs[0]) );
+                if (!(status = wine_server_call( req )))
+                    size = wine_server_reply_size( reply ) / sizeof(msgs[0]);
+            }
+            SERVER_END_REQ;
+            if (status) break;
+
+            for (i = 0; i < size; i++, done++)
+            {
+                info[done].CompletionKey             = msgs[i].ckey;
+                info[done].CompletionValue           = msgs[i].cvalue;
+                info[done].IoStatusBlock.Information = msgs[i].information;
+                info[done].IoStatusBlock.u.Status    = msgs[i].status;
+            }
+            if (size < max) break;  /* the queue is empty now */
+        }
+        if (done || status != STATUS_PENDING)
+        {
+            if (status == STATUS_PENDING) status = STATUS_SUCCESS;
+            break;
+        }
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+    *written = done ? done : 1;
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
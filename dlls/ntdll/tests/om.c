@@ -21,6 +21,7 @@
 
 #include "ntdll_test.h"
 #include "winternl.h"
+#include "wine/server.h"
 #include "stdio.h"
 #include "winnt.h"
 #include "stdlib.h"
@@ -47,6 +48,7 @@ static NTSTATUS (WINAPI *pNtQueryMutant) ( HANDLE, MUTANT_INFORMATION_CLASS, PVO
 static NTSTATUS (WINAPI *pNtReleaseMutant)( HANDLE, PLONG );
 static NTSTATUS (WINAPI *pNtCreateSemaphore)( PHANDLE, ACCESS_MASK,const POBJECT_ATTRIBUTES,LONG,LONG );
 static NTSTATUS (WINAPI *pNtOpenSemaphore)( PHANDLE, ACCESS_MASK, const POBJECT_ATTRIBUTES );
+static NTSTATUS (WINAPI *pNtQuerySemaphore)( HANDLE, SEMAPHORE_INFORMATION_CLASS, PVOID, ULONG, PULONG );
 static NTSTATUS (WINAPI *pNtCreateTimer) ( PHANDLE, ACCESS_MASK, const POBJECT_ATTRIBUTES, TIMER_TYPE );
 static NTSTATUS (WINAPI *pNtOpenTimer)( PHANDLE, ACCESS_MASK, const POBJECT_ATTRIBUTES );
 static NTSTATUS (WINAPI *pNtCreateSection)( PHANDLE, ACCESS_MASK, const POBJECT_ATTRIBUTES, const PLARGE_INTEGER,
@@ -63,6 +65,7 @@ static NTSTATUS (WINAPI *pNtCreateSymbolicLinkObject)(PHANDLE, ACCESS_MASK, POBJ
 static NTSTATUS (WINAPI *pNtQuerySymbolicLinkObject)(HANDLE,PUNICODE_STRING,PULONG);
 static NTSTATUS (WINAPI *pNtQueryObject)(HANDLE,OBJECT_INFORMATION_CLASS,PVOID,ULONG,PULONG);
 static NTSTATUS (WINAPI *pNtReleaseSemaphore)(HANDLE, ULONG, PULONG);
+static unsigned int (CDECL *pwine_server_call_batch)(void **, unsigned int);
 static NTSTATUS (WINAPI *pNtCreateKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, ULONG );
 static NTSTATUS (WINAPI *pNtOpenKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtWaitForKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
@@ -1979,6 +1982,303 @@ static void test_mutant(void)
     NtClose( mutant );
 }
 
+static DWORD WINAPI unnamed_sync_thread( void *arg )
+{
+    HANDLE *handles = arg;
+    DWORD ret;
+
+    ret = WaitForMultipleObjects( 2, handles, FALSE, 5000 );
+    ok( ret == WAIT_OBJECT_0 + 1, "WaitForMultipleObjects returned %08x\n", ret );
+    ok( SetEvent( handles[2] ), "SetEvent failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( handles[0], 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    return 0;
+}
+
+/* unnamed objects may be handled without going through the server, make sure
+ * that they behave the same way as named ones */
+static void test_unnamed_sync_objects(void)
+{
+    SEMAPHORE_BASIC_INFORMATION sem_info;
+    EVENT_BASIC_INFORMATION event_info;
+    MUTANT_BASIC_INFORMATION mutant_info;
+    HANDLE handles[3], event, sem, mutex, dup, thread;
+    NTSTATUS status;
+    DWORD ret, i, start;
+    LONG prev;
+
+    /* auto-reset event */
+    event = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( event != NULL, "CreateEvent failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08x\n", ret );
+    ok( SetEvent( event ), "SetEvent failed %u\n", GetLastError() );
+    status = pNtQueryEvent( event, EventBasicInformation, &event_info, sizeof(event_info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQueryEvent failed %08x\n", status );
+    ok( event_info.EventType == SynchronizationEvent, "got type %d\n", event_info.EventType );
+    ok( event_info.EventState == 1, "got state %d\n", event_info.EventState );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    ret = WaitForSingleObject( event, 10 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08x\n", ret );
+
+    /* a handle without SYNCHRONIZE or EVENT_MODIFY_STATE access */
+    ret = DuplicateHandle( GetCurrentProcess(), event, GetCurrentProcess(), &dup,
+                           EVENT_QUERY_STATE, FALSE, 0 );
+    ok( ret, "DuplicateHandle failed %u\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    ok( !SetEvent( dup ), "SetEvent succeeded\n" );
+    ok( GetLastError() == ERROR_ACCESS_DENIED, "got error %u\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    ret = WaitForSingleObject( dup, 0 );
+    ok( ret == WAIT_FAILED, "WaitForSingleObject returned %08x\n", ret );
+    ok( GetLastError() == ERROR_ACCESS_DENIED, "got error %u\n", GetLastError() );
+    status = pNtQueryEvent( dup, EventBasicInformation, &event_info, sizeof(event_info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQueryEvent failed %08x\n", status );
+    ok( event_info.EventState == 0, "got state %d\n", event_info.EventState );
+    CloseHandle( dup );
+
+    /* manual-reset event */
+    handles[2] = CreateEventA( NULL, TRUE, FALSE, NULL );
+    ok( handles[2] != NULL, "CreateEvent failed %u\n", GetLastError() );
+    ok( SetEvent( handles[2] ), "SetEvent failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( handles[2], 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    ret = WaitForSingleObject( handles[2], 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    status = pNtQueryEvent( handles[2], EventBasicInformation, &event_info, sizeof(event_info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQueryEvent failed %08x\n", status );
+    ok( event_info.EventType == NotificationEvent, "got type %d\n", event_info.EventType );
+    ok( event_info.EventState == 1, "got state %d\n", event_info.EventState );
+    ok( ResetEvent( handles[2] ), "ResetEvent failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( handles[2], 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08x\n", ret );
+
+    /* semaphore */
+    sem = CreateSemaphoreA( NULL, 1, 2, NULL );
+    ok( sem != NULL, "CreateSemaphore failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( sem, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    ret = WaitForSingleObject( sem, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08x\n", ret );
+    SetLastError( 0xdeadbeef );
+    prev = 0xdeadbeef;
+    ok( !ReleaseSemaphore( sem, 3, &prev ), "ReleaseSemaphore succeeded\n" );
+    ok( GetLastError() == ERROR_TOO_MANY_POSTS, "got error %u\n", GetLastError() );
+    ok( ReleaseSemaphore( sem, 2, &prev ), "ReleaseSemaphore failed %u\n", GetLastError() );
+    ok( prev == 0, "got prev %d\n", prev );
+    status = pNtQuerySemaphore( sem, SemaphoreBasicInformation, &sem_info, sizeof(sem_info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQuerySemaphore failed %08x\n", status );
+    ok( sem_info.CurrentCount == 2, "got count %d\n", sem_info.CurrentCount );
+    ok( sem_info.MaximumCount == 2, "got max %d\n", sem_info.MaximumCount );
+
+    /* wait for any, the first signaled object wins */
+    handles[0] = event;
+    handles[1] = sem;
+    ret = WaitForMultipleObjects( 2, handles, FALSE, 0 );
+    ok( ret == WAIT_OBJECT_0 + 1, "WaitForMultipleObjects returned %08x\n", ret );
+    ok( SetEvent( event ), "SetEvent failed %u\n", GetLastError() );
+    ret = WaitForMultipleObjects( 2, handles, FALSE, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %08x\n", ret );
+
+    /* wait for all */
+    ok( SetEvent( event ), "SetEvent failed %u\n", GetLastError() );
+    ret = WaitForMultipleObjects( 2, handles, TRUE, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %08x\n", ret );
+    ret = WaitForMultipleObjects( 2, handles, FALSE, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForMultipleObjects returned %08x\n", ret );
+
+    /* wake up another thread */
+    ok( ResetEvent( handles[2] ), "ResetEvent failed %u\n", GetLastError() );
+    thread = CreateThread( NULL, 0, unnamed_sync_thread, handles, 0, NULL );
+    ret = WaitForSingleObject( handles[2], 100 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08x\n", ret );
+    ok( ReleaseSemaphore( sem, 1, NULL ), "ReleaseSemaphore failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( handles[2], 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    ret = SignalObjectAndWait( event, thread, 5000, FALSE );
+    ok( ret == WAIT_OBJECT_0, "SignalObjectAndWait returned %08x\n", ret );
+    CloseHandle( thread );
+
+    /* mutex */
+    mutex = CreateMutexA( NULL, TRUE, NULL );
+    ok( mutex != NULL, "CreateMutex failed %u\n", GetLastError() );
+    ret = WaitForSingleObject( mutex, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %08x\n", ret );
+    status = pNtQueryMutant( mutex, MutantBasicInformation, &mutant_info, sizeof(mutant_info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQueryMutant failed %08x\n", status );
+    ok( mutant_info.CurrentCount == -1, "expected -1, got %d\n", mutant_info.CurrentCount );
+    ok( mutant_info.OwnedByCaller == TRUE, "expected TRUE, got %d\n", mutant_info.OwnedByCaller );
+    prev = 0xdeadbeef;
+    status = pNtReleaseMutant( mutex, &prev );
+    ok( status == STATUS_SUCCESS, "NtReleaseMutant failed %08x\n", status );
+    ok( prev == -1, "expected -1, got %d\n", prev );
+    prev = 0xdeadbeef;
+    status = pNtReleaseMutant( mutex, &prev );
+    ok( status == STATUS_SUCCESS, "NtReleaseMutant failed %08x\n", status );
+    ok( prev == 0, "expected 0, got %d\n", prev );
+    status = pNtReleaseMutant( mutex, NULL );
+    ok( status == STATUS_MUTANT_NOT_OWNED, "NtReleaseMutant returned %08x\n", status );
+
+    /* abandoned */
+    thread = CreateThread( NULL, 0, mutant_thread, mutex, 0, NULL );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08x\n", ret );
+    CloseHandle( thread );
+    ret = WaitForSingleObject( mutex, 1000 );
+    ok( ret == WAIT_ABANDONED_0, "WaitForSingleObject returned %08x\n", ret );
+    ok( ReleaseMutex( mutex ), "ReleaseMutex failed %u\n", GetLastError() );
+
+    if (winetest_debug > 1)
+    {
+        start = GetTickCount();
+        for (i = 0; i < 100000; i++)
+        {
+            SetEvent( event );
+            WaitForSingleObject( event, INFINITE );
+        }
+        trace( "100000 set/wait cycles took %u ms\n", GetTickCount() - start );
+    }
+
+    CloseHandle( mutex );
+    CloseHandle( sem );
+    CloseHandle( handles[2] );
+    CloseHandle( event );
+}
+
+static void test_batch_request(void)
+{
+    struct __server_request_info reqs[6];
+    void *ptrs[6] = { &reqs[0], &reqs[1], &reqs[2], &reqs[3], &reqs[4], &reqs[5] };
+    struct query_event_request *query_req;
+    struct get_object_info_request *info_req;
+    struct open_event_request *open_req;
+    char buffer[1024];
+    OBJECT_NAME_INFORMATION *name = (OBJECT_NAME_INFORMATION *)buffer;
+    WCHAR name_data[4];
+    HANDLE manual, autoev, handle;
+    unsigned int status;
+    ULONG len;
+
+    if (!pwine_server_call_batch)
+    {
+        win_skip( "wine_server_call_batch not supported\n" );
+        return;
+    }
+
+    manual = CreateEventA( NULL, TRUE, TRUE, "om_batch_event" );
+    ok( manual != NULL, "CreateEvent failed %u\n", GetLastError() );
+    autoev = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( autoev != NULL, "CreateEvent failed %u\n", GetLastError() );
+    status = pNtQueryObject( manual, ObjectNameInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %08x\n", status );
+
+    query_req = SERVER_INIT_BATCH_REQ( &reqs[0], query_event );
+    query_req->handle = wine_server_obj_handle( manual );
+
+    /* an error doesn't stop the following requests */
+    query_req = SERVER_INIT_BATCH_REQ( &reqs[1], query_event );
+    query_req->handle = 0xdeadbee0;
+
+    /* the reply data is truncated to the size of each request's buffer */
+    info_req = SERVER_INIT_BATCH_REQ( &reqs[2], get_object_info );
+    info_req->handle = wine_server_obj_handle( manual );
+    wine_server_set_reply( &reqs[2], name_data, sizeof(name_data) );
+
+    /* blocking requests aren't allowed */
+    (void)SERVER_INIT_BATCH_REQ( &reqs[3], select );
+
+    /* requests can carry data */
+    open_req = SERVER_INIT_BATCH_REQ( &reqs[4], open_event );
+    open_req->access = EVENT_QUERY_STATE;
+    wine_server_add_data( &reqs[4], name->Name.Buffer, name->Name.Length );
+
+    query_req = SERVER_INIT_BATCH_REQ( &reqs[5], query_event );
+    query_req->handle = wine_server_obj_handle( autoev );
+
+    status = pwine_server_call_batch( ptrs, 6 );
+    ok( status == STATUS_SUCCESS, "batch failed %08x\n", status );
+
+    ok( reqs[0].u.reply.reply_header.error == STATUS_SUCCESS, "got %08x\n", reqs[0].u.reply.reply_header.error );
+    ok( reqs[0].u.reply.query_event_reply.manual_reset == 1, "got manual_reset %d\n",
+        reqs[0].u.reply.query_event_reply.manual_reset );
+    ok( reqs[0].u.reply.query_event_reply.state == 1, "got state %d\n", reqs[0].u.reply.query_event_reply.state );
+
+    ok( reqs[1].u.reply.reply_header.error == STATUS_INVALID_HANDLE, "got %08x\n",
+        reqs[1].u.reply.reply_header.error );
+
+    ok( reqs[2].u.reply.reply_header.error == STATUS_SUCCESS, "got %08x\n", reqs[2].u.reply.reply_header.error );
+    ok( reqs[2].u.reply.reply_header.reply_size == sizeof(name_data), "got reply size %u\n",
+        reqs[2].u.reply.reply_header.reply_size );
+    ok( reqs[2].u.reply.get_object_info_reply.total == name->Name.Length, "got total %u, expected %u\n",
+        reqs[2].u.reply.get_object_info_reply.total, name->Name.Length );
+    ok( !memcmp( name_data, name->Name.Buffer, sizeof(name_data) ), "wrong name data\n" );
+
+    ok( reqs[3].u.reply.reply_header.error == STATUS_NOT_IMPLEMENTED, "got %08x\n",
+        reqs[3].u.reply.reply_header.error );
+
+    ok( reqs[4].u.reply.reply_header.error == STATUS_SUCCESS, "got %08x\n", reqs[4].u.reply.reply_header.error );
+    handle = wine_server_ptr_handle( reqs[4].u.reply.open_event_reply.handle );
+    ok( handle != NULL, "got NULL handle\n" );
+    ok( WaitForSingleObject( handle, 0 ) == WAIT_FAILED, "handle shouldn't have SYNCHRONIZE access\n" );
+    CloseHandle( handle );
+
+    ok( reqs[5].u.reply.reply_header.error == STATUS_SUCCESS, "got %08x\n", reqs[5].u.reply.reply_header.error );
+    ok( reqs[5].u.reply.query_event_reply.manual_reset == 0, "got manual_reset %d\n",
+        reqs[5].u.reply.query_event_reply.manual_reset );
+    ok( reqs[5].u.reply.query_event_reply.state == 0, "got state %d\n", reqs[5].u.reply.query_event_reply.state );
+
+    CloseHandle( autoev );
+    CloseHandle( manual );
+}
+
+static DWORD WINAPI request_throughput_thread( void *arg )
+{
+    HANDLE event = arg, handle;
+    char buffer[1024];
+    unsigned int i;
+    NTSTATUS status;
+    ULONG len;
+
+    for (i = 0; i < 20000; i++)
+    {
+        /* a small request with a variable-size reply */
+        status = pNtQueryObject( event, ObjectNameInformation, buffer, sizeof(buffer), &len );
+        ok( status == STATUS_SUCCESS, "NtQueryObject failed %08x\n", status );
+        /* a small request carrying variable-size data */
+        handle = OpenEventA( EVENT_ALL_ACCESS, FALSE, "om_request_throughput" );
+        ok( handle != NULL, "OpenEvent failed %u\n", GetLastError() );
+        CloseHandle( handle );
+    }
+    return 0;
+}
+
+static void test_request_throughput(void)
+{
+    static const unsigned int thread_counts[] = { 1, 2, 4, 8 };
+    HANDLE event, threads[8];
+    unsigned int i, j;
+    DWORD start;
+
+    if (!winetest_interactive) return;
+
+    event = CreateEventA( NULL, FALSE, FALSE, "om_request_throughput" );
+    ok( event != NULL, "CreateEvent failed %u\n", GetLastError() );
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+    {
+        start = GetTickCount();
+        for (j = 0; j < thread_counts[i]; j++)
+            threads[j] = CreateThread( NULL, 0, request_throughput_thread, event, 0, NULL );
+        WaitForMultipleObjects( thread_counts[i], threads, TRUE, INFINITE );
+        trace( "%u threads: %u requests in %u ms\n", thread_counts[i],
+               thread_counts[i] * 20000 * 3, GetTickCount() - start );
+        for (j = 0; j < thread_counts[i]; j++) CloseHandle( threads[j] );
+    }
+
+    CloseHandle( event );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2019,6 +2319,7 @@ START_TEST(om)
     pNtQuerySymbolicLinkObject  = (void *)GetProcAddress(hntdll, "NtQuerySymbolicLinkObject");
     pNtCreateSemaphore      =  (void *)GetProcAddress(hntdll, "NtCreateSemaphore");
     pNtOpenSemaphore        =  (void *)GetProcAddress(hntdll, "NtOpenSemaphore");
+    pNtQuerySemaphore       =  (void *)GetProcAddress(hntdll, "NtQuerySemaphore");
     pNtCreateTimer          =  (void *)GetProcAddress(hntdll, "NtCreateTimer");
     pNtOpenTimer            =  (void *)GetProcAddress(hntdll, "NtOpenTimer");
     pNtCreateSection        =  (void *)GetProcAddress(hntdll, "NtCreateSection");
@@ -2031,6 +2332,7 @@ START_TEST(om)
     pNtReleaseKeyedEvent    =  (void *)GetProcAddress(hntdll, "NtReleaseKeyedEvent");
     pNtCreateIoCompletion   =  (void *)GetProcAddress(hntdll, "NtCreateIoCompletion");
     pNtOpenIoCompletion     =  (void *)GetProcAddress(hntdll, "NtOpenIoCompletion");
+    pwine_server_call_batch =  (void *)GetProcAddress(hntdll, "wine_server_call_batch");
 
     test_case_sensitive();
     test_namespace_pipe();
@@ -2042,6 +2344,9 @@ START_TEST(om)
     test_type_mismatch();
     test_event();
     test_mutant();
+    test_unnamed_sync_objects();
     test_keyed_events();
     test_null_device();
+    test_batch_request();
+    test_request_throughput();
 }
@@ -705,6 +705,89 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+struct many_work_info
+{
+    LONG   count;
+    LONG   total;
+    HANDLE done;
+};
+
+static void CALLBACK many_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct many_work_info *info = userdata;
+    InterlockedIncrement(&info->count);
+}
+
+static void CALLBACK many_simple_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
+{
+    struct many_work_info *info = userdata;
+    if (InterlockedIncrement(&info->count) == info->total)
+        SetEvent(info->done);
+}
+
+static void test_tp_many_work_items(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    struct many_work_info info;
+    TP_WORK *work[16];
+    NTSTATUS status;
+    TP_POOL *pool;
+    DWORD ticks, result;
+    int i, count;
+
+    /* run millions of tiny work items when benchmarking */
+    count = winetest_debug > 1 ? 4000000 : 40000;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    for (i = 0; i < sizeof(work)/sizeof(work[0]); i++)
+    {
+        work[i] = NULL;
+        status = pTpAllocWork(&work[i], many_work_cb, &info, &environment);
+        ok(!status, "TpAllocWork failed with status %x\n", status);
+        ok(work[i] != NULL, "expected work != NULL\n");
+    }
+
+    info.count = 0;
+    ticks = GetTickCount();
+    for (i = 0; i < count; i++)
+        pTpPostWork(work[i % (sizeof(work)/sizeof(work[0]))]);
+    for (i = 0; i < sizeof(work)/sizeof(work[0]); i++)
+        pTpWaitForWork(work[i], FALSE);
+    ticks = GetTickCount() - ticks;
+    ok(info.count == count, "expected %u callbacks, got %u\n", count, info.count);
+    if (winetest_debug > 1) trace("%u work callbacks: %u ms\n", count, ticks);
+
+    for (i = 0; i < sizeof(work)/sizeof(work[0]); i++)
+        pTpReleaseWork(work[i]);
+
+    /* simple callbacks allocate an object each time */
+    count /= 10;
+    info.count = 0;
+    info.total = count;
+    info.done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ticks = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        status = pTpSimpleTryPost(many_simple_cb, &info, &environment);
+        ok(!status, "TpSimpleTryPost failed with status %x\n", status);
+    }
+    result = WaitForSingleObject(info.done, 60000);
+    ticks = GetTickCount() - ticks;
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    ok(info.count == count, "expected %u callbacks, got %u\n", count, info.count);
+    if (winetest_debug > 1) trace("%u simple callbacks: %u ms\n", count, ticks);
+
+    CloseHandle(info.done);
+    pTpReleasePool(pool);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -1908,6 +1991,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_many_work_items();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -114,8 +114,18 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_QUEUES         16    /* number of work queues per pool */
+#define THREADPOOL_MAX_LATENCY    20    /* queue latency (in ms) that triggers a new worker */
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
+/* queue of objects with pending callbacks. Workers take callbacks from their
+ * own queue first, and steal from the other queues when it is empty. */
+struct threadpool_queue
+{
+    CRITICAL_SECTION        cs;
+    struct list             objects;
+};
+
 /* internal threadpool representation */
 struct threadpool
 {
@@ -123,14 +133,20 @@ struct threadpool
     LONG                    objcount;
     BOOL                    shutdown;
     CRITICAL_SECTION        cs;
-    /* pool of work items, locked via .cs */
-    struct list             pool;
+    /* pool of work items, each queue is locked via its own .cs */
+    struct threadpool_queue queues[THREADPOOL_QUEUES];
+    LONG                    num_queued;         /* pending callbacks, changed under a queue lock */
+    LONG                    next_queue;         /* queue for the next object */
+    LONG                    next_worker_queue;  /* queue for the next worker */
     RTL_CONDITION_VARIABLE  update_event;
     /* information about worker threads, locked via .cs */
     int                     max_workers;
     int                     min_workers;
     int                     num_workers;
-    int                     num_busy_workers;
+    /* workers running callbacks or looking for some, and workers waiting for
+     * update_event; both are updated with interlocked operations */
+    LONG                    num_busy_workers;
+    LONG                    num_sleeping_workers;
 };
 
 enum threadpool_objtype
@@ -158,8 +174,10 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
-    /* information about the pool, locked via .pool->cs */
+    /* information about the pool, locked via .queue->cs */
+    struct threadpool_queue *queue;
     struct list             pool_entry;
+    DWORD                   queued_time;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
     LONG                    num_pending_callbacks;
@@ -1302,7 +1320,7 @@ static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
     {
         interlocked_inc( &pool->refcount );
         pool->num_workers++;
-        pool->num_busy_workers++;
+        interlocked_inc( &pool->num_busy_workers );
         NtClose( thread );
     }
     return status;
@@ -1639,6 +1657,7 @@ static void tp_waitqueue_unlock( struct threadpool_object *wait )
 static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
 {
     struct threadpool *pool;
+    unsigned int i;
 
     pool = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*pool) );
     if (!pool)
@@ -1651,13 +1670,22 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     RtlInitializeCriticalSection( &pool->cs );
     pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
 
-    list_init( &pool->pool );
+    for (i = 0; i < THREADPOOL_QUEUES; i++)
+    {
+        RtlInitializeCriticalSectionAndSpinCount( &pool->queues[i].cs, 4000 );
+        pool->queues[i].cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool_queue.cs");
+        list_init( &pool->queues[i].objects );
+    }
+    pool->num_queued            = 0;
+    pool->next_queue            = 0;
+    pool->next_worker_queue     = 0;
     RtlInitializeConditionVariable( &pool->update_event );
 
     pool->max_workers           = 500;
     pool->min_workers           = 0;
     pool->num_workers           = 0;
     pool->num_busy_workers      = 0;
+    pool->num_sleeping_workers  = 0;
 
     TRACE( "allocated threadpool %p\n", pool );
 
@@ -1687,6 +1715,8 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
  */
 static BOOL tp_threadpool_release( struct threadpool *pool )
 {
+    unsigned int i;
+
     if (interlocked_dec( &pool->refcount ))
         return FALSE;
 
@@ -1694,7 +1724,14 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
 
     assert( pool->shutdown );
     assert( !pool->objcount );
-    assert( list_empty( &pool->pool ) );
+    assert( !pool->num_queued );
+
+    for (i = 0; i < THREADPOOL_QUEUES; i++)
+    {
+        assert( list_empty( &pool->queues[i].objects ) );
+        pool->queues[i].cs.DebugInfo->Spare[0] = 0;
+        RtlDeleteCriticalSection( &pool->queues[i].cs );
+    }
 
     pool->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &pool->cs );
@@ -1845,6 +1882,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->shutdown                = FALSE;
 
     object->pool                    = pool;
+    object->queue                   = &pool->queues[(ULONG)interlocked_xchg_add( &pool->next_queue, 1 ) % THREADPOOL_QUEUES];
     object->group                   = NULL;
     object->userdata                = userdata;
     object->group_cancel_callback   = NULL;
@@ -1856,6 +1894,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->is_group_member         = FALSE;
 
     memset( &object->pool_entry, 0, sizeof(object->pool_entry) );
+    object->queued_time             = 0;
     RtlInitializeConditionVariable( &object->finished_event );
     RtlInitializeConditionVariable( &object->group_finished_event );
     object->num_pending_callbacks   = 0;
@@ -1916,27 +1955,42 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
-    RtlEnterCriticalSection( &pool->cs );
-
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
-        pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    RtlEnterCriticalSection( &queue->cs );
 
     /* Queue work item and increment refcount. */
     interlocked_inc( &object->refcount );
     if (!object->num_pending_callbacks++)
-        list_add_tail( &pool->pool, &object->pool_entry );
+    {
+        list_add_tail( &queue->objects, &object->pool_entry );
+        object->queued_time = NtGetTickCount();
+    }
+    interlocked_inc( &pool->num_queued );
 
     /* Count how often the object was signaled. */
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
+    RtlLeaveCriticalSection( &queue->cs );
+
+    /* Workers count themselves as busy before looking for work, and as sleeping
+     * before checking num_queued a last time, so if neither a sleeping nor an
+     * idle worker is seen here, no worker will pick up the new item. */
+    if (!pool->num_sleeping_workers && pool->num_busy_workers < pool->num_workers)
+        return;
+
+    RtlEnterCriticalSection( &pool->cs );
+
+    /* Start new worker threads if required. */
+    if (pool->num_busy_workers >= pool->num_workers &&
+        pool->num_workers < pool->max_workers)
+        status = tp_new_worker_thread( pool );
+
     /* No new thread started - wake up one existing thread. */
     if (status != STATUS_SUCCESS)
     {
@@ -1955,19 +2009,21 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 static void tp_object_cancel( struct threadpool_object *object )
 {
     struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
     LONG pending_callbacks = 0;
 
-    RtlEnterCriticalSection( &pool->cs );
+    RtlEnterCriticalSection( &queue->cs );
     if (object->num_pending_callbacks)
     {
         pending_callbacks = object->num_pending_callbacks;
         object->num_pending_callbacks = 0;
         list_remove( &object->pool_entry );
+        interlocked_xchg_add( &pool->num_queued, -pending_callbacks );
 
         if (object->type == TP_OBJECT_TYPE_WAIT)
             object->u.wait.signaled = 0;
     }
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
 
     while (pending_callbacks--)
         tp_object_release( object );
@@ -1981,20 +2037,20 @@ static void tp_object_cancel( struct threadpool_object *object )
  */
 static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
 {
-    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
 
-    RtlEnterCriticalSection( &pool->cs );
+    RtlEnterCriticalSection( &queue->cs );
     if (group_wait)
     {
         while (object->num_pending_callbacks || object->num_running_callbacks)
-            RtlSleepConditionVariableCS( &object->group_finished_event, &pool->cs, NULL );
+            RtlSleepConditionVariableCS( &object->group_finished_event, &queue->cs, NULL );
     }
     else
     {
         while (object->num_pending_callbacks || object->num_associated_callbacks)
-            RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
+            RtlSleepConditionVariableCS( &object->finished_event, &queue->cs, NULL );
     }
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
 }
 
 /***********************************************************************
@@ -2052,6 +2108,77 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
+/***********************************************************************
+ *           tp_object_dequeue    (internal)
+ *
+ * Takes the next pending callback, from the given queue first, and then
+ * from the other queues of the pool. The callback is accounted as running.
+ */
+static struct threadpool_object *tp_object_dequeue( struct threadpool *pool, unsigned int index,
+                                                    TP_WAIT_RESULT *wait_result )
+{
+    struct threadpool_object *object;
+    struct threadpool_queue *queue;
+    struct list *ptr;
+    DWORD now, latency;
+    unsigned int i;
+
+    for (i = 0; i < THREADPOOL_QUEUES && pool->num_queued; i++)
+    {
+        queue = &pool->queues[(index + i) % THREADPOOL_QUEUES];
+        if (list_empty( &queue->objects )) continue;  /* checked again with the lock held */
+
+        RtlEnterCriticalSection( &queue->cs );
+        if (!(ptr = list_head( &queue->objects )))
+        {
+            RtlLeaveCriticalSection( &queue->cs );
+            continue;
+        }
+
+        object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
+        assert( object->num_pending_callbacks > 0 );
+
+        /* If further pending callbacks are queued, move the work item to
+         * the end of the queue. Otherwise remove it from the queue. */
+        now = NtGetTickCount();
+        latency = now - object->queued_time;
+        list_remove( &object->pool_entry );
+        if (--object->num_pending_callbacks)
+        {
+            list_add_tail( &queue->objects, &object->pool_entry );
+            object->queued_time = now;
+        }
+        interlocked_dec( &pool->num_queued );
+
+        /* For wait objects check if they were signaled or have timed out. */
+        if (object->type == TP_OBJECT_TYPE_WAIT)
+        {
+            *wait_result = object->u.wait.signaled ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+            if (*wait_result == WAIT_OBJECT_0) object->u.wait.signaled--;
+        }
+
+        object->num_associated_callbacks++;
+        object->num_running_callbacks++;
+        RtlLeaveCriticalSection( &queue->cs );
+
+        /* Callbacks waited too long although workers seemed available,
+         * start a new worker if the remaining ones are all busy. */
+        if (latency >= THREADPOOL_MAX_LATENCY && pool->num_queued &&
+            !pool->num_sleeping_workers && pool->num_workers < pool->max_workers)
+        {
+            RtlEnterCriticalSection( &pool->cs );
+            if (pool->num_workers < pool->max_workers)
+            {
+                TRACE( "queue latency %u ms, starting a new worker for pool %p\n", latency, pool );
+                tp_new_worker_thread( pool );
+            }
+            RtlLeaveCriticalSection( &pool->cs );
+        }
+        return object;
+    }
+    return NULL;
+}
+
 /***********************************************************************
  *           threadpool_worker_proc    (internal)
  */
@@ -2060,41 +2187,21 @@ static void CALLBACK threadpool_worker_proc( void *param )
     TP_CALLBACK_INSTANCE *callback_instance;
     struct threadpool_instance instance;
     struct threadpool *pool = param;
+    struct threadpool_object *object;
+    struct threadpool_queue *queue;
     TP_WAIT_RESULT wait_result = 0;
     LARGE_INTEGER timeout;
-    struct list *ptr;
+    unsigned int index;
     NTSTATUS status;
 
     TRACE( "starting worker thread for pool %p\n", pool );
 
-    RtlEnterCriticalSection( &pool->cs );
-    pool->num_busy_workers--;
+    /* the worker has been accounted as busy by tp_new_worker_thread */
+    index = (ULONG)interlocked_xchg_add( &pool->next_worker_queue, 1 ) % THREADPOOL_QUEUES;
     for (;;)
     {
-        while ((ptr = list_head( &pool->pool )))
+        while ((object = tp_object_dequeue( pool, index, &wait_result )))
         {
-            struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
-            assert( object->num_pending_callbacks > 0 );
-
-            /* If further pending callbacks are queued, move the work item to
-             * the end of the pool list. Otherwise remove it from the pool. */
-            list_remove( &object->pool_entry );
-            if (--object->num_pending_callbacks)
-                list_add_tail( &pool->pool, &object->pool_entry );
-
-            /* For wait objects check if they were signaled or have timed out. */
-            if (object->type == TP_OBJECT_TYPE_WAIT)
-            {
-                wait_result = object->u.wait.signaled ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
-                if (wait_result == WAIT_OBJECT_0) object->u.wait.signaled--;
-            }
-
-            /* Leave critical section and do the actual callback. */
-            object->num_associated_callbacks++;
-            object->num_running_callbacks++;
-            pool->num_busy_workers++;
-            RtlLeaveCriticalSection( &pool->cs );
-
             /* Initialize threadpool instance struct. */
             callback_instance = (TP_CALLBACK_INSTANCE *)&instance;
             instance.object                     = object;
@@ -2186,8 +2293,8 @@ static void CALLBACK threadpool_worker_proc( void *param )
             }
 
         skip_cleanup:
-            RtlEnterCriticalSection( &pool->cs );
-            pool->num_busy_workers--;
+            queue = object->queue;
+            RtlEnterCriticalSection( &queue->cs );
 
             /* Simple callbacks are automatically shutdown after execution. */
             if (object->type == TP_OBJECT_TYPE_SIMPLE)
@@ -2207,27 +2314,43 @@ static void CALLBACK threadpool_worker_proc( void *param )
                     RtlWakeAllConditionVariable( &object->finished_event );
             }
 
+            RtlLeaveCriticalSection( &queue->cs );
             tp_object_release( object );
         }
+        interlocked_dec( &pool->num_busy_workers );
+
+        RtlEnterCriticalSection( &pool->cs );
 
         /* Shutdown worker thread if requested. */
-        if (pool->shutdown)
+        if (pool->shutdown && !pool->num_queued)
+        {
+            pool->num_workers--;
             break;
+        }
 
         /* Wait for new tasks or until the timeout expires. A thread only terminates
          * when no new tasks are available, and the number of threads can be
          * decreased without violating the min_workers limit. An exception is when
          * min_workers == 0, then objcount is used to detect if the last thread
-         * can be terminated. */
-        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !list_head( &pool->pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+         * can be terminated. The worker is counted as sleeping before num_queued
+         * is checked, see tp_object_submit. */
+        interlocked_inc( &pool->num_sleeping_workers );
+        if (!pool->num_queued && !pool->shutdown)
         {
-            break;
+            timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+            if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
+                !pool->num_queued && (pool->num_workers > max( pool->min_workers, 1 ) ||
+                (!pool->min_workers && !pool->objcount)))
+            {
+                pool->num_workers--;
+                interlocked_dec( &pool->num_sleeping_workers );
+                break;
+            }
         }
+        interlocked_dec( &pool->num_sleeping_workers );
+        interlocked_inc( &pool->num_busy_workers );
+        RtlLeaveCriticalSection( &pool->cs );
     }
-    pool->num_workers--;
     RtlLeaveCriticalSection( &pool->cs );
 
     TRACE( "terminating worker thread for pool %p\n", pool );
@@ -2486,7 +2609,7 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
 {
     struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
     struct threadpool_object *object = this->object;
-    struct threadpool *pool;
+    struct threadpool_queue *queue;
 
     TRACE( "%p\n", instance );
 
@@ -2499,14 +2622,14 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
     if (!this->associated)
         return;
 
-    pool = object->pool;
-    RtlEnterCriticalSection( &pool->cs );
+    queue = object->queue;
+    RtlEnterCriticalSection( &queue->cs );
 
     object->num_associated_callbacks--;
     if (!object->num_pending_callbacks && !object->num_associated_callbacks)
         RtlWakeAllConditionVariable( &object->finished_event );
 
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
     this->associated = FALSE;
 }
 
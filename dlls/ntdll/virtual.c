@@ -41,9 +41,18 @@
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_SYS_IOCTL_H
+# include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_SYSINFO_H
 # include <sys/sysinfo.h>
 #endif
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <linux/userfaultfd.h>
+#endif
 #ifdef HAVE_VALGRIND_VALGRIND_H
 # include <valgrind/valgrind.h>
 #endif
@@ -86,6 +95,55 @@ struct file_view
 #define VPROT_WRITEWATCH 0x40
 /* per-mapping protection flags */
 #define VPROT_SYSTEM     0x0200  /* system view (underlying mmap not under our control) */
+#define VPROT_KERNEL_WATCH 0x0400  /* write watches are tracked by the kernel */
+
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(__NR_userfaultfd) && defined(UFFDIO_WRITEPROTECT_MODE_WP)
+#define USE_KERNEL_WRITE_WATCH
+
+/* definitions from Linux 6.7, in case the headers are older */
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+#ifndef PAGEMAP_SCAN
+#define PAGE_IS_WRITTEN       (1 << 1)
+#define PM_SCAN_WP_MATCHING   (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC (1 << 1)
+
+struct page_region
+{
+    __u64 start;
+    __u64 end;
+    __u64 categories;
+};
+
+struct pm_scan_arg
+{
+    __u64 size;
+    __u64 flags;
+    __u64 start;
+    __u64 end;
+    __u64 walk_end;
+    __u64 vec;
+    __u64 vec_len;
+    __u64 max_pages;
+    __u64 category_inverted;
+    __u64 category_mask;
+    __u64 category_anyof_mask;
+    __u64 return_mask;
+};
+
+#define PAGEMAP_SCAN _IOWR('f', 16, struct pm_scan_arg)
+#endif
+
+static int uffd_fd = -1;     /* userfaultfd write protecting the write watch views */
+static int pagemap_fd = -1;  /* /proc/self/pagemap, used to collect the written pages */
+#endif  /* HAVE_LINUX_USERFAULTFD_H */
 
 /* Conversion from VPROT_* to Win32 flags */
 static const BYTE VIRTUAL_Win32Flags[16] =
@@ -119,6 +177,23 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static RTL_CRITICAL_SECTION csVirtual = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* Modifications of the views tree and of the page protections are done with
+ * csVirtual held, and additionally take this lock exclusively, so that pure
+ * queries only need to take it shared and don't have to wait for csVirtual. */
+static RTL_SRWLOCK views_lock = RTL_SRWLOCK_INIT;
+
+/* range of addresses where all the gaps between views are known to be at most
+ * max_gap bytes; used to skip the scan of densely allocated areas */
+struct view_gaps
+{
+    char   *start;
+    char   *end;
+    size_t  max_gap;
+};
+
+static struct view_gaps bottom_up_gaps;    /* grows upwards from the lowest scanned address */
+static struct view_gaps top_down_gaps;     /* grows downwards from the highest scanned address */
+
 #ifdef __i386__
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
@@ -204,6 +279,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    RtlAcquireSRWLockExclusive( &views_lock );
 #ifdef _WIN64
     while (idx >> pages_vprot_shift != end >> pages_vprot_shift)
     {
@@ -215,6 +291,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
 #else
     memset( pages_vprot + idx, vprot, end - idx );
 #endif
+    RtlReleaseSRWLockExclusive( &views_lock );
 }
 
 
@@ -228,6 +305,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    RtlAcquireSRWLockExclusive( &views_lock );
 #ifdef _WIN64
     for ( ; idx < end; idx++)
     {
@@ -237,6 +315,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
 #else
     for ( ; idx < end; idx++) pages_vprot[idx] = (pages_vprot[idx] & ~clear) | set;
 #endif
+    RtlReleaseSRWLockExclusive( &views_lock );
 }
 
 
@@ -451,12 +530,14 @@ static struct file_view *find_view_range( const void *addr, size_t size )
 
 
 /***********************************************************************
- *           find_free_area
+ *           scan_free_area
  *
  * Find a free area between views inside the specified range.
+ * Also return the range that was scanned and the largest gap found in it.
  * The csVirtual section must be held by caller.
  */
-static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+static void *scan_free_area( void *base, void *end, size_t size, size_t mask, int top_down,
+                             struct view_gaps *scanned )
 {
     struct wine_rb_entry *first = NULL, *ptr = views_tree.root;
     void *start;
@@ -482,8 +563,10 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
         }
     }
 
+    scanned->max_gap = 0;
     if (top_down)
     {
+        scanned->start = scanned->end = end;
         start = ROUND_ADDR( (char *)end - size, mask );
         if (start >= end || start < base) return NULL;
 
@@ -492,6 +575,8 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
             struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
 
             if ((char *)view->base + view->size <= (char *)start) break;
+            scanned->max_gap = max( scanned->max_gap, scanned->start - ((char *)view->base + view->size) );
+            scanned->start = view->base;
             start = ROUND_ADDR( (char *)view->base - size, mask );
             /* stop if remaining space is not large enough */
             if (!start || start >= end || start < base) return NULL;
@@ -500,6 +585,7 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
     }
     else
     {
+        scanned->start = scanned->end = base;
         start = ROUND_ADDR( (char *)base + mask, mask );
         if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
 
@@ -508,6 +594,8 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
             struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
 
             if ((char *)view->base >= (char *)start + size) break;
+            scanned->max_gap = max( scanned->max_gap, (char *)view->base - scanned->end );
+            scanned->end = (char *)view->base + view->size;
             start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
             /* stop if remaining space is not large enough */
             if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
@@ -518,6 +606,80 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
 }
 
 
+/***********************************************************************
+ *           find_free_area
+ *
+ * Find a free area between views inside the specified range.
+ * The csVirtual section must be held by caller.
+ */
+static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+{
+    struct view_gaps *range = top_down ? &top_down_gaps : &bottom_up_gaps;
+    struct view_gaps scanned;
+    void *start = NULL;
+    BOOL skip;
+
+    /* skip the part of the range where we know that no gap is large enough */
+    if (top_down)
+    {
+        skip = (char *)end > range->start && (char *)end <= range->end && size > range->max_gap;
+        if (skip) start = scan_free_area( base, range->start, size, mask, top_down, &scanned );
+    }
+    else
+    {
+        skip = (char *)base >= range->start && (char *)base < range->end && size > range->max_gap;
+        if (skip) start = scan_free_area( range->end, end, size, mask, top_down, &scanned );
+    }
+    if (!start)
+    {
+        skip = FALSE;
+        if (!(start = scan_free_area( base, end, size, mask, top_down, &scanned ))) return NULL;
+    }
+
+    /* extend the known range if the scan started inside it, otherwise replace it */
+    if (top_down)
+    {
+        if (skip || (scanned.end >= range->start && scanned.end <= range->end))
+        {
+            range->start = min( range->start, scanned.start );
+            range->max_gap = max( range->max_gap, scanned.max_gap );
+        }
+        else *range = scanned;
+    }
+    else
+    {
+        if (skip || (scanned.start >= range->start && scanned.start <= range->end))
+        {
+            range->end = max( range->end, scanned.end );
+            range->max_gap = max( range->max_gap, scanned.max_gap );
+        }
+        else *range = scanned;
+    }
+    return start;
+}
+
+
+/***********************************************************************
+ *           invalidate_view_gaps
+ *
+ * Update the known free ranges when the gap between two views has grown.
+ * The csVirtual section must be held by caller.
+ */
+static void invalidate_view_gaps( char *gap_start, char *gap_end )
+{
+    if (gap_start < bottom_up_gaps.end && gap_end > bottom_up_gaps.start)
+    {
+        bottom_up_gaps.end = max( bottom_up_gaps.start, gap_start );
+        if (bottom_up_gaps.end == bottom_up_gaps.start) bottom_up_gaps.max_gap = 0;
+    }
+    if (gap_start < top_down_gaps.end && gap_end > top_down_gaps.start)
+    {
+        top_down_gaps.start = min( top_down_gaps.end, gap_end );
+        if (top_down_gaps.end == top_down_gaps.start) top_down_gaps.max_gap = 0;
+    }
+}
+
+
 /***********************************************************************
  *           add_reserved_area
  *
@@ -538,7 +700,9 @@ static void add_reserved_area( void *addr, size_t size )
     }
     /* blow away existing mappings */
     wine_anon_mmap( addr, size, PROT_NONE, MAP_NORESERVE | MAP_FIXED );
+    RtlAcquireSRWLockExclusive( &views_lock );
     wine_mmap_add_reserved_area( addr, size );
+    RtlReleaseSRWLockExclusive( &views_lock );
 }
 
 
@@ -553,7 +717,9 @@ static void remove_reserved_area( void *addr, size_t size )
     struct file_view *view;
 
     TRACE( "removing %p-%p\n", addr, (char *)addr + size );
+    RtlAcquireSRWLockExclusive( &views_lock );
     wine_mmap_remove_reserved_area( addr, size, 0 );
+    RtlReleaseSRWLockExclusive( &views_lock );
 
     /* unmap areas not covered by an existing view */
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
@@ -684,9 +850,23 @@ static struct file_view *alloc_view(void)
  */
 static void delete_view( struct file_view *view ) /* [in] View */
 {
+    struct wine_rb_entry *prev = wine_rb_prev( &view->entry );
+    struct wine_rb_entry *next = wine_rb_next( &view->entry );
+    char *gap_start = NULL, *gap_end = (char *)~(UINT_PTR)0;
+
+    if (prev)
+    {
+        struct file_view *prev_view = WINE_RB_ENTRY_VALUE( prev, struct file_view, entry );
+        gap_start = (char *)prev_view->base + prev_view->size;
+    }
+    if (next) gap_end = WINE_RB_ENTRY_VALUE( next, struct file_view, entry )->base;
+    invalidate_view_gaps( gap_start, gap_end );
+
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
     set_page_vprot( view->base, view->size, 0 );
+    RtlAcquireSRWLockExclusive( &views_lock );
     wine_rb_remove( &views_tree, &view->entry );
+    RtlReleaseSRWLockExclusive( &views_lock );
     *(struct file_view **)view = next_free_view;
     next_free_view = view;
 }
@@ -732,7 +912,9 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     view->protect = vprot;
     set_page_vprot( base, size, vprot );
 
+    RtlAcquireSRWLockExclusive( &views_lock );
     wine_rb_put( &views_tree, view->base, &view->entry );
+    RtlReleaseSRWLockExclusive( &views_lock );
 
     *view_ret = view;
 
@@ -926,6 +1108,228 @@ static NTSTATUS set_protection( struct file_view *view, void *base, SIZE_T size,
 }
 
 
+/***********************************************************************
+ *           use_kernel_write_watches
+ *
+ * Check whether the kernel can track the written pages of write watch views,
+ * using asynchronous userfaultfd write protection and the PAGEMAP_SCAN ioctl.
+ * This avoids taking a page fault for every page written by the application.
+ */
+static BOOL use_kernel_write_watches(void)
+{
+#ifdef USE_KERNEL_WRITE_WATCH
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEKERNELWRITEWATCH" );
+        struct uffdio_api api;
+
+        enabled = 0;
+        if (env && !atoi( env )) return FALSE;
+
+        if ((uffd_fd = syscall( __NR_userfaultfd, UFFD_USER_MODE_ONLY | O_CLOEXEC | O_NONBLOCK )) == -1)
+            return FALSE;
+        api.api = UFFD_API;
+        api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+        api.ioctls = 0;
+        if (ioctl( uffd_fd, UFFDIO_API, &api ) == -1 ||
+            (pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1)
+        {
+            close( uffd_fd );
+            uffd_fd = -1;
+            return FALSE;
+        }
+        TRACE( "using kernel write watches\n" );
+        enabled = 1;
+    }
+    return enabled;
+#else
+    return FALSE;
+#endif
+}
+
+
+/***********************************************************************
+ *           reset_kernel_write_watches
+ *
+ * Write protect a range again, so that the kernel clears its written state.
+ */
+static BOOL reset_kernel_write_watches( void *base, size_t size )
+{
+#ifdef USE_KERNEL_WRITE_WATCH
+    struct uffdio_writeprotect wp;
+
+    wp.range.start = (UINT_PTR)base;
+    wp.range.len   = size;
+    wp.mode        = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (!ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp )) return TRUE;
+    ERR( "failed to write protect %p-%p: %s\n", base, (char *)base + size, strerror(errno) );
+#endif
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           enable_kernel_write_watches
+ *
+ * Let the kernel track the writes to a newly created write watch view.
+ * The csVirtual section must be held by caller.
+ */
+static void enable_kernel_write_watches( struct file_view *view )
+{
+#ifdef USE_KERNEL_WRITE_WATCH
+    struct uffdio_register reg;
+
+    if (!use_kernel_write_watches()) return;
+
+#ifdef MADV_NOHUGEPAGE
+    madvise( view->base, view->size, MADV_NOHUGEPAGE );  /* written pages are reported per page */
+#endif
+    reg.range.start = (UINT_PTR)view->base;
+    reg.range.len   = view->size;
+    reg.mode        = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &reg ) == -1)
+    {
+        WARN( "failed to register %p-%p: %s\n", view->base, (char *)view->base + view->size, strerror(errno) );
+        return;
+    }
+    if (!reset_kernel_write_watches( view->base, view->size ))
+    {
+        ioctl( uffd_fd, UFFDIO_UNREGISTER, &reg.range );
+        return;
+    }
+
+    RtlAcquireSRWLockExclusive( &views_lock );
+    view->protect |= VPROT_KERNEL_WATCH;
+    RtlReleaseSRWLockExclusive( &views_lock );
+
+    /* the pages don't need to be write protected by us anymore */
+    set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+    mprotect_range( view->base, view->size, 0, 0 );
+#endif
+}
+
+
+/***********************************************************************
+ *           get_kernel_write_watches
+ *
+ * Retrieve the pages written since the last reset from the kernel.
+ */
+static ULONG_PTR get_kernel_write_watches( void *base, size_t size, void **addresses, ULONG_PTR count,
+                                           BOOL reset )
+{
+    ULONG_PTR pos = 0;
+#ifdef USE_KERNEL_WRITE_WATCH
+    struct page_region regions[64];
+    struct pm_scan_arg arg;
+    char *end = (char *)base + size;
+    __u64 addr;
+    int i, ret;
+
+    memset( &arg, 0, sizeof(arg) );
+    arg.size          = sizeof(arg);
+    arg.flags         = PM_SCAN_CHECK_WPASYNC | (reset ? PM_SCAN_WP_MATCHING : 0);
+    arg.start         = (UINT_PTR)base;
+    arg.end           = (UINT_PTR)end;
+    arg.vec           = (UINT_PTR)regions;
+    arg.vec_len       = sizeof(regions) / sizeof(regions[0]);
+    arg.category_mask = PAGE_IS_WRITTEN;
+    arg.return_mask   = PAGE_IS_WRITTEN;
+
+    while (pos < count && arg.start < arg.end)
+    {
+        arg.max_pages = count - pos;
+        if ((ret = ioctl( pagemap_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            ERR( "failed to scan %p-%p: %s\n", base, end, strerror(errno) );
+            break;
+        }
+        for (i = 0; i < ret; i++)
+            for (addr = regions[i].start; addr < regions[i].end && pos < count; addr += page_size)
+                addresses[pos++] = (void *)(UINT_PTR)addr;
+        if (arg.walk_end <= arg.start) break;
+        arg.start = arg.walk_end;
+    }
+#endif
+    return pos;
+}
+
+
+#ifdef USE_KERNEL_WRITE_WATCH
+/***********************************************************************
+ *           copy_kernel_write_watches
+ *
+ * Clear the write watch flag of the pages of a range written since the last reset.
+ */
+static void copy_kernel_write_watches( char *addr, char *end )
+{
+    void *addresses[64];
+    ULONG_PTR i, count;
+
+    while (addr < end)
+    {
+        count = get_kernel_write_watches( addr, end - addr, addresses,
+                                          sizeof(addresses) / sizeof(addresses[0]), FALSE );
+        for (i = 0; i < count; i++) set_page_vprot_bits( addresses[i], page_size, 0, VPROT_WRITEWATCH );
+        if (count < sizeof(addresses) / sizeof(addresses[0])) break;
+        addr = (char *)addresses[count - 1] + page_size;
+    }
+}
+#endif
+
+
+/***********************************************************************
+ *           disable_kernel_write_watches
+ *
+ * Go back to tracking the writes to a view with page protections, except for
+ * a range that is no longer registered with the userfaultfd.
+ * The csVirtual section must be held by caller.
+ */
+static void disable_kernel_write_watches( struct file_view *view, char *base, size_t size )
+{
+#ifdef USE_KERNEL_WRITE_WATCH
+    struct uffdio_range range;
+
+    /* carry over the pages written so far */
+    set_page_vprot_bits( view->base, view->size, VPROT_WRITEWATCH, 0 );
+    copy_kernel_write_watches( view->base, base );
+    copy_kernel_write_watches( base + size, (char *)view->base + view->size );
+
+    range.start = (UINT_PTR)view->base;
+    range.len   = view->size;
+    ioctl( uffd_fd, UFFDIO_UNREGISTER, &range );
+
+    RtlAcquireSRWLockExclusive( &views_lock );
+    view->protect &= ~VPROT_KERNEL_WATCH;
+    RtlReleaseSRWLockExclusive( &views_lock );
+
+    mprotect_range( view->base, view->size, 0, 0 );
+#endif
+}
+
+
+/***********************************************************************
+ *           rewatch_kernel_write_watches
+ *
+ * Register again a range of a view that has been replaced by a new mapping.
+ * The csVirtual section must be held by caller.
+ */
+static void rewatch_kernel_write_watches( struct file_view *view, char *base, size_t size )
+{
+#ifdef USE_KERNEL_WRITE_WATCH
+    struct uffdio_register reg;
+
+    reg.range.start = (UINT_PTR)base;
+    reg.range.len   = size;
+    reg.mode        = UFFDIO_REGISTER_MODE_WP;
+    if (!ioctl( uffd_fd, UFFDIO_REGISTER, &reg ) && reset_kernel_write_watches( base, size )) return;
+    WARN( "failed to register %p-%p again: %s\n", base, base + size, strerror(errno) );
+    disable_kernel_write_watches( view, base, size );
+#endif
+}
+
+
 /***********************************************************************
  *           update_write_watches
  */
@@ -944,8 +1348,9 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
  *
  * Reset write watches in a memory range.
  */
-static void reset_write_watches( void *base, SIZE_T size )
+static void reset_write_watches( struct file_view *view, void *base, SIZE_T size )
 {
+    if ((view->protect & VPROT_KERNEL_WATCH) && reset_kernel_write_watches( base, size )) return;
     set_page_vprot_bits( base, size, VPROT_WRITEWATCH, 0 );
     mprotect_range( base, size, 0, 0 );
 }
@@ -1253,6 +1658,9 @@ static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t siz
     if (wine_anon_mmap( (char *)view->base + start, size, PROT_NONE, MAP_FIXED ) != (void *)-1)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping isn't registered with the userfaultfd */
+        if (view->protect & VPROT_KERNEL_WATCH)
+            rewatch_kernel_write_watches( view, (char *)view->base + start, size );
         return STATUS_SUCCESS;
     }
     return FILE_GetNtStatus();
@@ -1966,7 +2374,9 @@ NTSTATUS virtual_alloc_thread_stack( TEB *teb, SIZE_T reserve_size, SIZE_T commi
 
         /* shrink the first view and create a second one for the extra size */
         /* this allows the app to free the stack without freeing the thread start portion */
+        RtlAcquireSRWLockExclusive( &views_lock );
         view->size -= extra_size;
+        RtlReleaseSRWLockExclusive( &views_lock );
         status = create_view( &extra_view, (char *)view->base + view->size, extra_size,
                               VPROT_READ | VPROT_WRITE | VPROT_COMMITTED );
         if (status != STATUS_SUCCESS)
@@ -2546,7 +2956,11 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG zero_
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
             else status = map_view( &view, base, size, mask, type & MEM_TOP_DOWN, vprot );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (vprot & VPROT_WRITEWATCH) enable_kernel_write_watches( view );
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -2780,77 +3194,19 @@ static int get_free_mem_state_callback( void *start, size_t size, void *arg )
     return 1;
 }
 
-#define UNIMPLEMENTED_INFO_CLASS(c) \
-    case c: \
-        FIXME("(process=%p,addr=%p) Unimplemented information class: " #c "\n", process, addr); \
-        return STATUS_INVALID_INFO_CLASS
-
 /***********************************************************************
- *             NtQueryVirtualMemory   (NTDLL.@)
- *             ZwQueryVirtualMemory   (NTDLL.@)
+ *           get_basic_memory_info
+ *
+ * Fill the MEMORY_BASIC_INFORMATION for a given page. Either csVirtual or the
+ * views lock must be held by caller. When only the views lock is held, fail for
+ * mappings whose committed state has to be retrieved from the server.
  */
-NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
-                                      MEMORY_INFORMATION_CLASS info_class, PVOID buffer,
-                                      SIZE_T len, SIZE_T *res_len )
+static BOOL get_basic_memory_info( char *base, MEMORY_BASIC_INFORMATION *info, BOOL shared )
 {
     struct file_view *view;
-    char *base, *alloc_base = 0, *alloc_end = working_set_limit;
-    struct wine_rb_entry *ptr;
-    MEMORY_BASIC_INFORMATION *info = buffer;
-    sigset_t sigset;
-
-    if (info_class != MemoryBasicInformation)
-    {
-        switch(info_class)
-        {
-            UNIMPLEMENTED_INFO_CLASS(MemoryWorkingSetList);
-            UNIMPLEMENTED_INFO_CLASS(MemorySectionName);
-            UNIMPLEMENTED_INFO_CLASS(MemoryBasicVlmInformation);
-
-            default:
-                FIXME("(%p,%p,info_class=%d,%p,%ld,%p) Unknown information class\n", 
-                      process, addr, info_class, buffer, len, res_len);
-                return STATUS_INVALID_INFO_CLASS;
-        }
-    }
-
-    if (process != NtCurrentProcess())
-    {
-        NTSTATUS status;
-        apc_call_t call;
-        apc_result_t result;
-
-        memset( &call, 0, sizeof(call) );
-
-        call.virtual_query.type = APC_VIRTUAL_QUERY;
-        call.virtual_query.addr = wine_server_client_ptr( addr );
-        status = server_queue_process_apc( process, &call, &result );
-        if (status != STATUS_SUCCESS) return status;
-
-        if (result.virtual_query.status == STATUS_SUCCESS)
-        {
-            info->BaseAddress       = wine_server_get_ptr( result.virtual_query.base );
-            info->AllocationBase    = wine_server_get_ptr( result.virtual_query.alloc_base );
-            info->RegionSize        = result.virtual_query.size;
-            info->Protect           = result.virtual_query.prot;
-            info->AllocationProtect = result.virtual_query.alloc_prot;
-            info->State             = (DWORD)result.virtual_query.state << 12;
-            info->Type              = (DWORD)result.virtual_query.alloc_type << 16;
-            if (info->RegionSize != result.virtual_query.size)  /* truncated */
-                return STATUS_INVALID_PARAMETER;  /* FIXME */
-            if (res_len) *res_len = sizeof(*info);
-        }
-        return result.virtual_query.status;
-    }
-
-    base = ROUND_ADDR( addr, page_mask );
-
-    if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
-
-    /* Find the view containing the address */
+    char *alloc_base = 0, *alloc_end = working_set_limit;
+    struct wine_rb_entry *ptr = views_tree.root;
 
-    server_enter_uninterrupted_section( &csVirtual, &sigset );
-    ptr = views_tree.root;
     while (ptr)
     {
         view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
@@ -2906,7 +3262,11 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
     {
         BYTE vprot;
         char *ptr;
-        SIZE_T range_size = get_committed_size( view, base, &vprot );
+        SIZE_T range_size;
+
+        if (shared && (view->protect & SEC_RESERVE)) return FALSE;
+
+        range_size = get_committed_size( view, base, &vprot );
 
         info->State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
         info->Protect = (vprot & VPROT_COMMITTED) ? VIRTUAL_GetWin32Prot( vprot, view->protect ) : 0;
@@ -2918,7 +3278,91 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
             if ((get_page_vprot( ptr ) ^ vprot) & ~VPROT_WRITEWATCH) break;
         info->RegionSize = ptr - base;
     }
-    server_leave_uninterrupted_section( &csVirtual, &sigset );
+    return TRUE;
+}
+
+#define UNIMPLEMENTED_INFO_CLASS(c) \
+    case c: \
+        FIXME("(process=%p,addr=%p) Unimplemented information class: " #c "\n", process, addr); \
+        return STATUS_INVALID_INFO_CLASS
+
+/***********************************************************************
+ *             NtQueryVirtualMemory   (NTDLL.@)
+ *             ZwQueryVirtualMemory   (NTDLL.@)
+ */
+NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
+                                      MEMORY_INFORMATION_CLASS info_class, PVOID buffer,
+                                      SIZE_T len, SIZE_T *res_len )
+{
+    char *base;
+    MEMORY_BASIC_INFORMATION *info = buffer, mbi;
+    sigset_t sigset;
+    BOOL done;
+
+    if (info_class != MemoryBasicInformation)
+    {
+        switch(info_class)
+        {
+            UNIMPLEMENTED_INFO_CLASS(MemoryWorkingSetList);
+            UNIMPLEMENTED_INFO_CLASS(MemorySectionName);
+            UNIMPLEMENTED_INFO_CLASS(MemoryBasicVlmInformation);
+
+            default:
+                FIXME("(%p,%p,info_class=%d,%p,%ld,%p) Unknown information class\n", 
+                      process, addr, info_class, buffer, len, res_len);
+                return STATUS_INVALID_INFO_CLASS;
+        }
+    }
+
+    if (process != NtCurrentProcess())
+    {
+        NTSTATUS status;
+        apc_call_t call;
+        apc_result_t result;
+
+        memset( &call, 0, sizeof(call) );
+
+        call.virtual_query.type = APC_VIRTUAL_QUERY;
+        call.virtual_query.addr = wine_server_client_ptr( addr );
+        status = server_queue_process_apc( process, &call, &result );
+        if (status != STATUS_SUCCESS) return status;
+
+        if (result.virtual_query.status == STATUS_SUCCESS)
+        {
+            info->BaseAddress       = wine_server_get_ptr( result.virtual_query.base );
+            info->AllocationBase    = wine_server_get_ptr( result.virtual_query.alloc_base );
+            info->RegionSize        = result.virtual_query.size;
+            info->Protect           = result.virtual_query.prot;
+            info->AllocationProtect = result.virtual_query.alloc_prot;
+            info->State             = (DWORD)result.virtual_query.state << 12;
+            info->Type              = (DWORD)result.virtual_query.alloc_type << 16;
+            if (info->RegionSize != result.virtual_query.size)  /* truncated */
+                return STATUS_INVALID_PARAMETER;  /* FIXME */
+            if (res_len) *res_len = sizeof(*info);
+        }
+        return result.virtual_query.status;
+    }
+
+    base = ROUND_ADDR( addr, page_mask );
+
+    if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
+
+    /* Find the view containing the address; queries only need the views lock */
+    /* unless the server has to be asked for the committed state of the pages */
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    RtlAcquireSRWLockShared( &views_lock );
+    done = get_basic_memory_info( base, &mbi, TRUE );
+    RtlReleaseSRWLockShared( &views_lock );
+    pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+
+    if (!done)
+    {
+        server_enter_uninterrupted_section( &csVirtual, &sigset );
+        get_basic_memory_info( base, &mbi, FALSE );
+        server_leave_uninterrupted_section( &csVirtual, &sigset );
+    }
+    *info = mbi;
 
     if (res_len) *res_len = sizeof(*info);
     return STATUS_SUCCESS;
@@ -3308,6 +3752,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
 NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T size, PVOID *addresses,
                                  ULONG_PTR *count, ULONG *granularity )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -3325,18 +3770,23 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if ((view = VIRTUAL_FindView( base, size )) && (view->protect & VPROT_WRITEWATCH))
     {
         ULONG_PTR pos = 0;
         char *addr = base;
         char *end = addr + size;
 
-        while (pos < *count && addr < end)
+        if (view->protect & VPROT_KERNEL_WATCH)
+            pos = get_kernel_write_watches( base, size, addresses, *count, flags & WRITE_WATCH_FLAG_RESET );
+        else
         {
-            if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
-            addr += page_size;
+            while (pos < *count && addr < end)
+            {
+                if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
+                addr += page_size;
+            }
+            if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( view, base, addr - (char *)base );
         }
-        if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( base, addr - (char *)base );
         *count = pos;
         *granularity = page_size;
     }
@@ -3353,6 +3803,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
  */
 NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -3365,8 +3816,8 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
 
-    if (is_write_watch_range( base, size ))
-        reset_write_watches( base, size );
+    if ((view = VIRTUAL_FindView( base, size )) && (view->protect & VPROT_WRITEWATCH))
+        reset_write_watches( view, base, size );
     else
         status = STATUS_INVALID_PARAMETER;
 
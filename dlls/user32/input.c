@@ -451,7 +451,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
-    DWORD ret;
+    DWORD ret, wake_bits, changed_bits;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
     {
@@ -461,6 +461,10 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* nothing to clear if none of the bits are set */
+    if (get_queue_shm_bits( &wake_bits, &changed_bits ) && !((wake_bits | changed_bits) & flags))
+        return 0;
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -477,10 +481,12 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
-    DWORD ret;
+    DWORD ret, changed_bits;
 
     check_for_events( QS_INPUT );
 
+    if (get_queue_shm_bits( &ret, &changed_bits )) return ret & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
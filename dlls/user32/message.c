@@ -2725,6 +2725,120 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/* maximum time in ms between two get_message requests, the server uses it to detect hung queues */
+#define QUEUE_SHM_MAX_AGE 500
+
+static const struct queue_shm *queue_shm_base;  /* queue status slots published by the server */
+static unsigned int queue_shm_count;
+
+/***********************************************************************
+ *           map_queue_shm
+ *
+ * Map the queue status published by the server for the current thread.
+ */
+static void map_queue_shm(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const struct queue_shm *base;
+    HANDLE file = 0, mapping;
+    data_size_t size = 0;
+    unsigned int index = 0;
+
+    if (thread_info->queue_shm) return;
+    thread_info->queue_shm = 0xffff;
+
+    SERVER_START_REQ( get_queue_shm )
+    {
+        if (!wine_server_call( req ))
+        {
+            file  = wine_server_ptr_handle( reply->handle );
+            size  = reply->size;
+            index = reply->index;
+        }
+    }
+    SERVER_END_REQ;
+    if (!file) return;
+
+    if (!(base = queue_shm_base) && (mapping = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL )))
+    {
+        queue_shm_count = size / sizeof(*base);
+        if ((base = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 )) &&
+            InterlockedCompareExchangePointer( (void **)&queue_shm_base, (void *)base, NULL ))
+        {
+            UnmapViewOfFile( base );  /* another thread mapped it first */
+            base = queue_shm_base;
+        }
+        CloseHandle( mapping );
+    }
+    CloseHandle( file );
+
+    if (base && index < queue_shm_count && index < 0xfffe) thread_info->queue_shm = index + 1;
+    TRACE( "queue status slot %u mapped at %p\n", index, base );
+}
+
+/***********************************************************************
+ *           read_queue_shm
+ *
+ * Get a consistent copy of the queue status published by the server.
+ */
+static BOOL read_queue_shm( struct queue_shm *status )
+{
+#if defined(__i386__) || defined(__x86_64__)
+    /* loads are not reordered on x86, volatile accesses are enough to read the slot */
+    unsigned int index = get_user_thread_info()->queue_shm;
+    const volatile struct queue_shm *shm;
+    int seq, retry;
+
+    if (!index || index == 0xffff) return FALSE;
+    shm = queue_shm_base + index - 1;
+    for (retry = 0; retry < 16; retry++)
+    {
+        if ((seq = shm->seq) & 1) continue;  /* the server is updating it */
+        status->wake_bits    = shm->wake_bits;
+        status->changed_bits = shm->changed_bits;
+        status->wake_mask    = shm->wake_mask;
+        status->changed_mask = shm->changed_mask;
+        if (shm->seq == seq) return TRUE;
+    }
+#endif
+    return FALSE;
+}
+
+/***********************************************************************
+ *           get_queue_shm_bits
+ *
+ * Get the queue bits without a server call, if the server publishes them.
+ */
+BOOL get_queue_shm_bits( DWORD *wake_bits, DWORD *changed_bits )
+{
+    struct queue_shm status;
+
+    if (!read_queue_shm( &status )) return FALSE;
+    *wake_bits = status.wake_bits;
+    *changed_bits = status.changed_bits;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           is_queue_empty
+ *
+ * Check whether a get_message request would find nothing and leave the queue
+ * unchanged, in which case it doesn't need to be sent.
+ */
+static BOOL is_queue_empty( HWND hwnd, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct queue_shm status;
+
+    if (hwnd == (HWND)-1) return FALSE;  /* the server sets the idle event for these */
+    if (GetTickCount() - thread_info->last_get_msg >= QUEUE_SHM_MAX_AGE) return FALSE;
+    if (!read_queue_shm( &status )) return FALSE;
+    if (status.wake_bits & QS_ALLINPUT) return FALSE;
+    if (status.changed_bits & (QS_ALLINPUT | QS_ALLPOSTMESSAGE)) return FALSE;
+    return (status.wake_mask == (changed_mask & (QS_SENDMESSAGE | QS_SMRESULT)) &&
+            status.changed_mask == changed_mask);
+}
+
 /***********************************************************************
  *           peek_message
  *
@@ -2740,11 +2854,18 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
     void *buffer;
     size_t buffer_size = 256;
 
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
-
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    if (is_queue_empty( hwnd, changed_mask ))
+    {
+        thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+        thread_info->changed_mask = changed_mask;
+        return FALSE;
+    }
+
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
+
     for (;;)
     {
         NTSTATUS res;
@@ -2779,6 +2900,8 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         }
         SERVER_END_REQ;
 
+        thread_info->last_get_msg = GetTickCount();
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -2786,6 +2909,7 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
             {
                 thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
                 thread_info->changed_mask = changed_mask;
+                map_queue_shm();
             }
             if (res != STATUS_BUFFER_OVERFLOW) return FALSE;
             if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
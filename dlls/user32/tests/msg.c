@@ -11726,6 +11726,93 @@ done:
     flush_events();
 }
 
+static DWORD CALLBACK post_thread_message_proc( void *param )
+{
+    DWORD tid = *(DWORD *)param;
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        PostThreadMessageA( tid, WM_USER + 1, i, 0 );
+        Sleep( 1 );
+    }
+    return 0;
+}
+
+static DWORD CALLBACK post_one_message_proc( void *param )
+{
+    PostThreadMessageA( *(DWORD *)param, WM_USER + 2, 0, 0 );
+    return 0;
+}
+
+static void test_PeekMessage_loop(void)
+{
+    unsigned int count = winetest_interactive ? 1000000 : 100, i, received = 0;
+    DWORD tid = GetCurrentThreadId(), start, status;
+    HANDLE thread;
+    BOOL ret;
+    MSG msg;
+
+    flush_events();
+
+    /* polling an empty queue */
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+        if (ret) break;
+    }
+    ok( !ret, "got message %04x\n", msg.message );
+    if (winetest_interactive) trace( "%u empty PeekMessage calls: %u ms\n", count, GetTickCount() - start );
+
+    status = GetQueueStatus( QS_ALLINPUT );
+    ok( !status, "GetQueueStatus returned %08x\n", status );
+    start = GetTickCount();
+    for (i = 0; i < count; i++) GetQueueStatus( QS_ALLINPUT );
+    if (winetest_interactive) trace( "%u GetQueueStatus calls: %u ms\n", count, GetTickCount() - start );
+
+    PostMessageA( 0, WM_USER, 0, 0 );
+    status = GetQueueStatus( QS_ALLINPUT );
+    ok( status == MAKELONG( QS_POSTMESSAGE, QS_POSTMESSAGE ), "GetQueueStatus returned %08x\n", status );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( ret && msg.message == WM_USER, "got %d message %04x\n", ret, msg.message );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+
+    /* the queue status has to be up to date right after another thread posted to it */
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+    status = GetQueueStatus( QS_ALLINPUT );
+    ok( !status, "GetQueueStatus returned %08x\n", status );
+    thread = CreateThread( NULL, 0, post_one_message_proc, &tid, 0, NULL );
+    ok( thread != NULL, "CreateThread failed, error %u\n", GetLastError() );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    status = GetQueueStatus( QS_POSTMESSAGE );
+    ok( status == MAKELONG( QS_POSTMESSAGE, QS_POSTMESSAGE ), "GetQueueStatus returned %08x\n", status );
+    ok( !GetInputState(), "GetInputState returned TRUE\n" );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( ret && msg.message == WM_USER + 2, "got %d message %04x\n", ret, msg.message );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+
+    /* messages posted by another thread have to be seen by the polling loop */
+    thread = CreateThread( NULL, 0, post_thread_message_proc, &tid, 0, NULL );
+    ok( thread != NULL, "CreateThread failed, error %u\n", GetLastError() );
+    start = GetTickCount();
+    while (received < 100 && GetTickCount() - start < 5000)
+    {
+        if (!PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE )) continue;
+        ok( msg.message == WM_USER + 1, "got message %04x\n", msg.message );
+        ok( msg.wParam == received, "got wparam %lu, expected %u\n", msg.wParam, received );
+        received++;
+    }
+    ok( received == 100, "received %u messages\n", received );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    flush_events();
+}
+
 static void test_PeekMessage3(void)
 {
     HWND hwnd;
@@ -16828,6 +16915,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage_loop();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -3346,6 +3346,66 @@ HWND *WIN_ListChildren( HWND hwnd )
 }
 
 
+/*******************************************************************
+ *           WIN_GetExStylesAndOwners
+ *
+ * Retrieve the extended style and the owner of every window of a list
+ * returned by WIN_ListChildren. Windows of other processes are queried
+ * with batched server calls.
+ */
+void WIN_GetExStylesAndOwners( const HWND *list, DWORD *ex_styles, HWND *owners )
+{
+    struct __server_request_info reqs[32];
+    void *ptrs[32];
+    unsigned int idx[16];
+    struct set_window_info_request *info_req;
+    struct get_window_tree_request *tree_req;
+    unsigned int i, j, n = 0;
+    WND *win;
+
+    for (i = 0; ; i++)
+    {
+        if (list[i])
+        {
+            ex_styles[i] = 0;
+            owners[i] = 0;
+            if (!(win = WIN_GetPtr( list[i] )) || win == WND_DESKTOP) continue;
+            if (win != WND_OTHER_PROCESS)
+            {
+                ex_styles[i] = win->dwExStyle;
+                owners[i] = win->owner;
+                WIN_ReleasePtr( win );
+                continue;
+            }
+
+            info_req = SERVER_INIT_BATCH_REQ( &reqs[2 * n], set_window_info );
+            info_req->handle = wine_server_user_handle( list[i] );
+            info_req->flags  = 0;  /* don't set anything, just retrieve */
+            info_req->extra_offset = -1;
+            tree_req = SERVER_INIT_BATCH_REQ( &reqs[2 * n + 1], get_window_tree );
+            tree_req->handle = wine_server_user_handle( list[i] );
+            ptrs[2 * n] = &reqs[2 * n];
+            ptrs[2 * n + 1] = &reqs[2 * n + 1];
+            idx[n++] = i;
+            if (n < sizeof(idx) / sizeof(idx[0])) continue;
+        }
+
+        if (n && !wine_server_call_batch( ptrs, 2 * n ))
+        {
+            for (j = 0; j < n; j++)
+            {
+                if (!reqs[2 * j].u.reply.reply_header.error)
+                    ex_styles[idx[j]] = reqs[2 * j].u.reply.set_window_info_reply.old_ex_style;
+                if (!reqs[2 * j + 1].u.reply.reply_header.error)
+                    owners[idx[j]] = wine_server_ptr_handle( reqs[2 * j + 1].u.reply.get_window_tree_reply.owner );
+            }
+        }
+        n = 0;
+        if (!list[i]) break;
+    }
+}
+
+
 /*******************************************************************
  *		EnumWindows (USER32.@)
  */
@@ -3704,6 +3764,58 @@ UINT WINAPI GetWindowModuleFileNameW( HWND hwnd, LPWSTR module, UINT size )
     return GetModuleFileNameW( hinst, module, size );
 }
 
+/******************************************************************************
+ *              get_other_process_window_info
+ *
+ * Retrieve the server side information of a window from another process in a single call.
+ */
+static BOOL get_other_process_window_info( HWND hwnd, WINDOWINFO *info )
+{
+    struct __server_request_info reqs[3];
+    void *ptrs[3] = { &reqs[0], &reqs[1], &reqs[2] };
+    struct get_window_rectangles_request *rect_req;
+    struct set_window_info_request *win_req;
+    struct set_class_info_request *class_req;
+    const struct get_window_rectangles_reply *rect_reply = &reqs[0].u.reply.get_window_rectangles_reply;
+    const struct set_window_info_reply *win_reply = &reqs[1].u.reply.set_window_info_reply;
+    const struct set_class_info_reply *class_reply = &reqs[2].u.reply.set_class_info_reply;
+    unsigned int status;
+    int i;
+
+    rect_req = SERVER_INIT_BATCH_REQ( &reqs[0], get_window_rectangles );
+    rect_req->handle = wine_server_user_handle( hwnd );
+    rect_req->relative = COORDS_SCREEN;
+
+    win_req = SERVER_INIT_BATCH_REQ( &reqs[1], set_window_info );
+    win_req->handle = wine_server_user_handle( hwnd );
+    win_req->flags  = 0;  /* don't set anything, just retrieve */
+    win_req->extra_offset = -1;
+
+    class_req = SERVER_INIT_BATCH_REQ( &reqs[2], set_class_info );
+    class_req->window = wine_server_user_handle( hwnd );
+    class_req->flags  = 0;
+    class_req->extra_offset = -1;
+
+    if (!(status = wine_server_call_batch( ptrs, 3 )))
+    {
+        for (i = 0; i < 3 && !status; i++) status = reqs[i].u.reply.reply_header.error;
+    }
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError( status ));
+        return FALSE;
+    }
+
+    SetRect( &info->rcWindow, rect_reply->window.left, rect_reply->window.top,
+             rect_reply->window.right, rect_reply->window.bottom );
+    SetRect( &info->rcClient, rect_reply->client.left, rect_reply->client.top,
+             rect_reply->client.right, rect_reply->client.bottom );
+    info->dwStyle = win_reply->old_style;
+    info->dwExStyle = win_reply->old_ex_style;
+    info->atomWindowType = class_reply->old_atom;
+    return TRUE;
+}
+
 /******************************************************************************
  *              GetWindowInfo (USER32.@)
  *
@@ -3711,17 +3823,27 @@ UINT WINAPI GetWindowModuleFileNameW( HWND hwnd, LPWSTR module, UINT size )
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetWindowInfo( HWND hwnd, PWINDOWINFO pwi)
 {
+    WND *win;
+
     if (!pwi) return FALSE;
-    if (!WIN_GetRectangles( hwnd, COORDS_SCREEN, &pwi->rcWindow, &pwi->rcClient )) return FALSE;
 
-    pwi->dwStyle = GetWindowLongW(hwnd, GWL_STYLE);
-    pwi->dwExStyle = GetWindowLongW(hwnd, GWL_EXSTYLE);
+    if ((win = WIN_GetPtr( hwnd )) == WND_OTHER_PROCESS)
+    {
+        if (!get_other_process_window_info( hwnd, pwi )) return FALSE;
+    }
+    else
+    {
+        if (win && win != WND_DESKTOP) WIN_ReleasePtr( win );
+        if (!WIN_GetRectangles( hwnd, COORDS_SCREEN, &pwi->rcWindow, &pwi->rcClient )) return FALSE;
+
+        pwi->dwStyle = GetWindowLongW(hwnd, GWL_STYLE);
+        pwi->dwExStyle = GetWindowLongW(hwnd, GWL_EXSTYLE);
+        pwi->atomWindowType = GetClassLongW( hwnd, GCW_ATOM );
+    }
     pwi->dwWindowStatus = ((GetActiveWindow() == hwnd) ? WS_ACTIVECAPTION : 0);
 
     pwi->cxWindowBorders = pwi->rcClient.left - pwi->rcWindow.left;
     pwi->cyWindowBorders = pwi->rcWindow.bottom - pwi->rcClient.bottom;
-
-    pwi->atomWindowType = GetClassLongW( hwnd, GCW_ATOM );
     pwi->wCreatorVersion = 0x0400;
 
     return TRUE;
@@ -1769,6 +1769,29 @@ static inline void get_valid_rects( const RECT *old_client, const RECT *new_clie
 }
 
 
+/***********************************************************************
+ *           list_top_level_windows
+ *
+ * Helper for SWP_DoOwnedPopups; list the top-level windows along with
+ * their extended styles and owners.
+ */
+static HWND *list_top_level_windows( DWORD **ex_styles, HWND **owners )
+{
+    HWND *list;
+    unsigned int count;
+
+    if (!(list = WIN_ListChildren( GetDesktopWindow() ))) return NULL;
+    for (count = 0; list[count]; count++) ;
+    if (!(*owners = HeapAlloc( GetProcessHeap(), 0, count * (sizeof(HWND) + sizeof(DWORD)) + 1 )))
+    {
+        HeapFree( GetProcessHeap(), 0, list );
+        return NULL;
+    }
+    *ex_styles = (DWORD *)(*owners + count);
+    WIN_GetExStylesAndOwners( list, *ex_styles, *owners );
+    return list;
+}
+
 /***********************************************************************
  *           SWP_DoOwnedPopups
  *
@@ -1779,7 +1802,8 @@ static inline void get_valid_rects( const RECT *old_client, const RECT *new_clie
  */
 static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
 {
-    HWND owner, *list = NULL;
+    HWND owner, *list = NULL, *owners = NULL;
+    DWORD *ex_styles = NULL;
     unsigned int i;
 
     TRACE("(%p) hInsertAfter = %p\n", hwnd, hwndInsertAfter );
@@ -1792,11 +1816,11 @@ static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
 
         if (hwndInsertAfter != HWND_TOPMOST)
         {
-            if (!(list = WIN_ListChildren( GetDesktopWindow() ))) return hwndInsertAfter;
+            if (!(list = list_top_level_windows( &ex_styles, &owners ))) return hwndInsertAfter;
 
             for (i = 0; list[i]; i++)
             {
-                BOOL topmost = (GetWindowLongW( list[i], GWL_EXSTYLE ) & WS_EX_TOPMOST) != 0;
+                BOOL topmost = (ex_styles[i] & WS_EX_TOPMOST) != 0;
 
                 if (list[i] == owner)
                 {
@@ -1815,7 +1839,7 @@ static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
     }
 
     if (hwndInsertAfter == HWND_BOTTOM) goto done;
-    if (!list && !(list = WIN_ListChildren( GetDesktopWindow() ))) goto done;
+    if (!list && !(list = list_top_level_windows( &ex_styles, &owners ))) goto done;
 
     i = 0;
     if (hwndInsertAfter == HWND_TOP || hwndInsertAfter == HWND_NOTOPMOST)
@@ -1823,7 +1847,7 @@ static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
         if (hwndInsertAfter == HWND_NOTOPMOST || !(GetWindowLongW( hwnd, GWL_EXSTYLE ) & WS_EX_TOPMOST))
         {
             /* skip all the topmost windows */
-            while (list[i] && (GetWindowLongW( list[i], GWL_EXSTYLE ) & WS_EX_TOPMOST)) i++;
+            while (list[i] && (ex_styles[i] & WS_EX_TOPMOST)) i++;
         }
     }
     else if (hwndInsertAfter != HWND_TOPMOST)
@@ -1839,7 +1863,7 @@ static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
     for ( ; list[i]; i++)
     {
         if (list[i] == hwnd) break;
-        if (GetWindow( list[i], GW_OWNER ) != hwnd) continue;
+        if (owners[i] != hwnd) continue;
         TRACE( "moving %p owned by %p after %p\n", list[i], hwnd, hwndInsertAfter );
         SetWindowPos( list[i], hwndInsertAfter, 0, 0, 0, 0,
                       SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE | SWP_NOSENDCHANGING | SWP_DEFERERASE );
@@ -1847,6 +1871,7 @@ static HWND SWP_DoOwnedPopups(HWND hwnd, HWND hwndInsertAfter)
     }
 
 done:
+    HeapFree( GetProcessHeap(), 0, owners );
     HeapFree( GetProcessHeap(), 0, list );
     return hwndInsertAfter;
 }
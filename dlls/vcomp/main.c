@@ -44,6 +44,8 @@ static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
 static BOOL    vcomp_nested_fork = FALSE;
+static int     vcomp_spin_count = 20000;
+static int     vcomp_proc_bind;
 
 static RTL_CRITICAL_SECTION vcomp_section;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
@@ -59,6 +61,19 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* spin count used for OMP_WAIT_POLICY=active */
+#define VCOMP_SPIN_COUNT_ACTIVE         0x7fffffff
+
+/* thread binding policies (OMP_PROC_BIND) */
+#define VCOMP_PROC_BIND_FALSE           0
+#define VCOMP_PROC_BIND_CLOSE           1
+#define VCOMP_PROC_BIND_SPREAD          2
+
+/* section / dynamic loop state: generation in the high part, next index in the low part */
+#define VCOMP_STATE(gen, index)         (((__int64)(gen) << 32) | (unsigned int)(index))
+#define VCOMP_STATE_GEN(state)          ((unsigned int)((unsigned __int64)(state) >> 32))
+#define VCOMP_STATE_INDEX(state)        ((unsigned int)(state))
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -70,6 +85,8 @@ struct vcomp_thread_data
     /* only used for concurrent tasks */
     struct list             entry;
     CONDITION_VARIABLE      cond;
+    BOOL                    waiting;
+    int                     affinity_cpu;
 
     /* single */
     unsigned int            single;
@@ -87,8 +104,9 @@ struct vcomp_thread_data
 struct vcomp_team_data
 {
     CONDITION_VARIABLE      cond;
+    LONG                    waiters;
     int                     num_threads;
-    int                     finished_threads;
+    volatile LONG           finished_threads;
 
     /* callback arguments */
     int                     nargs;
@@ -96,8 +114,8 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    volatile LONG           barrier;
+    LONG                    barrier_count;
 };
 
 struct vcomp_task_data
@@ -106,12 +124,11 @@ struct vcomp_task_data
     unsigned int            single;
 
     /* section */
-    unsigned int            section;
+    __int64                 section_state;
     int                     num_sections;
-    int                     section_index;
 
     /* dynamic */
-    unsigned int            dynamic;
+    __int64                 dynamic_state;
     unsigned int            dynamic_first;
     unsigned int            dynamic_last;
     unsigned int            dynamic_iterations;
@@ -406,8 +423,8 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     }
 
     data->task.single           = 0;
-    data->task.section          = 0;
-    data->task.dynamic          = 0;
+    data->task.section_state    = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -433,6 +450,100 @@ static void vcomp_free_thread_data(void)
     vcomp_set_thread_data(NULL);
 }
 
+static inline void vcomp_pause(void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#elif defined(__GNUC__)
+    __asm__ __volatile__( "" : : : "memory" );
+#endif
+}
+
+static inline __int64 vcomp_read_state(__int64 *state)
+{
+#ifdef _WIN64
+    return *(volatile __int64 *)state;
+#else
+    return interlocked_cmpxchg64(state, 0, 0);
+#endif
+}
+
+static void vcomp_set_state(__int64 *state, __int64 value)
+{
+    __int64 old = vcomp_read_state(state), prev;
+    while ((prev = interlocked_cmpxchg64(state, value, old)) != old) old = prev;
+}
+
+/* wait until *ptr changes, spinning for a while before blocking on the team condition variable */
+static void vcomp_wait_team(struct vcomp_team_data *team, volatile LONG *ptr, LONG value)
+{
+    int spin;
+
+    for (spin = 0; spin < vcomp_spin_count; spin++)
+    {
+        if (*ptr != value) return;
+        vcomp_pause();
+    }
+
+    EnterCriticalSection(&vcomp_section);
+    InterlockedIncrement(&team->waiters);
+    while (*ptr == value)
+        SleepConditionVariableCS(&team->cond, &vcomp_section, INFINITE);
+    InterlockedDecrement(&team->waiters);
+    LeaveCriticalSection(&vcomp_section);
+}
+
+/* increment *ptr and wake up the threads blocked in vcomp_wait_team */
+static void vcomp_wake_team(struct vcomp_team_data *team, volatile LONG *ptr)
+{
+    InterlockedIncrement(ptr);
+    if (team->waiters)
+    {
+        EnterCriticalSection(&vcomp_section);
+        WakeAllConditionVariable(&team->cond);
+        LeaveCriticalSection(&vcomp_section);
+    }
+}
+
+/* return the processor a worker thread should be bound to, or -1 */
+static int vcomp_get_affinity_cpu(int thread_num, int num_threads)
+{
+    int num_cpus = min(vcomp_max_threads, sizeof(DWORD_PTR) * 8);
+
+    switch (vcomp_proc_bind)
+    {
+        case VCOMP_PROC_BIND_CLOSE:
+            return thread_num % num_cpus;
+        case VCOMP_PROC_BIND_SPREAD:
+            return (thread_num * num_cpus / max(num_threads, 1)) % num_cpus;
+        default:
+            return -1;
+    }
+}
+
+static void vcomp_init_env(void)
+{
+    char buffer[16];
+
+    if (GetEnvironmentVariableA("OMP_WAIT_POLICY", buffer, sizeof(buffer)) < sizeof(buffer))
+    {
+        if (!lstrcmpiA(buffer, "active"))
+            vcomp_spin_count = VCOMP_SPIN_COUNT_ACTIVE;
+        else if (!lstrcmpiA(buffer, "passive"))
+            vcomp_spin_count = 0;
+    }
+
+    if (GetEnvironmentVariableA("OMP_PROC_BIND", buffer, sizeof(buffer)) < sizeof(buffer))
+    {
+        if (!lstrcmpiA(buffer, "true") || !lstrcmpiA(buffer, "close"))
+            vcomp_proc_bind = VCOMP_PROC_BIND_CLOSE;
+        else if (!lstrcmpiA(buffer, "spread"))
+            vcomp_proc_bind = VCOMP_PROC_BIND_SPREAD;
+        else if (lstrcmpiA(buffer, "false") && buffer[0])
+            FIXME("unsupported OMP_PROC_BIND value %s\n", debugstr_a(buffer));
+    }
+}
+
 void CDECL _vcomp_atomic_add_i1(char *dest, char val)
 {
     interlocked_xchg_add8(dest, val);
@@ -1054,26 +1165,23 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    /* sense-reversing barrier: the last thread to arrive resets the count
+     * and flips the sense by bumping the generation, the others wait for it */
+    barrier = team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        vcomp_wake_team(team_data, &team_data->barrier);
     }
     else
-    {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
-    }
-    LeaveCriticalSection(&vcomp_section);
+        vcomp_wait_team(team_data, &team_data->barrier, barrier);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1130,11 +1238,12 @@ void CDECL _vcomp_sections_init(int n)
 
     EnterCriticalSection(&vcomp_section);
     thread_data->section++;
-    if ((int)(thread_data->section - task_data->section) > 0)
+    if ((int)(thread_data->section - VCOMP_STATE_GEN(vcomp_read_state(&task_data->section_state))) > 0)
     {
-        task_data->section       = thread_data->section;
-        task_data->num_sections  = n;
-        task_data->section_index = 0;
+        /* switch the generation first, so that threads still in the previous
+         * sections can no longer pick an index */
+        vcomp_set_state(&task_data->section_state, VCOMP_STATE(thread_data->section, 0));
+        task_data->num_sections = n;
     }
     LeaveCriticalSection(&vcomp_section);
 }
@@ -1143,18 +1252,23 @@ int CDECL _vcomp_sections_next(void)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int i = -1;
+    __int64 state, prev;
+    unsigned int i;
 
     TRACE("()\n");
 
-    EnterCriticalSection(&vcomp_section);
-    if (thread_data->section == task_data->section &&
-        task_data->section_index != task_data->num_sections)
+    state = vcomp_read_state(&task_data->section_state);
+    for (;;)
     {
-        i = task_data->section_index++;
+        if (VCOMP_STATE_GEN(state) != thread_data->section)
+            return -1;
+        i = VCOMP_STATE_INDEX(state);
+        if ((int)i >= task_data->num_sections)
+            return -1;
+        if ((prev = interlocked_cmpxchg64(&task_data->section_state, state + 1, state)) == state)
+            return i;
+        state = prev;
     }
-    LeaveCriticalSection(&vcomp_section);
-    return i;
 }
 
 void CDECL _vcomp_for_static_simple_init(unsigned int first, unsigned int last, int step,
@@ -1342,9 +1456,9 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
         EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+        if ((int)(thread_data->dynamic - VCOMP_STATE_GEN(vcomp_read_state(&task_data->dynamic_state))) > 0)
         {
-            task_data->dynamic              = thread_data->dynamic;
+            vcomp_set_state(&task_data->dynamic_state, VCOMP_STATE(thread_data->dynamic, 0));
             task_data->dynamic_first        = first;
             task_data->dynamic_last         = last;
             task_data->dynamic_iterations   = iterations;
@@ -1374,26 +1488,48 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        unsigned int first, last, total, chunksize, done, remaining, iterations;
+        __int64 state, prev;
+        int step;
+
+        state = vcomp_read_state(&task_data->dynamic_state);
+        for (;;)
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            if (VCOMP_STATE_GEN(state) != thread_data->dynamic)
+                return 0;
+
+            /* the loop parameters can only change together with the generation,
+             * so they are valid if the compare-and-swap below succeeds */
+            first     = task_data->dynamic_first;
+            last      = task_data->dynamic_last;
+            total     = task_data->dynamic_iterations;
+            step      = task_data->dynamic_step;
+            chunksize = task_data->dynamic_chunksize;
+
+            done = VCOMP_STATE_INDEX(state);
+            if (done >= total)
+                return 0;
+
+            remaining  = total - done;
+            iterations = min(remaining, chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+            if (!iterations)
+                return 0;
+
+            if ((prev = interlocked_cmpxchg64(&task_data->dynamic_state, state + iterations, state)) == state)
+                break;
+            state = prev;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+
+        *begin = first + done * step;
+        *end   = *begin + (iterations - 1) * step;
+        if (iterations == remaining)
+            *end = last;
+        return 1;
     }
 
     return 0;
@@ -1416,24 +1552,50 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
     for (;;)
     {
         struct vcomp_team_data *team = thread_data->team;
+        BOOL ret;
+        int spin;
+
         if (team != NULL)
         {
+            int cpu = vcomp_get_affinity_cpu(thread_data->thread_num, team->num_threads);
+
             LeaveCriticalSection(&vcomp_section);
+            if (cpu != thread_data->affinity_cpu &&
+                SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+                thread_data->affinity_cpu = cpu;
             _vcomp_fork_call_wrapper(team->wrapper, team->nargs, team->valist);
             EnterCriticalSection(&vcomp_section);
 
             thread_data->team = NULL;
             list_remove(&thread_data->entry);
             list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
+
+            /* the team data lives on the master stack, incrementing
+             * the finished count has to be the last access to it */
+            if (team->waiters)
                 WakeAllConditionVariable(&team->cond);
+            InterlockedIncrement(&team->finished_threads);
         }
 
-        if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
-            GetLastError() == ERROR_TIMEOUT && !thread_data->team)
+        /* parallel regions often follow each other closely, so spin
+         * for a while before blocking on the condition variable */
+        if (vcomp_spin_count)
         {
-            break;
+            LeaveCriticalSection(&vcomp_section);
+            for (spin = 0; spin < vcomp_spin_count; spin++)
+            {
+                if (*(struct vcomp_team_data * volatile *)&thread_data->team) break;
+                vcomp_pause();
+            }
+            EnterCriticalSection(&vcomp_section);
+            if (thread_data->team) continue;
         }
+
+        thread_data->waiting = TRUE;
+        ret = SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000);
+        thread_data->waiting = FALSE;
+        if (!ret && GetLastError() == ERROR_TIMEOUT && !thread_data->team)
+            break;
     }
     list_remove(&thread_data->entry);
     LeaveCriticalSection(&vcomp_section);
@@ -1467,6 +1629,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
         num_threads = vcomp_num_threads;
 
     InitializeConditionVariable(&team_data.cond);
+    team_data.waiters           = 0;
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
     team_data.nargs             = nargs;
@@ -1476,8 +1639,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     team_data.barrier_count     = 0;
 
     task_data.single            = 0;
-    task_data.section           = 0;
-    task_data.dynamic           = 0;
+    task_data.section_state     = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1511,7 +1674,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->dynamic_type  = 0;
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
-            WakeAllConditionVariable(&data->cond);
+            if (data->waiting)
+                WakeAllConditionVariable(&data->cond);
         }
 
         /* spawn additional threads */
@@ -1534,6 +1698,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->dynamic       = 1;
             data->dynamic_type  = 0;
             InitializeConditionVariable(&data->cond);
+            data->waiting       = FALSE;
+            data->affinity_cpu  = -1;
 
             thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL);
             if (!thread)
@@ -1559,13 +1725,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
-        EnterCriticalSection(&vcomp_section);
+        LONG finished = InterlockedIncrement(&team_data.finished_threads);
 
-        team_data.finished_threads++;
-        while (team_data.finished_threads < team_data.num_threads)
-            SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
-
-        LeaveCriticalSection(&vcomp_section);
+        while (finished < team_data.num_threads)
+        {
+            vcomp_wait_team(&team_data, &team_data.finished_threads, finished);
+            finished = team_data.finished_threads;
+        }
         assert(list_empty(&thread_data.entry));
     }
 
@@ -1693,6 +1859,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_module      = instance;
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
+            vcomp_init_env();
             break;
         }
 
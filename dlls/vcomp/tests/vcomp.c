@@ -2222,6 +2222,85 @@ static void test_reduction_float_double(void)
     }
 }
 
+static void CDECL overhead_fork_cb(LONG *count)
+{
+    InterlockedIncrement(count);
+}
+
+static void CDECL overhead_barrier_cb(int repeat)
+{
+    int i;
+
+    for (i = 0; i < repeat; i++)
+        p_vcomp_barrier();
+}
+
+static void CDECL overhead_for_dynamic_cb(int repeat, LONG *count)
+{
+    unsigned int begin, end;
+    int i;
+
+    for (i = 0; i < repeat; i++)
+    {
+        p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_CHUNKED | VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, 1023, 1, 16);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+            InterlockedExchangeAdd(count, end - begin + 1);
+        p_vcomp_barrier();
+    }
+}
+
+static void CDECL overhead_reduction_cb(int *sum)
+{
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_ADD, sum, 1);
+}
+
+static double overhead_us(const LARGE_INTEGER *start, const LARGE_INTEGER *end,
+                          const LARGE_INTEGER *freq, int repeat)
+{
+    return (end->QuadPart - start->QuadPart) * 1000000.0 / freq->QuadPart / repeat;
+}
+
+/* EPCC-style synchronization overhead measurements */
+static void test_vcomp_overhead(void)
+{
+    static const int repeat = 1000;
+    int max_threads = pomp_get_max_threads();
+    LARGE_INTEGER freq, start, end;
+    LONG count;
+    int i, sum;
+
+    QueryPerformanceFrequency(&freq);
+
+    count = 0;
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < repeat; i++)
+        p_vcomp_fork(TRUE, 1, overhead_fork_cb, &count);
+    QueryPerformanceCounter(&end);
+    ok(count == repeat * max_threads, "expected count == %d, got %d\n", repeat * max_threads, count);
+    if (winetest_debug > 1)
+        trace("parallel overhead: %.2f us (%d threads)\n", overhead_us(&start, &end, &freq, repeat), max_threads);
+
+    QueryPerformanceCounter(&start);
+    p_vcomp_fork(TRUE, 1, overhead_barrier_cb, repeat);
+    QueryPerformanceCounter(&end);
+    if (winetest_debug > 1) trace("barrier overhead: %.2f us\n", overhead_us(&start, &end, &freq, repeat));
+
+    count = 0;
+    QueryPerformanceCounter(&start);
+    p_vcomp_fork(TRUE, 2, overhead_for_dynamic_cb, repeat, &count);
+    QueryPerformanceCounter(&end);
+    ok(count == repeat * 1024, "expected count == %d, got %d\n", repeat * 1024, count);
+    if (winetest_debug > 1) trace("dynamic for overhead: %.2f us\n", overhead_us(&start, &end, &freq, repeat));
+
+    sum = 0;
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < repeat; i++)
+        p_vcomp_fork(TRUE, 1, overhead_reduction_cb, &sum);
+    QueryPerformanceCounter(&end);
+    ok(sum == repeat * max_threads, "expected sum == %d, got %d\n", repeat * max_threads, sum);
+    if (winetest_debug > 1) trace("reduction overhead: %.2f us\n", overhead_us(&start, &end, &freq, repeat));
+}
+
 START_TEST(vcomp)
 {
     if (!init_vcomp())
@@ -2251,6 +2330,7 @@ START_TEST(vcomp)
     test_reduction_integer32();
     test_reduction_integer64();
     test_reduction_float_double();
+    test_vcomp_overhead();
 
     release_vcomp();
 }
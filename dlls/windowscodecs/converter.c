@@ -93,6 +93,79 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+/* The conversions to 8-bit sRGB use lookup tables instead of powf. The
+ * linear [0,1] range is split into buckets spanning at most one output
+ * step, each bucket gives the output at its start, and the threshold of
+ * the next output value tells whether it is reached inside the bucket. */
+#define SRGB_LUT_SIZE 4096
+
+static BYTE srgb_lut[SRGB_LUT_SIZE];
+static float srgb_threshold[256];      /* smallest linear value giving each output */
+static UINT unpremultiply_recip[256];  /* 255 / alpha in 16.16 fixed point, rounded up */
+static INIT_ONCE init_tables_once = INIT_ONCE_STATIC_INIT;
+
+static inline BYTE to_sRGB_byte_slow(float f)
+{
+    return floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static BOOL WINAPI init_tables(INIT_ONCE *once, void *param, void **context)
+{
+    union { float f; UINT i; } lo, hi, mid, one;
+    UINT i;
+
+    one.f = 1.0f;
+    srgb_threshold[0] = 0.0f;
+    for (i = 1; i < 256; i++)
+    {
+        /* positive floats are ordered like their bit patterns */
+        lo.f = srgb_threshold[i - 1];
+        hi.i = one.i;
+        while (lo.i < hi.i)
+        {
+            mid.i = lo.i + (hi.i - lo.i) / 2;
+            if (to_sRGB_byte_slow(mid.f) >= i) hi.i = mid.i;
+            else lo.i = mid.i + 1;
+        }
+        srgb_threshold[i] = lo.f;
+    }
+
+    for (i = 0; i < SRGB_LUT_SIZE; i++)
+        srgb_lut[i] = to_sRGB_byte_slow((float)i / SRGB_LUT_SIZE);
+
+    unpremultiply_recip[0] = 0;
+    for (i = 1; i < 256; i++)
+        unpremultiply_recip[i] = ((255 << 16) + i - 1) / i;
+
+    return TRUE;
+}
+
+/* same as to_sRGB_byte_slow(), out of range values are clamped */
+static inline BYTE to_sRGB_byte(float f)
+{
+    BYTE ret;
+
+    if (!(f > 0.0f)) return 0;
+    if (f >= 1.0f) return 255;
+
+    ret = srgb_lut[(UINT)(f * SRGB_LUT_SIZE)];
+    if (ret < 255 && f >= srgb_threshold[ret + 1]) ret++;
+    return ret;
+}
+
+/* c * 255 / alpha, exact for all 8-bit values */
+static inline UINT unpremultiply(UINT c, BYTE alpha)
+{
+    return (c * unpremultiply_recip[alpha]) >> 16;
+}
+
+/* c * alpha / 255, exact for all 8-bit values */
+static inline BYTE premultiply(UINT c, UINT alpha)
+{
+    UINT x = c * alpha;
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
 #if 0 /* FIXME: enable once needed */
 static void from_sRGB(BYTE *bgr)
 {
@@ -335,40 +408,24 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         {
             HRESULT res;
             INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
+            BYTE *row;
             DWORD *dstpixel;
 
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+            /* read the source rows at the start of the destination rows and
+             * expand them in place, from the end */
+            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
 
             if (SUCCEEDED(res))
             {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
+                row = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
+                    dstpixel=(DWORD*)row;
+                    for (x=prc->Width-1; x>=0; x--)
+                        dstpixel[x] = 0xff000000|(row[x]<<16)|(row[x]<<8)|row[x];
+                    row += cbStride;
                 }
             }
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
             return res;
         }
         return S_OK;
@@ -612,93 +669,39 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         }
         return S_OK;
     case format_24bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_24bppRGB:
         if (prc)
         {
             HRESULT res;
             INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+            BYTE *row;
+            DWORD *dstpixel;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+            /* read the source rows at the start of the destination rows and
+             * expand them in place, from the end */
+            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
 
             if (SUCCEEDED(res))
             {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
+                row = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
+                    const BYTE *srcpixel;
+
+                    dstpixel=(DWORD*)row;
+                    if (source_format == format_24bppBGR)
+                        for (x=prc->Width-1; x>=0; x--) {
+                            srcpixel = row + 3 * x;
+                            dstpixel[x] = 0xff000000|(srcpixel[2]<<16)|(srcpixel[1]<<8)|srcpixel[0];
+                        }
+                    else
+                        for (x=prc->Width-1; x>=0; x--) {
+                            srcpixel = row + 3 * x;
+                            dstpixel[x] = 0xff000000|(srcpixel[0]<<16)|(srcpixel[1]<<8)|srcpixel[2];
+                        }
+                    row += cbStride;
                 }
             }
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
             return res;
         }
         return S_OK;
@@ -731,16 +734,20 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             if (FAILED(res)) return res;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
+            {
+                BYTE *pixel = pbBuffer + cbStride * y;
+
+                for (x=0; x<prc->Width; x++, pixel += 4)
                 {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
+                    BYTE alpha = pixel[3];
                     if (alpha != 0 && alpha != 255)
                     {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
+                        pixel[0] = unpremultiply(pixel[0], alpha);
+                        pixel[1] = unpremultiply(pixel[1], alpha);
+                        pixel[2] = unpremultiply(pixel[2], alpha);
                     }
                 }
+            }
         }
         return S_OK;
     case format_48bppRGB:
@@ -892,16 +899,20 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
             INT x, y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
+            {
+                BYTE *pixel = pbBuffer + cbStride * y;
+
+                for (x=0; x<prc->Width; x++, pixel += 4)
                 {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
+                    BYTE alpha = pixel[3];
                     if (alpha != 255)
                     {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
+                        pixel[0] = premultiply(pixel[0], alpha);
+                        pixel[1] = premultiply(pixel[1], alpha);
+                        pixel[2] = premultiply(pixel[2], alpha);
                     }
                 }
+            }
         }
         return hr;
     }
@@ -924,51 +935,6 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
             return hr;
         }
         return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
 
     case format_32bppGrayFloat:
         if (prc)
@@ -996,7 +962,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1013,8 +979,49 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         return S_OK;
 
     default:
-        FIXME("Unimplemented conversion path!\n");
-        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+        /* other formats are converted through 32bpp */
+        if (prc)
+        {
+            HRESULT res;
+            INT x, y;
+            BYTE *srcdata;
+            UINT srcstride, srcdatasize;
+            const BYTE *srcrow;
+            const BYTE *srcpixel;
+            BYTE *dstrow;
+            BYTE *dstpixel;
+
+            srcstride = 4 * prc->Width;
+            srcdatasize = srcstride * prc->Height;
+
+            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
+            if (!srcdata) return E_OUTOFMEMORY;
+
+            res = copypixels_to_32bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
+
+            if (SUCCEEDED(res))
+            {
+                srcrow = srcdata;
+                dstrow = pbBuffer;
+                for (y=0; y<prc->Height; y++) {
+                    srcpixel=srcrow;
+                    dstpixel=dstrow;
+                    for (x=0; x<prc->Width; x++) {
+                        *dstpixel++=*srcpixel++; /* blue */
+                        *dstpixel++=*srcpixel++; /* green */
+                        *dstpixel++=*srcpixel++; /* red */
+                        srcpixel++; /* alpha */
+                    }
+                    srcrow += srcstride;
+                    dstrow += cbStride;
+                }
+            }
+
+            HeapFree(GetProcessHeap(), 0, srcdata);
+
+            return res;
+        }
+        return S_OK;
     }
 }
 
@@ -1035,9 +1042,8 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
             return hr;
         }
         return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
+    default:
+        /* other formats are converted through 32bpp */
         if (prc)
         {
             HRESULT res;
@@ -1056,7 +1062,7 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
             srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
             if (!srcdata) return E_OUTOFMEMORY;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+            res = copypixels_to_32bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
 
             if (SUCCEEDED(res))
             {
@@ -1085,9 +1091,6 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
             return res;
         }
         return S_OK;
-    default:
-        FIXME("Unimplemented conversion path!\n");
-        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
     }
 }
 
@@ -1139,7 +1142,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
 {
     HRESULT hr;
     BYTE *srcdata;
-    UINT srcstride, srcdatasize;
+    UINT srcstride, srcdatasize, bpp;
 
     if (source_format == format_8bppGray)
     {
@@ -1173,7 +1176,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1186,14 +1189,21 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         return hr;
     }
 
-    srcstride = 3 * prc->Width;
+    if (!prc) return S_OK;
+
+    /* 24bpp sources are read as 24bppBGR, everything else as 32bpp */
+    bpp = (source_format == format_24bppBGR || source_format == format_24bppRGB) ? 3 : 4;
+    srcstride = bpp * prc->Width;
     srcdatasize = srcstride * prc->Height;
 
     srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
     if (!srcdata) return E_OUTOFMEMORY;
 
-    hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
-    if (SUCCEEDED(hr) && prc)
+    if (bpp == 3)
+        hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
+    else
+        hr = copypixels_to_32bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
+    if (SUCCEEDED(hr))
     {
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
@@ -1206,9 +1216,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
-                bgr += 3;
+                dst[x] = to_sRGB_byte(gray);
+                bgr += bpp;
             }
             src += srcstride;
             dst += cbStride;
@@ -1509,6 +1518,8 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
     This = HeapAlloc(GetProcessHeap(), 0, sizeof(FormatConverter));
     if (!This) return E_OUTOFMEMORY;
 
+    InitOnceExecuteOnce(&init_tables_once, init_tables, NULL, NULL);
+
     This->IWICFormatConverter_iface.lpVtbl = &FormatConverter_Vtbl;
     This->ref = 1;
     This->source = NULL;
@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -32,6 +33,19 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* filter weights are fixed point numbers with FILTER_BITS fractional bits,
+ * horizontally filtered rows keep ROW_BITS more bits than the source */
+#define FILTER_BITS 14
+#define ROW_BITS    7
+
+/* resampling filter along one axis */
+struct scaler_filter
+{
+    UINT taps;          /* number of source pixels contributing to a destination pixel */
+    INT *start;         /* first contributing source pixel, for each destination pixel */
+    SHORT *weights;     /* taps weights for each destination pixel */
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -42,6 +56,12 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct scaler_filter filter_x, filter_y; /* taps is 0 when not filtering */
+    BYTE *src_row;      /* source scanline being filtered */
+    INT *rows;          /* horizontally filtered source rows, one per vertical tap */
+    INT *row_y;         /* source row held by each entry of rows, -1 if none */
+    INT *sum;           /* vertical filter accumulator */
+    UINT rows_x, rows_width; /* destination columns held in rows */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -84,6 +104,29 @@ static ULONG WINAPI BitmapScaler_AddRef(IWICBitmapScaler *iface)
     return ref;
 }
 
+static void free_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    filter->start = NULL;
+    filter->weights = NULL;
+    filter->taps = 0;
+}
+
+static void free_filter_state(BitmapScaler *This)
+{
+    free_filter(&This->filter_x);
+    free_filter(&This->filter_y);
+    HeapFree(GetProcessHeap(), 0, This->src_row);
+    HeapFree(GetProcessHeap(), 0, This->rows);
+    HeapFree(GetProcessHeap(), 0, This->row_y);
+    HeapFree(GetProcessHeap(), 0, This->sum);
+    This->src_row = NULL;
+    This->rows = NULL;
+    This->row_y = NULL;
+    This->sum = NULL;
+}
+
 static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
 {
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
@@ -96,6 +139,7 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter_state(This);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -190,6 +234,253 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static double filter_kernel(WICBitmapInterpolationMode mode, double x)
+{
+    x = fabs(x);
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case WICBitmapInterpolationModeCubic:
+        /* Catmull-Rom spline */
+        if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+        if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        return 0.0;
+    default:
+        return 0.0;
+    }
+}
+
+/* Precompute the fixed point weights used to resample src_size pixels into
+ * dst_size pixels. When shrinking, the kernels are stretched over the source
+ * pixels covered by a destination pixel. Fant averages these pixels weighted
+ * by their coverage. Pixels past the edges are replaced by the edge pixels, so
+ * that all the taps of a destination pixel are inside the source. */
+static HRESULT init_filter(struct scaler_filter *filter, WICBitmapInterpolationMode mode,
+    UINT src_size, UINT dst_size)
+{
+    double scale = (double)src_size / dst_size;
+    double support = max(scale, 1.0);
+    double radius, *tmp, *acc;
+    UINT i, j, count, taps;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear: radius = 1.0; break;
+    case WICBitmapInterpolationModeCubic:  radius = 2.0; break;
+    default:                               radius = 0.5; break;
+    }
+
+    count = ceil(2.0 * radius * support) + 1;
+    taps = min(count, src_size);
+
+    filter->taps = taps;
+    filter->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->start));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * taps * sizeof(*filter->weights));
+    tmp = HeapAlloc(GetProcessHeap(), 0, (count + taps) * sizeof(*tmp));
+    if (!filter->start || !filter->weights || !tmp)
+    {
+        HeapFree(GetProcessHeap(), 0, tmp);
+        free_filter(filter);
+        return E_OUTOFMEMORY;
+    }
+    acc = tmp + count;
+
+    for (i = 0; i < dst_size; i++)
+    {
+        double center = (i + 0.5) * scale, total = 0.0, cumul = 0.0;
+        SHORT *weights = filter->weights + i * taps;
+        INT first, start, prev = 0, next;
+
+        if (mode == WICBitmapInterpolationModeFant)
+        {
+            double left = center - support / 2, right = center + support / 2;
+
+            first = floor(left);
+            for (j = 0; j < count; j++)
+            {
+                double pos = first + (INT)j;
+                double overlap = min(pos + 1.0, right) - max(pos, left);
+                tmp[j] = max(overlap, 0.0);
+                total += tmp[j];
+            }
+        }
+        else
+        {
+            first = floor(center - 0.5 - radius * support);
+            for (j = 0; j < count; j++)
+            {
+                tmp[j] = filter_kernel(mode, (first + (INT)j + 0.5 - center) / support);
+                total += tmp[j];
+            }
+        }
+        if (total <= 0.0) total = 1.0;
+
+        start = max(0, min(first, (INT)(src_size - taps)));
+        filter->start[i] = start;
+
+        for (j = 0; j < taps; j++) acc[j] = 0.0;
+        for (j = 0; j < count; j++)
+        {
+            INT src = max(0, min(first + (INT)j, (INT)src_size - 1));
+            acc[src - start] += tmp[j] / total;
+        }
+
+        /* round the cumulated weights, so that the rounding errors don't add
+         * up and the weights sum to exactly one */
+        for (j = 0; j < taps; j++)
+        {
+            cumul += acc[j];
+            next = (j == taps - 1) ? (1 << FILTER_BITS) : floor(cumul * (1 << FILTER_BITS) + 0.5);
+            weights[j] = next - prev;
+            prev = next;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, tmp);
+    return S_OK;
+}
+
+static HRESULT init_filter_state(BitmapScaler *This, WICBitmapInterpolationMode mode)
+{
+    UINT channels = This->bpp / 8;
+    HRESULT hr;
+
+    hr = init_filter(&This->filter_x, mode, This->src_width, This->width);
+    if (SUCCEEDED(hr))
+        hr = init_filter(&This->filter_y, mode, This->src_height, This->height);
+    if (FAILED(hr))
+    {
+        free_filter_state(This);
+        return hr;
+    }
+
+    This->src_row = HeapAlloc(GetProcessHeap(), 0, This->src_width * channels);
+    This->rows = HeapAlloc(GetProcessHeap(), 0,
+        This->filter_y.taps * This->width * channels * sizeof(*This->rows));
+    This->row_y = HeapAlloc(GetProcessHeap(), 0, This->filter_y.taps * sizeof(*This->row_y));
+    This->sum = HeapAlloc(GetProcessHeap(), 0, This->width * channels * sizeof(*This->sum));
+    if (!This->src_row || !This->rows || !This->row_y || !This->sum)
+    {
+        free_filter_state(This);
+        return E_OUTOFMEMORY;
+    }
+
+    This->rows_x = This->rows_width = 0;
+    return S_OK;
+}
+
+static inline void filter_row_channels(const struct scaler_filter *filter, UINT x, UINT width,
+    const UINT channels, const BYTE *src, INT src_x, INT *dst)
+{
+    UINT i, j, c, taps = filter->taps;
+
+    for (i = x; i < x + width; i++, dst += channels)
+    {
+        const BYTE *pixel = src + (filter->start[i] - src_x) * channels;
+        const SHORT *weights = filter->weights + i * taps;
+        INT sum[4] = {0, 0, 0, 0};
+
+        for (j = 0; j < taps; j++, pixel += channels)
+            for (c = 0; c < channels; c++)
+                sum[c] += weights[j] * pixel[c];
+
+        for (c = 0; c < channels; c++)
+            dst[c] = (sum[c] + (1 << (FILTER_BITS - ROW_BITS - 1))) >> (FILTER_BITS - ROW_BITS);
+    }
+}
+
+/* horizontally filter a source row, the channel count is a constant in each
+ * call so that the compiler can unroll and vectorize the inner loops */
+static void filter_row(const struct scaler_filter *filter, UINT x, UINT width,
+    UINT channels, const BYTE *src, INT src_x, INT *dst)
+{
+    switch (channels)
+    {
+    case 1: filter_row_channels(filter, x, width, 1, src, src_x, dst); break;
+    case 3: filter_row_channels(filter, x, width, 3, src, src_x, dst); break;
+    case 4: filter_row_channels(filter, x, width, 4, src, src_x, dst); break;
+    }
+}
+
+/* return a horizontally filtered source row, reading it from the source only
+ * if it is not one of the rows kept from the previous destination rows */
+static HRESULT get_filtered_row(BitmapScaler *This, INT y, const INT **row)
+{
+    UINT channels = This->bpp / 8;
+    UINT slot = y % This->filter_y.taps;
+    INT *dst = This->rows + slot * This->rows_width * channels;
+
+    if (This->row_y[slot] != y)
+    {
+        WICRect rc;
+        UINT stride;
+        HRESULT hr;
+
+        rc.X = This->filter_x.start[This->rows_x];
+        rc.Y = y;
+        rc.Width = This->filter_x.start[This->rows_x + This->rows_width - 1] + This->filter_x.taps - rc.X;
+        rc.Height = 1;
+        stride = rc.Width * channels;
+
+        This->row_y[slot] = -1;
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, stride, stride, This->src_row);
+        if (FAILED(hr)) return hr;
+
+        filter_row(&This->filter_x, This->rows_x, This->rows_width, channels, This->src_row, rc.X, dst);
+        This->row_y[slot] = y;
+    }
+
+    *row = dst;
+    return S_OK;
+}
+
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dest_rect, UINT cbStride,
+    BYTE *pbBuffer)
+{
+    UINT n = dest_rect->Width * (This->bpp / 8);
+    UINT taps = This->filter_y.taps;
+    UINT i, j, y;
+    HRESULT hr;
+
+    if (!dest_rect->Width || !dest_rect->Height)
+        return S_OK;
+
+    if (This->rows_x != dest_rect->X || This->rows_width != dest_rect->Width)
+    {
+        for (j = 0; j < taps; j++) This->row_y[j] = -1;
+        This->rows_x = dest_rect->X;
+        This->rows_width = dest_rect->Width;
+    }
+
+    for (y = dest_rect->Y; y < dest_rect->Y + dest_rect->Height; y++, pbBuffer += cbStride)
+    {
+        const SHORT *weights = This->filter_y.weights + y * taps;
+        INT src_y = This->filter_y.start[y];
+        INT *sum = This->sum;
+
+        memset(sum, 0, n * sizeof(*sum));
+        for (j = 0; j < taps; j++)
+        {
+            INT weight = weights[j];
+            const INT *row;
+
+            if (!weight) continue;
+            if (FAILED(hr = get_filtered_row(This, src_y + j, &row))) return hr;
+            for (i = 0; i < n; i++) sum[i] += weight * row[i];
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            INT val = (sum[i] + (1 << (FILTER_BITS + ROW_BITS - 1))) >> (FILTER_BITS + ROW_BITS);
+            pbBuffer[i] = max(0, min(val, 255));
+        }
+    }
+
+    return S_OK;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -244,6 +535,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->filter_x.taps)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -299,6 +596,28 @@ end:
     return hr;
 }
 
+/* formats with 8 bits per channel, which are filtered channel by channel */
+static BOOL is_filter_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID *formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGB,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < sizeof(formats)/sizeof(formats[0]); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     IWICBitmapSource *pISource, UINT uiWidth, UINT uiHeight,
     WICBitmapInterpolationMode mode)
@@ -333,26 +652,49 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
 
     if (SUCCEEDED(hr))
     {
+        BOOL filter = FALSE;
+
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            /* indexed and packed formats are filtered in 32bppBGRA */
+            if (is_filter_format(&src_pixelformat) || (This->bpp % 8) != 0 ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat8bppIndexed))
+                filter = TRUE;
+            else
+                FIXME("mode %i not supported for format %s\n", mode, debugstr_guid(&src_pixelformat));
+            break;
+        case WICBitmapInterpolationModeNearestNeighbor:
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
-            /* fall-through */
-        case WICBitmapInterpolationModeNearestNeighbor:
-            if ((This->bpp % 8) == 0)
-            {
-                IWICBitmapSource_AddRef(pISource);
-                This->source = pISource;
-            }
-            else
+            break;
+        }
+
+        if ((This->bpp % 8) == 0 && (!filter || is_filter_format(&src_pixelformat)))
+        {
+            IWICBitmapSource_AddRef(pISource);
+            This->source = pISource;
+        }
+        else
+        {
+            hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                pISource, &This->source);
+            This->bpp = 32;
+        }
+        This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
+        This->fn_copy_scanline = NearestNeighbor_CopyScanline;
+
+        if (SUCCEEDED(hr) && filter)
+        {
+            hr = init_filter_state(This, mode);
+            if (FAILED(hr))
             {
-                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
-                    pISource, &This->source);
-                This->bpp = 32;
+                IWICBitmapSource_Release(This->source);
+                This->source = NULL;
             }
-            This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
-            This->fn_copy_scanline = NearestNeighbor_CopyScanline;
-            break;
         }
     }
 
@@ -390,6 +732,13 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->src_row = NULL;
+    This->rows = NULL;
+    This->row_y = NULL;
+    This->sum = NULL;
+    This->rows_x = This->rows_width = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
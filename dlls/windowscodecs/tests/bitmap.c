@@ -1030,6 +1030,196 @@ static void test_WICCreateBitmapFromSectionEx(void)
     CloseHandle(hsection);
 }
 
+static IWICBitmapScaler *create_scaler(UINT width, UINT height, const WICPixelFormatGUID *format,
+    UINT stride, BYTE *data, UINT dst_width, UINT dst_height, WICBitmapInterpolationMode mode)
+{
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, format, stride,
+                                                   stride * height, data, &bitmap);
+    ok(hr == S_OK, "CreateBitmapFromMemory error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "CreateBitmapScaler error %#x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, dst_width, dst_height, mode);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+
+    IWICBitmap_Release(bitmap);
+    return scaler;
+}
+
+static void test_bitmap_scaler(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const UINT sizes[][2] = { {3, 9}, {13, 2}, {7, 5}, {1, 1} };
+    BYTE checker[4] = { 0, 255, 255, 0 };
+    BYTE src[7 * 5 * 4], whole[13 * 9 * 4], rows[13 * 9 * 4];
+    IWICBitmapScaler *scaler;
+    WICPixelFormatGUID format;
+    UINT i, j, m, y, width, height;
+    HRESULT hr;
+
+    for (m = 0; m < sizeof(modes)/sizeof(modes[0]); m++)
+    {
+        /* a solid color stays the same */
+        for (i = 0; i < 7 * 5; i++)
+        {
+            src[i * 3] = 10;
+            src[i * 3 + 1] = 20;
+            src[i * 3 + 2] = 30;
+        }
+        for (j = 0; j < sizeof(sizes)/sizeof(sizes[0]); j++)
+        {
+            scaler = create_scaler(7, 5, &GUID_WICPixelFormat24bppBGR, 21, src,
+                                   sizes[j][0], sizes[j][1], modes[m]);
+
+            hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+            ok(hr == S_OK, "GetSize error %#x\n", hr);
+            ok(width == sizes[j][0] && height == sizes[j][1], "got %ux%u\n", width, height);
+
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+            ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+            ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR), "got format %s\n", wine_dbgstr_guid(&format));
+
+            memset(whole, 0xcc, sizeof(whole));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, width * 3, sizeof(whole), whole);
+            ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+            for (i = 0; i < width * height; i++)
+            {
+                if (whole[i * 3] != 10 || whole[i * 3 + 1] != 20 || whole[i * 3 + 2] != 30)
+                {
+                    ok(0, "mode %u, %ux%u: pixel %u is %u,%u,%u\n", modes[m], width, height, i,
+                       whole[i * 3], whole[i * 3 + 1], whole[i * 3 + 2]);
+                    break;
+                }
+            }
+            IWICBitmapScaler_Release(scaler);
+        }
+
+        /* no scaling gives back the source */
+        for (i = 0; i < sizeof(src); i++)
+            src[i] = i * 37;
+        scaler = create_scaler(7, 5, &GUID_WICPixelFormat32bppBGRA, 28, src, 7, 5, modes[m]);
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 28, sizeof(whole), whole);
+        ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+        ok(!memcmp(whole, src, 7 * 5 * 4), "mode %u: the pixels changed\n", modes[m]);
+        IWICBitmapScaler_Release(scaler);
+
+        /* copying one row at a time gives the same result */
+        for (j = 0; j < sizeof(sizes)/sizeof(sizes[0]); j++)
+        {
+            WICRect rc;
+
+            scaler = create_scaler(7, 5, &GUID_WICPixelFormat32bppBGRA, 28, src,
+                                   sizes[j][0], sizes[j][1], modes[m]);
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, sizes[j][0] * 4, sizeof(whole), whole);
+            ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+
+            rc.X = 0;
+            rc.Width = sizes[j][0];
+            rc.Height = 1;
+            for (y = 0; y < sizes[j][1]; y++)
+            {
+                rc.Y = y;
+                hr = IWICBitmapScaler_CopyPixels(scaler, &rc, sizes[j][0] * 4, sizes[j][0] * 4,
+                                                 rows + y * sizes[j][0] * 4);
+                ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+            }
+            ok(!memcmp(whole, rows, sizes[j][0] * sizes[j][1] * 4), "mode %u, %ux%u: rows differ\n",
+               modes[m], sizes[j][0], sizes[j][1]);
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    /* Fant averages the covered pixels */
+    scaler = create_scaler(2, 2, &GUID_WICPixelFormat8bppGray, 2, checker, 1, 1,
+                           WICBitmapInterpolationModeFant);
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 1, 1, whole);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(whole[0] == 127 || whole[0] == 128, "got %u\n", whole[0]);
+    IWICBitmapScaler_Release(scaler);
+}
+
+static void test_bitmap_scaler_performance(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *format;
+        UINT bpp;
+    }
+    formats[] =
+    {
+        { &GUID_WICPixelFormat8bppGray, 8 },
+        { &GUID_WICPixelFormat24bppBGR, 24 },
+        { &GUID_WICPixelFormat32bppBGRA, 32 },
+    };
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const UINT sizes[] = { 512, 171, 96 };
+    const UINT src_size = 256;
+    UINT f, m, s, i, y, stride, dst_stride;
+    IWICBitmapScaler *scaler;
+    BYTE *src, *dst;
+    WICRect rc;
+    DWORD ticks;
+    HRESULT hr;
+
+    if (!winetest_interactive)
+    {
+        skip("Run in interactive mode to run the scaler performance tests.\n");
+        return;
+    }
+
+    src = HeapAlloc(GetProcessHeap(), 0, src_size * src_size * 4);
+    dst = HeapAlloc(GetProcessHeap(), 0, sizes[0] * 4);
+    for (i = 0; i < src_size * src_size * 4; i++)
+        src[i] = i * 7 + i / 1024;
+
+    for (f = 0; f < sizeof(formats)/sizeof(formats[0]); f++)
+    for (m = 0; m < sizeof(modes)/sizeof(modes[0]); m++)
+    for (s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++)
+    {
+        stride = src_size * formats[f].bpp / 8;
+        dst_stride = sizes[s] * formats[f].bpp / 8;
+        scaler = create_scaler(src_size, src_size, formats[f].format, stride, src,
+                               sizes[s], sizes[s], modes[m]);
+
+        /* copy one row at a time, as recommended by MSDN */
+        ticks = GetTickCount();
+        rc.X = 0;
+        rc.Width = sizes[s];
+        rc.Height = 1;
+        for (y = 0; y < sizes[s]; y++)
+        {
+            rc.Y = y;
+            hr = IWICBitmapScaler_CopyPixels(scaler, &rc, dst_stride, dst_stride, dst);
+            if (hr != S_OK) break;
+        }
+        ticks = GetTickCount() - ticks;
+        ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+        trace("%u bpp, mode %u, %u -> %u: %u ms\n", formats[f].bpp, modes[m], src_size, sizes[s], ticks);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    HeapFree(GetProcessHeap(), 0, src);
+    HeapFree(GetProcessHeap(), 0, dst);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -1046,6 +1236,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHICON();
     test_CreateBitmapFromHBITMAP();
     test_clipper();
+    test_bitmap_scaler();
+    test_bitmap_scaler_performance();
 
     IWICImagingFactory_Release(factory);
 
@@ -1221,6 +1221,133 @@ static const struct setting png_interlace_settings[] = {
     {NULL}
 };
 
+static IWICBitmapSource *create_converted_bitmap(UINT width, UINT height, const WICPixelFormatGUID *src_format,
+    UINT stride, BYTE *data, const WICPixelFormatGUID *dst_format)
+{
+    IWICBitmapSource *converted = NULL;
+    IWICBitmap *bitmap;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, src_format, stride,
+                                                   stride * height, data, &bitmap);
+    ok(hr == S_OK, "CreateBitmapFromMemory error %#x\n", hr);
+    if (hr != S_OK) return NULL;
+
+    hr = WICConvertBitmapSource(dst_format, (IWICBitmapSource *)bitmap, &converted);
+    ok(hr == S_OK, "WICConvertBitmapSource error %#x\n", hr);
+
+    IWICBitmap_Release(bitmap);
+    return converted;
+}
+
+static void test_gray_float_conversion(void)
+{
+    static const UINT count = 4096;
+    IWICBitmapSource *converted;
+    float *src;
+    BYTE *dst;
+    HRESULT hr;
+    UINT i;
+
+    src = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*src));
+    dst = HeapAlloc(GetProcessHeap(), 0, count);
+
+    for (i = 0; i < count; i++)
+        src[i] = (float)i / (count - 1);
+
+    converted = create_converted_bitmap(count, 1, &GUID_WICPixelFormat32bppGrayFloat, count * sizeof(*src),
+                                        (BYTE *)src, &GUID_WICPixelFormat8bppGray);
+    if (converted)
+    {
+        hr = IWICBitmapSource_CopyPixels(converted, NULL, count, count, dst);
+        ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+
+        for (i = 0; i < count; i++)
+        {
+            float f = src[i] <= 0.0031308f ? 12.92f * src[i] : 1.055f * powf(src[i], 1.0f / 2.4f) - 0.055f;
+            int expect = floorf(f * 255.0f + 0.51f);
+
+            /* Native rounds some values differently. */
+            if (dst[i] != expect && !broken(dst[i] == expect - 1 || dst[i] == expect + 1))
+            {
+                ok(0, "%f: expected %d, got %u\n", src[i], expect, dst[i]);
+                break;
+            }
+        }
+        IWICBitmapSource_Release(converted);
+    }
+
+    HeapFree(GetProcessHeap(), 0, src);
+    HeapFree(GetProcessHeap(), 0, dst);
+}
+
+static void test_conversion_performance(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *src, *dst;
+        UINT src_bpp, dst_bpp;
+        const char *name;
+    }
+    pairs[] =
+    {
+        { &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppBGR -> 32bppBGRA" },
+        { &GUID_WICPixelFormat24bppRGB, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppRGB -> 32bppBGRA" },
+        { &GUID_WICPixelFormat8bppGray, &GUID_WICPixelFormat32bppBGRA, 8, 32, "8bppGray -> 32bppBGRA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, 32, 32, "32bppBGRA -> 32bppPBGRA" },
+        { &GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, 32, 32, "32bppPBGRA -> 32bppBGRA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppBGR, 32, 24, "32bppBGRA -> 24bppBGR" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat8bppGray, 32, 8, "32bppBGRA -> 8bppGray" },
+        { &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat8bppGray, 24, 8, "24bppBGR -> 8bppGray" },
+        { &GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat8bppGray, 32, 8, "32bppGrayFloat -> 8bppGray" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppGrayFloat, 32, 32, "32bppBGRA -> 32bppGrayFloat" },
+    };
+    static const UINT width = 512, height = 512;
+    IWICBitmapSource *converted;
+    BYTE *src, *dst;
+    DWORD ticks;
+    HRESULT hr;
+    UINT i;
+
+    if (!winetest_interactive)
+    {
+        skip("Run in interactive mode to run the conversion performance tests.\n");
+        return;
+    }
+
+    src = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+
+    for (i = 0; i < sizeof(pairs)/sizeof(pairs[0]); i++)
+    {
+        UINT j, stride = width * pairs[i].dst_bpp / 8;
+
+        if (pairs[i].src == &GUID_WICPixelFormat32bppGrayFloat)
+            for (j = 0; j < width * height; j++) ((float *)src)[j] = (j % 1001) / 1000.0f;
+        else
+            for (j = 0; j < width * height * 4; j++) src[j] = j * 13 + j / 4096;
+
+        converted = create_converted_bitmap(width, height, pairs[i].src, width * pairs[i].src_bpp / 8,
+                                            src, pairs[i].dst);
+        if (!converted) continue;
+
+        ticks = GetTickCount();
+        for (j = 0; j < 4; j++)
+        {
+            hr = IWICBitmapSource_CopyPixels(converted, NULL, stride, stride * height, dst);
+            if (hr != S_OK) break;
+        }
+        ticks = GetTickCount() - ticks;
+        ok(hr == S_OK, "%s: CopyPixels error %#x\n", pairs[i].name, hr);
+        trace("%s: %u ms for 4 %ux%u conversions\n", pairs[i].name, ticks, width, height);
+
+        IWICBitmapSource_Release(converted);
+    }
+
+    HeapFree(GetProcessHeap(), 0, src);
+    HeapFree(GetProcessHeap(), 0, dst);
+}
+
 START_TEST(converter)
 {
     HRESULT hr;
@@ -1255,6 +1382,8 @@ START_TEST(converter)
 
     test_invalid_conversion();
     test_default_converter();
+    test_gray_float_conversion();
+    test_conversion_performance();
 
     test_encoder(&testdata_BlackWhite, &CLSID_WICPngEncoder,
                  &testdata_BlackWhite, &CLSID_WICPngDecoder, "PNG encoder BlackWhite");
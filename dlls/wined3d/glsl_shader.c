@@ -590,6 +590,213 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+struct shader_glsl_cache_shader
+{
+    struct wined3d_shader_cache_key key;
+    GLint type;
+    GLint source_size;
+    char *source;
+};
+
+struct shader_glsl_cache_material
+{
+    BYTE *data;
+    SIZE_T size;
+    SIZE_T capacity;
+};
+
+static int shader_glsl_compare_cache_shaders(const void *a, const void *b)
+{
+    const struct shader_glsl_cache_shader *s1 = a, *s2 = b;
+
+    return memcmp(&s1->key, &s2->key, sizeof(s1->key));
+}
+
+/* Each chunk is prefixed with its size, so that consecutive chunks can't
+ * alias. */
+static BOOL shader_glsl_append_cache_material(struct shader_glsl_cache_material *material,
+        const void *data, SIZE_T size)
+{
+    DWORD chunk_size = size;
+
+    if (!wined3d_array_reserve((void **)&material->data, &material->capacity,
+            material->size + sizeof(chunk_size) + size, 1))
+        return FALSE;
+    memcpy(material->data + material->size, &chunk_size, sizeof(chunk_size));
+    material->size += sizeof(chunk_size);
+    if (size)
+        memcpy(material->data + material->size, data, size);
+    material->size += size;
+    return TRUE;
+}
+
+/* The key covers the sources of the attached shaders, any extra state that
+ * affects linking, and the driver identity, since program binaries are only
+ * valid for the driver that produced them. The data that went into the key
+ * is returned in "material"; it is stored along with the program binary and
+ * compared on load, so that a hash collision can't feed the wrong binary to
+ * the driver.
+ *
+ * Context activation is done by the caller. */
+static BOOL shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info, GLuint program,
+        const void *data, SIZE_T data_size, struct wined3d_shader_cache_key *key,
+        struct shader_glsl_cache_material *material)
+{
+    static const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    struct wined3d_shader_cache_key *shader_keys = NULL;
+    struct shader_glsl_cache_shader *shaders;
+    GLint i, shader_count;
+    GLuint *shader_ids;
+    const char *str;
+    BOOL ret = FALSE;
+    unsigned int j;
+
+    memset(material, 0, sizeof(*material));
+
+    wined3d_shader_cache_key_init(key);
+    for (j = 0; j < sizeof(driver_strings) / sizeof(*driver_strings); ++j)
+    {
+        if (!(str = (const char *)gl_info->gl_ops.gl.p_glGetString(driver_strings[j])))
+            return FALSE;
+        wined3d_shader_cache_key_update(key, str, strlen(str));
+        if (!shader_glsl_append_cache_material(material, str, strlen(str)))
+            goto fail;
+    }
+    wined3d_shader_cache_key_update(key, data, data_size);
+    if (!shader_glsl_append_cache_material(material, data, data_size))
+        goto fail;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count));
+    if (!(shader_ids = heap_calloc(shader_count, sizeof(*shader_ids))))
+        goto fail;
+    if (!(shaders = heap_calloc(shader_count, sizeof(*shaders))))
+    {
+        heap_free(shader_ids);
+        goto fail;
+    }
+
+    GL_EXTCALL(glGetAttachedShaders(program, shader_count, NULL, shader_ids));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shader_ids[i], GL_SHADER_SOURCE_LENGTH, &shaders[i].source_size));
+        if (shaders[i].source_size > 0)
+        {
+            if (!(shaders[i].source = heap_alloc(shaders[i].source_size)))
+            {
+                ERR("Failed to allocate %d bytes for shader source.\n", shaders[i].source_size);
+                goto done;
+            }
+            GL_EXTCALL(glGetShaderSource(shader_ids[i], shaders[i].source_size,
+                    &shaders[i].source_size, shaders[i].source));
+        }
+        else
+        {
+            shaders[i].source_size = 0;
+        }
+        GL_EXTCALL(glGetShaderiv(shader_ids[i], GL_SHADER_TYPE, &shaders[i].type));
+
+        wined3d_shader_cache_key_init(&shaders[i].key);
+        wined3d_shader_cache_key_update(&shaders[i].key, &shaders[i].type, sizeof(shaders[i].type));
+        wined3d_shader_cache_key_update(&shaders[i].key, shaders[i].source, shaders[i].source_size);
+    }
+    checkGLcall("get program sources");
+
+    /* The order of attached shaders is implementation defined. */
+    qsort(shaders, shader_count, sizeof(*shaders), shader_glsl_compare_cache_shaders);
+    if (!(shader_keys = heap_calloc(shader_count, sizeof(*shader_keys))))
+        goto done;
+    for (i = 0; i < shader_count; ++i)
+    {
+        shader_keys[i] = shaders[i].key;
+        if (!shader_glsl_append_cache_material(material, &shaders[i].type, sizeof(shaders[i].type))
+                || !shader_glsl_append_cache_material(material, shaders[i].source, shaders[i].source_size))
+            goto done;
+    }
+    wined3d_shader_cache_key_update(key, shader_keys, shader_count * sizeof(*shader_keys));
+    ret = TRUE;
+
+done:
+    for (i = 0; i < shader_count; ++i)
+        heap_free(shaders[i].source);
+    heap_free(shader_keys);
+    heap_free(shaders);
+    heap_free(shader_ids);
+    if (ret)
+        return TRUE;
+
+fail:
+    heap_free(material->data);
+    material->data = NULL;
+    return FALSE;
+}
+
+/* Link "program", or load it from the program binary cache when possible.
+ * "data" is included in the cache key along with the shader sources.
+ *
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, GLuint program,
+        const void *data, SIZE_T data_size, BOOL cacheable)
+{
+    struct shader_glsl_cache_material material;
+    struct wined3d_shader_cache_key key;
+    LARGE_INTEGER start, end;
+    DWORD format, blob_size;
+    GLint status, size = 0;
+    GLenum gl_format;
+    BOOL hit = FALSE;
+    void *blob;
+
+    cacheable = cacheable && wined3d_settings.shader_cache_size && gl_info->supported[ARB_GET_PROGRAM_BINARY]
+            && shader_glsl_get_program_cache_key(gl_info, program, data, data_size, &key, &material);
+
+    QueryPerformanceCounter(&start);
+    if (cacheable && wined3d_shader_cache_get(&key, material.data, material.size, &format, &blob, &blob_size))
+    {
+        TRACE("Loading GLSL shader program %u from the program binary cache.\n", program);
+        GL_EXTCALL(glProgramBinary(program, format, blob, blob_size));
+        heap_free(blob);
+        GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        checkGLcall("glProgramBinary");
+        if (!(hit = status))
+        {
+            /* E.g. after a driver update that kept the same version string.
+             * The shaders are still attached, so we can just link normally. */
+            WARN("Driver rejected the cached binary for program %u.\n", program);
+            wined3d_shader_cache_remove(&key);
+        }
+    }
+
+    if (!hit)
+    {
+        if (cacheable)
+            GL_EXTCALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        TRACE("Linking GLSL shader program %u.\n", program);
+        GL_EXTCALL(glLinkProgram(program));
+        shader_glsl_validate_link(gl_info, program);
+    }
+    QueryPerformanceCounter(&end);
+
+    if (!cacheable)
+        return;
+    wined3d_shader_cache_record_link(hit, end.QuadPart - start.QuadPart);
+
+    if (!hit)
+    {
+        GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status)
+            GL_EXTCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size));
+        if (status && size > 0 && (blob = heap_alloc(size)))
+        {
+            GL_EXTCALL(glGetProgramBinary(program, size, &size, &gl_format, blob));
+            checkGLcall("glGetProgramBinary");
+            if (size > 0)
+                wined3d_shader_cache_put(&key, material.data, material.size, gl_format, blob, size);
+            heap_free(blob);
+        }
+    }
+    heap_free(material.data);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -9965,9 +10172,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, program_id, NULL, 0, TRUE);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10050,6 +10255,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     struct list *ps_list, *vs_list;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
+    DWORD link_data[2];
 
     if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
     {
@@ -10212,6 +10418,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     {
         attribs_map = (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
     }
+    link_data[0] = attribs_map;
 
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
@@ -10289,10 +10496,11 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    /* Link the program. Transform feedback varyings aren't part of the
+     * sources, so don't bother caching programs that use them. */
+    link_data[1] = shader_glsl_use_explicit_attrib_location(gl_info);
+    shader_glsl_link_program(gl_info, program_id, link_data, sizeof(link_data),
+            !gshader || !gshader->u.gs.so_desc.element_count);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -0,0 +1,554 @@
+/*
+ * Persistent cache for linked GLSL program binaries
+ *
+ * Linking GLSL programs is expensive, and applications tend to create the
+ * same programs every time they run. When the driver supports
+ * ARB_get_program_binary, the linked binaries are stored in the prefix,
+ * keyed by a hash of the program sources and the GL driver identity, and
+ * loaded back with glProgramBinary() the next time the same program is
+ * requested. The hashed data itself is stored along with each binary and
+ * compared on load, so hash collisions only cost a cache miss. The total
+ * size of the cache is bounded; the least recently used entries are evicted
+ * first.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdlib.h>
+
+#include "wined3d_private.h"
+#include "wine/library.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
+
+#define WINED3D_SHADER_CACHE_MAGIC      0x43533357 /* "W3SC" */
+#define WINED3D_SHADER_CACHE_VERSION    2
+#define WINED3D_SHADER_CACHE_NAME_SIZE  32 /* hex digits in a file name */
+
+struct wined3d_shader_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    struct wined3d_shader_cache_key key;
+    struct wined3d_shader_cache_key checksum;   /* Of the program binary. */
+    DWORD format;
+    DWORD material_size;                        /* Followed by the key material... */
+    DWORD size;                                 /* ...and the program binary. */
+};
+
+struct wined3d_shader_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct list lru_entry;
+    struct wined3d_shader_cache_key key;
+    DWORD size;
+};
+
+struct wined3d_shader_cache_file
+{
+    struct wined3d_shader_cache_key key;
+    ULONGLONG time;
+    DWORD size;
+};
+
+static struct
+{
+    BOOL initialised;
+    WCHAR path[MAX_PATH];           /* Cache directory, empty if the cache is unusable. */
+    struct wine_rb_tree entries;
+    struct list lru;                /* Most recently used entries first. */
+    UINT64 total_size;
+    UINT64 max_size;
+
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int stores;
+    unsigned int evictions;
+    LONGLONG hit_time;
+    LONGLONG miss_time;
+} shader_cache;
+
+static CRITICAL_SECTION shader_cache_cs;
+static CRITICAL_SECTION_DEBUG shader_cache_cs_debug =
+{
+    0, 0, &shader_cache_cs,
+    {&shader_cache_cs_debug.ProcessLocksList,
+    &shader_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_cache_cs")}
+};
+static CRITICAL_SECTION shader_cache_cs = {&shader_cache_cs_debug, -1, 0, 0, 0, 0};
+
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key)
+{
+    key->hash[0] = 0xcbf29ce484222325;
+    key->hash[1] = 0x84222325cbf29ce4;
+}
+
+void wined3d_shader_cache_key_update(struct wined3d_shader_cache_key *key, const void *data, SIZE_T size)
+{
+    UINT64 a = key->hash[0], b = key->hash[1];
+    const BYTE *ptr = data;
+    SIZE_T i;
+
+    for (i = 0; i < size; ++i)
+    {
+        a = (a ^ ptr[i]) * 0x100000001b3;
+        b = (b + ptr[i]) * 0xc6a4a7935bd1e995;
+        b ^= b >> 47;
+    }
+
+    /* Mix in the size, so that consecutive updates can't alias. */
+    key->hash[0] = (a ^ size) * 0x100000001b3;
+    key->hash[1] = (b + size) * 0xc6a4a7935bd1e995;
+}
+
+static int wined3d_shader_cache_entry_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_shader_cache_key *k = key;
+    const struct wined3d_shader_cache_entry *e;
+
+    e = WINE_RB_ENTRY_VALUE(entry, const struct wined3d_shader_cache_entry, entry);
+    if (k->hash[0] != e->key.hash[0])
+        return k->hash[0] < e->key.hash[0] ? -1 : 1;
+    if (k->hash[1] != e->key.hash[1])
+        return k->hash[1] < e->key.hash[1] ? -1 : 1;
+    return 0;
+}
+
+static void wined3d_shader_cache_get_file_name(const struct wined3d_shader_cache_key *key,
+        const WCHAR *extension, WCHAR *file_name)
+{
+    static const WCHAR formatW[] = {'%','s','\\','%','0','8','x','%','0','8','x',
+            '%','0','8','x','%','0','8','x','%','s',0};
+
+    sprintfW(file_name, formatW, shader_cache.path,
+            (DWORD)(key->hash[0] >> 32), (DWORD)key->hash[0],
+            (DWORD)(key->hash[1] >> 32), (DWORD)key->hash[1], extension);
+}
+
+static BOOL wined3d_shader_cache_parse_file_name(const WCHAR *name, struct wined3d_shader_cache_key *key)
+{
+    static const WCHAR binW[] = {'.','b','i','n',0};
+    unsigned int i, digit;
+
+    key->hash[0] = key->hash[1] = 0;
+    for (i = 0; i < WINED3D_SHADER_CACHE_NAME_SIZE; ++i)
+    {
+        if (name[i] >= '0' && name[i] <= '9')
+            digit = name[i] - '0';
+        else if (name[i] >= 'a' && name[i] <= 'f')
+            digit = name[i] - 'a' + 10;
+        else
+            return FALSE;
+        key->hash[i / 16] = (key->hash[i / 16] << 4) | digit;
+    }
+
+    return !strcmpW(name + WINED3D_SHADER_CACHE_NAME_SIZE, binW);
+}
+
+static struct wined3d_shader_cache_entry *wined3d_shader_cache_add_entry(
+        const struct wined3d_shader_cache_key *key, DWORD size)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+
+    if ((rb_entry = wine_rb_get(&shader_cache.entries, key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+        shader_cache.total_size -= entry->size;
+        list_remove(&entry->lru_entry);
+    }
+    else
+    {
+        if (!(entry = heap_alloc(sizeof(*entry))))
+            return NULL;
+        entry->key = *key;
+        if (wine_rb_put(&shader_cache.entries, &entry->key, &entry->entry) == -1)
+        {
+            heap_free(entry);
+            return NULL;
+        }
+    }
+
+    entry->size = size;
+    shader_cache.total_size += size;
+
+    return entry;
+}
+
+static void wined3d_shader_cache_remove_entry(struct wined3d_shader_cache_entry *entry, BOOL delete_file)
+{
+    static const WCHAR binW[] = {'.','b','i','n',0};
+    WCHAR file_name[MAX_PATH];
+
+    if (delete_file)
+    {
+        wined3d_shader_cache_get_file_name(&entry->key, binW, file_name);
+        if (!DeleteFileW(file_name) && GetLastError() != ERROR_FILE_NOT_FOUND)
+            WARN("Failed to delete %s, error %u.\n", debugstr_w(file_name), GetLastError());
+    }
+
+    shader_cache.total_size -= entry->size;
+    list_remove(&entry->lru_entry);
+    wine_rb_remove(&shader_cache.entries, &entry->entry);
+    heap_free(entry);
+}
+
+static void wined3d_shader_cache_trim(void)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct list *tail;
+
+    while (shader_cache.total_size > shader_cache.max_size && (tail = list_tail(&shader_cache.lru)))
+    {
+        entry = LIST_ENTRY(tail, struct wined3d_shader_cache_entry, lru_entry);
+        TRACE("Evicting program binary %s.\n", wine_dbgstr_longlong(entry->key.hash[0]));
+        wined3d_shader_cache_remove_entry(entry, TRUE);
+        ++shader_cache.evictions;
+    }
+}
+
+static int wined3d_shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_file *f1 = a, *f2 = b;
+
+    /* Most recently used first. */
+    if (f1->time != f2->time)
+        return f1->time > f2->time ? -1 : 1;
+    return 0;
+}
+
+/* Rebuild the LRU list from the file timestamps. These are refreshed on
+ * every hit, so that the order survives between sessions. */
+static void wined3d_shader_cache_scan(void)
+{
+    static const WCHAR patternW[] = {'%','s','\\','*','.','b','i','n',0};
+    struct wined3d_shader_cache_file *files = NULL;
+    struct wined3d_shader_cache_entry *entry;
+    SIZE_T count = 0, capacity = 0, i;
+    WCHAR pattern[MAX_PATH];
+    WIN32_FIND_DATAW data;
+    HANDLE find;
+
+    sprintfW(pattern, patternW, shader_cache.path);
+    if ((find = FindFirstFileW(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        if (data.nFileSizeHigh || data.nFileSizeLow <= sizeof(struct wined3d_shader_cache_header))
+            continue;
+        if (!wined3d_array_reserve((void **)&files, &capacity, count + 1, sizeof(*files)))
+            break;
+        if (!wined3d_shader_cache_parse_file_name(data.cFileName, &files[count].key))
+            continue;
+        files[count].time = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32)
+                | data.ftLastWriteTime.dwLowDateTime;
+        files[count].size = data.nFileSizeLow;
+        ++count;
+    } while (FindNextFileW(find, &data));
+    FindClose(find);
+
+    qsort(files, count, sizeof(*files), wined3d_shader_cache_file_compare);
+    for (i = 0; i < count; ++i)
+    {
+        if ((entry = wined3d_shader_cache_add_entry(&files[i].key, files[i].size)))
+            list_add_tail(&shader_cache.lru, &entry->lru_entry);
+    }
+    heap_free(files);
+
+    TRACE("Found %lu program binaries, %s bytes.\n", count, wine_dbgstr_longlong(shader_cache.total_size));
+
+    wined3d_shader_cache_trim();
+}
+
+static void wined3d_shader_cache_init(void)
+{
+    static const char dir_name[] = "/wined3d_shader_cache";
+    const char *config_dir;
+    char *unix_path;
+    WCHAR *path;
+
+    shader_cache.initialised = TRUE;
+    wine_rb_init(&shader_cache.entries, wined3d_shader_cache_entry_compare);
+    list_init(&shader_cache.lru);
+
+    if (!(shader_cache.max_size = (UINT64)wined3d_settings.shader_cache_size << 20))
+        return;
+
+    if (!(config_dir = wine_get_config_dir()))
+        return;
+    if (!(unix_path = heap_alloc(strlen(config_dir) + sizeof(dir_name))))
+        return;
+    strcpy(unix_path, config_dir);
+    strcat(unix_path, dir_name);
+    path = wine_get_dos_file_name(unix_path);
+    heap_free(unix_path);
+    if (!path)
+        return;
+
+    /* Leave room for a "\<hash>.<pid>.tmp" file name. */
+    if (strlenW(path) + WINED3D_SHADER_CACHE_NAME_SIZE + 16 >= MAX_PATH)
+    {
+        WARN("Cache path %s is too long.\n", debugstr_w(path));
+    }
+    else if (!CreateDirectoryW(path, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_w(path), GetLastError());
+    }
+    else
+    {
+        strcpyW(shader_cache.path, path);
+        TRACE("Using program binary cache %s, max size %s bytes.\n",
+                debugstr_w(path), wine_dbgstr_longlong(shader_cache.max_size));
+        wined3d_shader_cache_scan();
+    }
+    heap_free(path);
+}
+
+/* Returns a heap allocated copy of the program binary for "key". The caller
+ * is expected to call wined3d_shader_cache_remove() if the driver rejects
+ * it. */
+BOOL wined3d_shader_cache_get(const struct wined3d_shader_cache_key *key, const void *material,
+        SIZE_T material_size, DWORD *format, void **data, DWORD *size)
+{
+    static const WCHAR binW[] = {'.','b','i','n',0};
+    struct wined3d_shader_cache_header header;
+    struct wined3d_shader_cache_key checksum;
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    WCHAR file_name[MAX_PATH];
+    void *stored_material = NULL;
+    void *blob = NULL;
+    FILETIME now;
+    HANDLE file;
+    DWORD read;
+
+    EnterCriticalSection(&shader_cache_cs);
+
+    if (!shader_cache.initialised)
+        wined3d_shader_cache_init();
+    if (!shader_cache.path[0] || !(rb_entry = wine_rb_get(&shader_cache.entries, key)))
+    {
+        LeaveCriticalSection(&shader_cache_cs);
+        return FALSE;
+    }
+    entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+
+    wined3d_shader_cache_get_file_name(key, binW, file_name);
+    if ((file = CreateFileW(file_name, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        /* Probably evicted by another process. */
+        WARN("Failed to open %s, error %u.\n", debugstr_w(file_name), GetLastError());
+        wined3d_shader_cache_remove_entry(entry, FALSE);
+        LeaveCriticalSection(&shader_cache_cs);
+        return FALSE;
+    }
+
+    if (!ReadFile(file, &header, sizeof(header), &read, NULL) || read != sizeof(header)
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.version != WINED3D_SHADER_CACHE_VERSION
+            || memcmp(&header.key, key, sizeof(*key))
+            || (UINT64)header.material_size + header.size != entry->size - sizeof(header))
+    {
+        WARN("Invalid cache file %s.\n", debugstr_w(file_name));
+        goto fail;
+    }
+
+    if (header.material_size != material_size
+            || !(stored_material = heap_alloc(material_size))
+            || !ReadFile(file, stored_material, material_size, &read, NULL) || read != material_size
+            || memcmp(stored_material, material, material_size))
+    {
+        /* A hash collision, or a corrupted file. Either way the entry is of
+         * no use to us. */
+        WARN("Key mismatch in cache file %s.\n", debugstr_w(file_name));
+        goto fail;
+    }
+    heap_free(stored_material);
+    stored_material = NULL;
+
+    if (!(blob = heap_alloc(header.size))
+            || !ReadFile(file, blob, header.size, &read, NULL) || read != header.size)
+    {
+        WARN("Invalid cache file %s.\n", debugstr_w(file_name));
+        goto fail;
+    }
+
+    wined3d_shader_cache_key_init(&checksum);
+    wined3d_shader_cache_key_update(&checksum, blob, header.size);
+    if (memcmp(&checksum, &header.checksum, sizeof(checksum)))
+    {
+        WARN("Checksum mismatch in cache file %s.\n", debugstr_w(file_name));
+        goto fail;
+    }
+
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+
+    list_remove(&entry->lru_entry);
+    list_add_head(&shader_cache.lru, &entry->lru_entry);
+
+    LeaveCriticalSection(&shader_cache_cs);
+
+    *format = header.format;
+    *data = blob;
+    *size = header.size;
+    return TRUE;
+
+fail:
+    heap_free(stored_material);
+    heap_free(blob);
+    CloseHandle(file);
+    wined3d_shader_cache_remove_entry(entry, TRUE);
+    LeaveCriticalSection(&shader_cache_cs);
+    return FALSE;
+}
+
+void wined3d_shader_cache_put(const struct wined3d_shader_cache_key *key, const void *material,
+        SIZE_T material_size, DWORD format, const void *data, DWORD size)
+{
+    static const WCHAR binW[] = {'.','b','i','n',0};
+    static const WCHAR tmp_formatW[] = {'.','%','x','.','t','m','p',0};
+    WCHAR file_name[MAX_PATH], tmp_name[MAX_PATH], extension[16];
+    struct wined3d_shader_cache_header header;
+    struct wined3d_shader_cache_entry *entry;
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    EnterCriticalSection(&shader_cache_cs);
+
+    if (!shader_cache.initialised)
+        wined3d_shader_cache_init();
+    if (!shader_cache.path[0] || material_size > ~0u - size
+            || sizeof(header) + material_size + size > shader_cache.max_size)
+    {
+        LeaveCriticalSection(&shader_cache_cs);
+        return;
+    }
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.version = WINED3D_SHADER_CACHE_VERSION;
+    header.key = *key;
+    wined3d_shader_cache_key_init(&header.checksum);
+    wined3d_shader_cache_key_update(&header.checksum, data, size);
+    header.format = format;
+    header.material_size = material_size;
+    header.size = size;
+
+    /* Write to a temporary file first, so that other processes never see
+     * partially written entries. */
+    sprintfW(extension, tmp_formatW, GetCurrentProcessId());
+    wined3d_shader_cache_get_file_name(key, extension, tmp_name);
+    wined3d_shader_cache_get_file_name(key, binW, file_name);
+    if ((file = CreateFileW(tmp_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_w(tmp_name), GetLastError());
+        LeaveCriticalSection(&shader_cache_cs);
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, material, material_size, &written, NULL) && written == material_size
+            && WriteFile(file, data, size, &written, NULL) && written == size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExW(tmp_name, file_name, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write %s, error %u.\n", debugstr_w(file_name), GetLastError());
+        DeleteFileW(tmp_name);
+        LeaveCriticalSection(&shader_cache_cs);
+        return;
+    }
+
+    if ((entry = wined3d_shader_cache_add_entry(key, sizeof(header) + material_size + size)))
+    {
+        list_add_head(&shader_cache.lru, &entry->lru_entry);
+        ++shader_cache.stores;
+        wined3d_shader_cache_trim();
+    }
+
+    LeaveCriticalSection(&shader_cache_cs);
+}
+
+void wined3d_shader_cache_remove(const struct wined3d_shader_cache_key *key)
+{
+    struct wine_rb_entry *rb_entry;
+
+    EnterCriticalSection(&shader_cache_cs);
+    if (shader_cache.initialised && (rb_entry = wine_rb_get(&shader_cache.entries, key)))
+        wined3d_shader_cache_remove_entry(WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry),
+                TRUE);
+    LeaveCriticalSection(&shader_cache_cs);
+}
+
+/* "time" is in performance counter ticks. */
+void wined3d_shader_cache_record_link(BOOL hit, LONGLONG time)
+{
+    EnterCriticalSection(&shader_cache_cs);
+    if (hit)
+    {
+        ++shader_cache.hits;
+        shader_cache.hit_time += time;
+    }
+    else
+    {
+        ++shader_cache.misses;
+        shader_cache.miss_time += time;
+    }
+    LeaveCriticalSection(&shader_cache_cs);
+}
+
+static void wined3d_shader_cache_dump_statistics(void)
+{
+    LARGE_INTEGER freq;
+    double scale;
+
+    if (!TRACE_ON(d3d_perf))
+        return;
+
+    EnterCriticalSection(&shader_cache_cs);
+    if (shader_cache.hits || shader_cache.misses)
+    {
+        QueryPerformanceFrequency(&freq);
+        scale = 1000.0 / freq.QuadPart;
+        TRACE_(d3d_perf)("Program cache: %u hits, %u misses, %u stores, %u evictions, %s bytes.\n",
+                shader_cache.hits, shader_cache.misses, shader_cache.stores, shader_cache.evictions,
+                wine_dbgstr_longlong(shader_cache.total_size));
+        TRACE_(d3d_perf)("Program cache: %.3f ms average load time, %.3f ms average link time.\n",
+                shader_cache.hits ? shader_cache.hit_time * scale / shader_cache.hits : 0.0,
+                shader_cache.misses ? shader_cache.miss_time * scale / shader_cache.misses : 0.0);
+    }
+    LeaveCriticalSection(&shader_cache_cs);
+}
+
+static void wined3d_shader_cache_free_entry(struct wine_rb_entry *entry, void *context)
+{
+    heap_free(WINE_RB_ENTRY_VALUE(entry, struct wined3d_shader_cache_entry, entry));
+}
+
+void wined3d_shader_cache_cleanup(void)
+{
+    wined3d_shader_cache_dump_statistics();
+
+    if (shader_cache.initialised)
+        wine_rb_destroy(&shader_cache.entries, wined3d_shader_cache_free_entry, NULL);
+    DeleteCriticalSection(&shader_cache_cs);
+}
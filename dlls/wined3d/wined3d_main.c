@@ -91,6 +91,7 @@ struct wined3d_settings wined3d_settings =
     ~0U,            /* No PS shader model limit by default. */
     ~0u,            /* No CS shader model limit by default. */
     FALSE,          /* 3D support enabled by default. */
+    64,             /* 64 MiB program binary cache. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -313,6 +314,8 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Disabling 3D support.\n");
             wined3d_settings.no_3d = TRUE;
         }
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting program binary cache to %u MiB.\n", wined3d_settings.shader_cache_size);
     }
 
     if (appkey) RegCloseKey( appkey );
@@ -345,6 +348,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(wndproc_table.entries);
 
     heap_free(wined3d_settings.logo);
+    wined3d_shader_cache_cleanup();
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_wndproc_cs);
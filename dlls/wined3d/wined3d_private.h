@@ -403,6 +403,7 @@ struct wined3d_settings
     unsigned int max_sm_ps;
     unsigned int max_sm_cs;
     BOOL no_3d;
+    unsigned int shader_cache_size;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -4166,6 +4167,22 @@ struct ps_np2fixup_info {
 void print_glsl_info_log(const struct wined3d_gl_info *gl_info, GLuint id, BOOL program) DECLSPEC_HIDDEN;
 void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint program) DECLSPEC_HIDDEN;
 
+struct wined3d_shader_cache_key
+{
+    UINT64 hash[2];
+};
+
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_update(struct wined3d_shader_cache_key *key,
+        const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+BOOL wined3d_shader_cache_get(const struct wined3d_shader_cache_key *key, const void *material,
+        SIZE_T material_size, DWORD *format, void **data, DWORD *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_put(const struct wined3d_shader_cache_key *key, const void *material,
+        SIZE_T material_size, DWORD format, const void *data, DWORD size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_remove(const struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_record_link(BOOL hit, LONGLONG time) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_cleanup(void) DECLSPEC_HIDDEN;
+
 struct wined3d_palette
 {
     LONG ref;
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <limits.h>
 #ifdef HAVE_SYS_IPC_H
 # include <sys/ipc.h>
@@ -64,6 +65,9 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -157,6 +161,7 @@
 #include "wine/server.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
+#include "wine/list.h"
 #include "wine/unicode.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
@@ -243,6 +248,9 @@ static struct interface_filter generic_interface_filter = {
 
 extern ssize_t CDECL __wine_locked_recvmsg( int fd, struct msghdr *hdr, int flags );
 
+struct ws2_async;
+static int WS2_batch_io( int fd, struct ws2_async *wsa, int flags );
+
 /*
  * The actual definition of WSASendTo, wrapped in a different function name
  * so that internal calls from ws2_32 itself will not trigger programs like
@@ -504,6 +512,11 @@ struct ws2_async
     DWORD                               flags;
     DWORD                              *lpFlags;
     WSABUF                             *control;
+    int                                 batch_type;   /* async type if the I/O can be batched */
+    LONG                                batch_state;
+    NTSTATUS                            batch_status; /* result of I/O done by another async */
+    int                                 batch_result;
+    struct list                         batch_entry;
     unsigned int                        n_iovecs;
     unsigned int                        first_iovec;
     struct iovec                        iovec[1];
@@ -531,6 +544,7 @@ struct ws2_transmitfile_async
     DWORD                 file_read;
     DWORD                 file_bytes;
     DWORD                 bytes_per_send;
+    BOOL                  use_sendfile;
     TRANSMIT_FILE_BUFFERS buffers;
     DWORD                 flags;
     LARGE_INTEGER         offset;
@@ -1099,6 +1113,130 @@ static inline void release_sock_fd( SOCKET s, int fd )
     wine_server_release_fd( SOCKET2HANDLE(s), fd );
 }
 
+/* The server publishes the state of its sockets in shared memory, so that send and
+ * recv don't have to ask for it every time. The slot of a handle is remembered here,
+ * but it is only used while it describes the same unix socket as the handle, so
+ * duplicated, inherited and reused handles see the state of the socket they refer to. */
+#define SOCK_SHM_NONE           (~0u)  /* the server has no slot for the socket */
+
+#define SOCK_SHM_BLOCK_SIZE     1024
+#define SOCK_SHM_BLOCKS         64
+
+static const struct socket_shm *socket_shm_base;
+static unsigned int socket_shm_count;
+static LONG *sock_shm_cache[SOCK_SHM_BLOCKS];
+
+static LONG *get_sock_shm_entry( SOCKET s )
+{
+    unsigned int idx = (wine_server_obj_handle( SOCKET2HANDLE(s) ) >> 2) - 1;
+    unsigned int block = idx / SOCK_SHM_BLOCK_SIZE;
+    LONG *ptr;
+
+    if (block >= SOCK_SHM_BLOCKS) return NULL;
+    if (!(ptr = sock_shm_cache[block]))
+    {
+        if (!(ptr = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, SOCK_SHM_BLOCK_SIZE * sizeof(LONG) )))
+            return NULL;
+        if (InterlockedCompareExchangePointer( (void **)&sock_shm_cache[block], ptr, NULL ))
+        {
+            HeapFree( GetProcessHeap(), 0, ptr );
+            ptr = sock_shm_cache[block];
+        }
+    }
+    return &ptr[idx % SOCK_SHM_BLOCK_SIZE];
+}
+
+/* ask the server for the slot of a socket, return its index + 1 or 0 if it has none */
+static unsigned int map_sock_shm( SOCKET s, LONG *entry )
+{
+    const struct socket_shm *base;
+    HANDLE file = 0, mapping;
+    data_size_t size = 0;
+    unsigned int index = 0;
+
+    SERVER_START_REQ( get_socket_shm )
+    {
+        req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
+        if (!wine_server_call( req ))
+        {
+            file  = wine_server_ptr_handle( reply->shm_handle );
+            size  = reply->size;
+            index = reply->index;
+        }
+    }
+    SERVER_END_REQ;
+    if (!file)
+    {
+        InterlockedExchange( entry, SOCK_SHM_NONE );
+        return 0;
+    }
+
+    if (!(base = socket_shm_base) && (mapping = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL )))
+    {
+        socket_shm_count = size / sizeof(*base);
+        if ((base = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 )) &&
+            InterlockedCompareExchangePointer( (void **)&socket_shm_base, (void *)base, NULL ))
+        {
+            UnmapViewOfFile( base );  /* another thread mapped it first */
+            base = socket_shm_base;
+        }
+        CloseHandle( mapping );
+    }
+    CloseHandle( file );
+
+    TRACE( "socket %04lx slot %u mapped at %p\n", s, index, base );
+    if (!base || index >= socket_shm_count)
+    {
+        InterlockedExchange( entry, SOCK_SHM_NONE );
+        return 0;
+    }
+    InterlockedExchange( entry, index + 1 );
+    return index + 1;
+}
+
+/* get a consistent copy of the state published by the server for a socket */
+static BOOL read_sock_shm( SOCKET s, struct socket_shm *state )
+{
+#if defined(__i386__) || defined(__x86_64__)
+    /* loads are not reordered on x86, volatile accesses are enough to read the slot */
+    const volatile struct socket_shm *shm;
+    LONG *entry = get_sock_shm_entry( s );
+    unsigned int index;
+    BOOL mapped = FALSE;
+    struct stat st;
+    int fd, seq, retry, ret;
+
+    if (!entry || (index = *entry) == SOCK_SHM_NONE) return FALSE;
+    if (wine_server_handle_to_fd( SOCKET2HANDLE(s), 0, &fd, NULL )) return FALSE;
+    ret = fstat( fd, &st );
+    wine_server_release_fd( SOCKET2HANDLE(s), fd );
+    if (ret) return FALSE;
+
+    for (;;)
+    {
+        if (!index)
+        {
+            if (mapped || !(index = map_sock_shm( s, entry ))) return FALSE;
+            mapped = TRUE;
+        }
+        shm = socket_shm_base + index - 1;
+        for (retry = 0; retry < 16; retry++)
+        {
+            if ((seq = shm->seq) & 1) continue;  /* the server is updating it */
+            state->state  = shm->state;
+            state->events = shm->events;
+            state->ino    = shm->ino;
+            if (shm->seq == seq) break;
+        }
+        if (retry == 16) return FALSE;
+        /* slots are reused once their socket is destroyed, check that it is the socket of the handle */
+        if (state->ino && state->ino == st.st_ino) return TRUE;
+        index = 0;
+    }
+#endif
+    return FALSE;
+}
+
 static void _enable_event( HANDLE s, unsigned int event,
                            unsigned int sstate, unsigned int cstate )
 {
@@ -1113,9 +1251,26 @@ static void _enable_event( HANDLE s, unsigned int event,
     SERVER_END_REQ;
 }
 
+/* re-enable an event after a send or recv, unless the server state shows that it
+ * would change nothing because the event is neither pending nor held */
+static void _reenable_event( HANDLE h, unsigned int event )
+{
+    struct socket_shm state;
+
+    if (read_sock_shm( HANDLE2SOCKET(h), &state ) && !(state.events & event)) return;
+    _enable_event( h, event, 0, 0 );
+}
+
 static NTSTATUS _is_blocking(SOCKET s, BOOL *ret)
 {
+    struct socket_shm state;
     NTSTATUS status;
+
+    if (read_sock_shm( s, &state ))
+    {
+        *ret = !(state.state & FD_WINE_NONBLOCKING);
+        return STATUS_SUCCESS;
+    }
     SERVER_START_REQ( get_socket_event )
     {
         req->handle  = wine_server_obj_handle( SOCKET2HANDLE(s) );
@@ -1145,10 +1300,9 @@ static unsigned int _get_sock_mask(SOCKET s)
 
 static void _sync_sock_state(SOCKET s)
 {
-    BOOL dummy;
     /* do a dummy wineserver request in order to let
        the wineserver run through its select loop once */
-    (void)_is_blocking(s, &dummy);
+    (void)_get_sock_mask(s);
 }
 
 static void _get_sock_errors(SOCKET s, int *events)
@@ -2323,6 +2477,78 @@ static void WINAPI ws2_async_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserv
     release_async_io( &wsa->io );
 }
 
+/* Overlapped datagram operations waiting on the same socket are performed
+ * with a single recvmmsg or sendmmsg call by the first one that gets woken
+ * up, and the others are then completed with a single server request. */
+#define BATCH_IDLE     0  /* waiting in the server queue */
+#define BATCH_RUNNING  1  /* being processed by its own callback */
+#define BATCH_BUSY     2  /* claimed by the callback of another async */
+#define BATCH_DONE     3  /* I/O done by another async, not reported yet */
+
+#define MAX_BATCH_ASYNCS 16
+
+static struct list batch_asyncs = LIST_INIT( batch_asyncs );
+
+static CRITICAL_SECTION batch_section;
+static CRITICAL_SECTION_DEBUG batch_section_debug =
+{
+    0, 0, &batch_section,
+    { &batch_section_debug.ProcessLocksList, &batch_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": batch_section") }
+};
+static CRITICAL_SECTION batch_section = { &batch_section_debug, -1, 0, 0, 0, 0 };
+
+static BOOL is_batch_supported( int fd, struct ws2_async *wsa, int type )
+{
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+    if (wsa->control || (wsa->flags & WS_MSG_OOB)) return FALSE;
+    if (type == ASYNC_TYPE_WRITE && wsa->addr &&
+        wsa->addr->sa_family != WS_AF_INET && wsa->addr->sa_family != WS_AF_INET6) return FALSE;
+    return _get_fd_type( fd ) == SOCK_DGRAM;
+#else
+    return FALSE;
+#endif
+}
+
+/* add an async to the batch list; other asyncs leave it alone until start_batch_async */
+static void add_batch_async( int fd, struct ws2_async *wsa, int type )
+{
+    wsa->batch_type = 0;
+    if (!is_batch_supported( fd, wsa, type )) return;
+
+    wsa->batch_type  = type;
+    wsa->batch_state = BATCH_RUNNING;
+    EnterCriticalSection( &batch_section );
+    list_add_tail( &batch_asyncs, &wsa->batch_entry );
+    LeaveCriticalSection( &batch_section );
+}
+
+/* make an async available to the batched I/O of other asyncs once the server queued it */
+static void start_batch_async( struct ws2_async *wsa )
+{
+    if (wsa->batch_type) InterlockedCompareExchange( &wsa->batch_state, BATCH_IDLE, BATCH_RUNNING );
+}
+
+static void remove_batch_async( struct ws2_async *wsa )
+{
+    if (!wsa->batch_type) return;
+    EnterCriticalSection( &batch_section );
+    list_remove( &wsa->batch_entry );
+    list_init( &wsa->batch_entry );
+    LeaveCriticalSection( &batch_section );
+}
+
+/* take over an async in its own callback, return FALSE if another async already did its I/O */
+static BOOL claim_batch_async( struct ws2_async *wsa )
+{
+    LONG state;
+
+    /* the other async only holds it for the duration of a system call */
+    while ((state = InterlockedCompareExchange( &wsa->batch_state, BATCH_RUNNING, BATCH_IDLE )) == BATCH_BUSY)
+        Sleep( 0 );
+    return state != BATCH_DONE;
+}
+
 /***********************************************************************
  *              WS2_recv                (INTERNAL)
  *
@@ -2406,25 +2632,34 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
     struct ws2_async *wsa = user;
     int result = 0, fd;
 
-    switch (status)
+    if (wsa->batch_type && !claim_batch_async( wsa ))
+    {
+        /* another async already received our datagram */
+        status = wsa->batch_status;
+        result = wsa->batch_result;
+    }
+    else switch (status)
     {
     case STATUS_ALERTED:
         if ((status = wine_server_handle_to_fd( wsa->hSocket, FILE_READ_DATA, &fd, NULL ) ))
             break;
 
-        result = WS2_recv( fd, wsa, convert_flags(wsa->flags) );
+        if (wsa->batch_type)
+            result = WS2_batch_io( fd, wsa, convert_flags(wsa->flags) );
+        else
+            result = WS2_recv( fd, wsa, convert_flags(wsa->flags) );
         wine_server_release_fd( wsa->hSocket, fd );
         if (result >= 0)
         {
             status = STATUS_SUCCESS;
-            _enable_event( wsa->hSocket, FD_READ, 0, 0 );
+            _reenable_event( wsa->hSocket, FD_READ );
         }
         else
         {
             if (errno == EAGAIN)
             {
                 status = STATUS_PENDING;
-                _enable_event( wsa->hSocket, FD_READ, 0, 0 );
+                _reenable_event( wsa->hSocket, FD_READ );
             }
             else
             {
@@ -2436,11 +2671,13 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
     }
     if (status != STATUS_PENDING)
     {
+        remove_batch_async( wsa );
         iosb->u.Status = status;
         iosb->Information = result;
         if (!wsa->completion_func)
             release_async_io( &wsa->io );
     }
+    else if (wsa->batch_type) InterlockedExchange( &wsa->batch_state, BATCH_IDLE );
     return status;
 }
 
@@ -2609,6 +2846,173 @@ static int WS2_send( int fd, struct ws2_async *wsa, int flags )
     return ret;
 }
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+
+/* claim the other asyncs that can be batched with the given one */
+static unsigned int grab_batch_asyncs( struct ws2_async *wsa, struct ws2_async **batch )
+{
+    struct ws2_async *other, *next;
+    unsigned int count = 0;
+
+    EnterCriticalSection( &batch_section );
+    LIST_FOR_EACH_ENTRY_SAFE( other, next, &batch_asyncs, struct ws2_async, batch_entry )
+    {
+        if (other == wsa || other->hSocket != wsa->hSocket || other->batch_type != wsa->batch_type ||
+            other->flags != wsa->flags) continue;
+        if (InterlockedCompareExchange( &other->batch_state, BATCH_BUSY, BATCH_IDLE ) != BATCH_IDLE) continue;
+        list_remove( &other->batch_entry );
+        list_init( &other->batch_entry );
+        batch[count++] = other;
+        if (count == MAX_BATCH_ASYNCS - 1) break;
+    }
+    LeaveCriticalSection( &batch_section );
+    return count;
+}
+
+/* give back the asyncs that didn't get any data, keeping their queue order */
+static void release_batch_asyncs( struct ws2_async **batch, unsigned int count )
+{
+    if (!count) return;
+    EnterCriticalSection( &batch_section );
+    while (count--)
+    {
+        list_add_head( &batch_asyncs, &batch[count]->batch_entry );
+        InterlockedExchange( &batch[count]->batch_state, BATCH_IDLE );
+    }
+    LeaveCriticalSection( &batch_section );
+}
+
+/* report the asyncs whose I/O has been done to the server */
+static void complete_batch_asyncs( HANDLE handle, struct ws2_async **batch, unsigned int count )
+{
+    async_result_t results[MAX_BATCH_ASYNCS];
+    BOOL release[MAX_BATCH_ASYNCS];
+    unsigned int i, completed = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        IO_STATUS_BLOCK *iosb = batch[i]->user_overlapped ? (IO_STATUS_BLOCK *)batch[i]->user_overlapped
+                                                          : &batch[i]->local_iosb;
+
+        iosb->u.Status     = batch[i]->batch_status;
+        iosb->Information  = batch[i]->batch_result;
+        results[i].user    = wine_server_client_ptr( &batch[i]->io );
+        results[i].total   = batch[i]->batch_result;
+        results[i].status  = batch[i]->batch_status;
+        results[i].__pad   = 0;
+        /* once the server completes it, a completion routine may free it at any time */
+        release[i] = !batch[i]->completion_func;
+        InterlockedExchange( &batch[i]->batch_state, BATCH_DONE );
+    }
+
+    SERVER_START_REQ( complete_asyncs )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_add_data( req, results, count * sizeof(results[0]) );
+        if (!wine_server_call( req )) completed = reply->completed;
+    }
+    SERVER_END_REQ;
+
+    /* the asyncs that weren't completed report their result from their own callback */
+    for (i = 0; i < count; i++)
+        if ((completed & (1 << i)) && release[i]) release_async_io( &batch[i]->io );
+}
+
+/* prepare the message header of a batched async */
+static BOOL init_batch_msghdr( struct msghdr *hdr, struct ws2_async *wsa, union generic_unix_sockaddr *addr )
+{
+    memset( hdr, 0, sizeof(*hdr) );
+    hdr->msg_iov    = wsa->iovec + wsa->first_iovec;
+    hdr->msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
+    if (!wsa->addr) return TRUE;
+
+    hdr->msg_name = addr;
+    if (wsa->batch_type == ASYNC_TYPE_READ)
+        hdr->msg_namelen = sizeof(*addr);
+    else if (!(hdr->msg_namelen = ws_sockaddr_ws2u( wsa->addr, wsa->addrlen.val, addr )))
+        return FALSE;
+    return TRUE;
+}
+
+/* store the result of a batched async */
+static int finish_batch_msghdr( struct mmsghdr *msg, struct ws2_async *wsa )
+{
+    if (wsa->batch_type == ASYNC_TYPE_READ)
+    {
+        if (wsa->addr && msg->msg_hdr.msg_namelen)
+            ws_sockaddr_u2ws( msg->msg_hdr.msg_name, wsa->addr, wsa->addrlen.ptr );
+    }
+    else wsa->first_iovec = wsa->n_iovecs;  /* datagrams are always sent entirely */
+    return msg->msg_len;
+}
+
+#endif  /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+
+/***********************************************************************
+ *              WS2_batch_io            (INTERNAL)
+ *
+ * Perform the I/O of an async together with the other asyncs waiting on
+ * the same datagram socket.
+ */
+static int WS2_batch_io( int fd, struct ws2_async *wsa, int flags )
+{
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+    struct ws2_async *batch[MAX_BATCH_ASYNCS];
+    union generic_unix_sockaddr addrs[MAX_BATCH_ASYNCS];
+    struct mmsghdr msgs[MAX_BATCH_ASYNCS];
+    unsigned int i, count, done;
+    int ret, err;
+
+    count = grab_batch_asyncs( wsa, batch + 1 );
+    if (!count || !init_batch_msghdr( &msgs[0].msg_hdr, wsa, &addrs[0] ))
+    {
+        release_batch_asyncs( batch + 1, count );
+        goto single;
+    }
+    batch[0] = wsa;
+
+    for (i = 1, done = 1; i <= count; i++)
+    {
+        if (init_batch_msghdr( &msgs[done].msg_hdr, batch[i], &addrs[done] )) batch[done++] = batch[i];
+        else release_batch_asyncs( &batch[i], 1 );
+    }
+    count = done;
+
+    do
+    {
+        if (wsa->batch_type == ASYNC_TYPE_READ)
+            ret = recvmmsg( fd, msgs, count, flags, NULL );
+        else
+            ret = sendmmsg( fd, msgs, count, flags );
+    } while (ret == -1 && errno == EINTR);
+    err = errno;
+
+    if (ret <= 0)
+    {
+        release_batch_asyncs( batch + 1, count - 1 );
+        /* the buffers may be write watched, let the single recv deal with them */
+        if (err == EFAULT) goto single;
+        errno = err;
+        return -1;
+    }
+
+    for (i = 1, done = ret; i < done; i++)
+    {
+        batch[i]->batch_result = finish_batch_msghdr( &msgs[i], batch[i] );
+        batch[i]->batch_status = STATUS_SUCCESS;
+    }
+    release_batch_asyncs( batch + done, count - done );
+    if (done > 1) complete_batch_asyncs( wsa->hSocket, batch + 1, done - 1 );
+
+    TRACE( "batched %u/%u asyncs on %p\n", done, count, wsa->hSocket );
+    return finish_batch_msghdr( &msgs[0], wsa );
+
+single:
+#endif
+    if (wsa->batch_type == ASYNC_TYPE_READ) return WS2_recv( fd, wsa, flags );
+    return WS2_send( fd, wsa, flags );
+}
+
 /***********************************************************************
  *              WS2_async_send          (INTERNAL)
  *
@@ -2619,7 +3023,13 @@ static NTSTATUS WS2_async_send( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
     struct ws2_async *wsa = user;
     int result = 0, fd;
 
-    switch (status)
+    if (wsa->batch_type && !claim_batch_async( wsa ))
+    {
+        /* another async already sent our datagram */
+        status = wsa->batch_status;
+        iosb->Information = wsa->batch_result;
+    }
+    else switch (status)
     {
     case STATUS_ALERTED:
         if ( wsa->n_iovecs <= wsa->first_iovec )
@@ -2632,7 +3042,10 @@ static NTSTATUS WS2_async_send( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
             break;
 
         /* check to see if the data is ready (non-blocking) */
-        result = WS2_send( fd, wsa, convert_flags(wsa->flags) );
+        if (wsa->batch_type)
+            result = WS2_batch_io( fd, wsa, convert_flags(wsa->flags) );
+        else
+            result = WS2_send( fd, wsa, convert_flags(wsa->flags) );
         wine_server_release_fd( wsa->hSocket, fd );
 
         if (result >= 0)
@@ -2656,10 +3069,12 @@ static NTSTATUS WS2_async_send( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
     }
     if (status != STATUS_PENDING)
     {
+        remove_batch_async( wsa );
         iosb->u.Status = status;
         if (!wsa->completion_func)
             release_async_io( &wsa->io );
     }
+    else if (wsa->batch_type) InterlockedExchange( &wsa->batch_state, BATCH_IDLE );
     return status;
 }
 
@@ -2855,6 +3270,7 @@ static BOOL WINAPI WS2_AcceptEx(SOCKET listener, SOCKET acceptor, PVOID dest, DW
         wsa->read->addr        = NULL;
         wsa->read->addrlen.ptr = NULL;
         wsa->read->control     = NULL;
+        wsa->read->batch_type  = 0;
         wsa->read->n_iovecs    = 1;
         wsa->read->first_iovec = 0;
         wsa->read->completion_func = NULL;
@@ -2922,6 +3338,60 @@ static NTSTATUS WS2_ReadFile(HANDLE hFile, PIO_STATUS_BLOCK io_status, char* buf
     return status;
 }
 
+/***********************************************************************
+ *     WS2_transmitfile_sendfile        (INTERNAL)
+ *
+ * Send the next chunk of the file directly from its Unix fd, without
+ * copying it through our buffer. Returns STATUS_NOT_SUPPORTED when the
+ * data has to be read and sent the usual way.
+ */
+static NTSTATUS WS2_transmitfile_sendfile( int fd, struct ws2_transmitfile_async *wsa, DWORD length )
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+    off_t offset = wsa->offset.QuadPart;
+    int file_fd, err;
+    ssize_t result;
+
+    /* let WS2_ReadFile deal with files that have no usable fd */
+    if (wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL ))
+        return STATUS_NOT_SUPPORTED;
+
+    do
+    {
+        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            result = sendfile( fd, file_fd, &offset, length );
+        else
+            result = sendfile( fd, file_fd, NULL, length );
+    } while (result == -1 && errno == EINTR);
+    err = errno;
+    wine_server_release_fd( wsa->file, file_fd );
+
+    if (result == -1)
+    {
+        if (err == EAGAIN) return STATUS_PENDING;  /* wait until the socket is writable */
+        if (err == EINVAL || err == ENOSYS || err == EOPNOTSUPP) return STATUS_NOT_SUPPORTED;
+        errno = err;
+        return wsaErrStatus();
+    }
+    if (!result)
+    {
+        wsa->file = NULL; /* continue on to the footer */
+        return STATUS_PENDING;
+    }
+
+    if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        wsa->offset.QuadPart += result;
+    wsa->file_read += result;
+    if (iosb) iosb->Information += result;
+    if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
+        wsa->file = NULL;
+    return STATUS_PENDING;
+#else
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
 /***********************************************************************
  *     WS2_transmitfile_getbuffer       (INTERNAL)
  *
@@ -2955,6 +3425,12 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
         /* when the size of the transfer is limited ensure that we don't go past that limit */
         if (wsa->file_bytes != 0)
             bytes_per_send = min(bytes_per_send, wsa->file_bytes - wsa->file_read);
+        if (wsa->use_sendfile)
+        {
+            status = WS2_transmitfile_sendfile( fd, wsa, bytes_per_send );
+            if (status != STATUS_NOT_SUPPORTED) return status;
+            wsa->use_sendfile = FALSE;
+        }
         status = WS2_ReadFile( wsa->file, &iosb, wsa->buffer, bytes_per_send, &wsa->offset );
         if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
             wsa->offset.QuadPart += iosb.Information;
@@ -3004,7 +3480,7 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
     NTSTATUS status;
 
     status = WS2_transmitfile_getbuffer( fd, wsa );
-    if (status == STATUS_PENDING)
+    if (status == STATUS_PENDING && wsa->write.first_iovec < wsa->write.n_iovecs)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
         int n;
@@ -3057,12 +3533,20 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     union generic_unix_sockaddr uaddr;
     socklen_t uaddrlen = sizeof(uaddr);
     struct ws2_transmitfile_async *wsa;
+    socklen_t optlen = sizeof(int);
+    int fd, sock_type = 0;
     NTSTATUS status;
-    int fd;
 
     TRACE("(%lx, %p, %d, %d, %p, %p, %d)\n", s, h, file_bytes, bytes_per_send, overlapped,
             buffers, flags );
 
+    if (h)
+    {
+        /* fetch the fds of the socket and of the file in a single server call */
+        HANDLE handles[2] = { SOCKET2HANDLE(s), h };
+        wine_server_prefetch_fds( handles, 2 );
+    }
+
     fd = get_sock_fd( s, FILE_WRITE_DATA, NULL );
     if (fd == -1)
     {
@@ -3106,6 +3590,9 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->file_read             = 0;
     wsa->file_bytes            = file_bytes;
     wsa->bytes_per_send        = bytes_per_send;
+    /* the file data can only be passed through the kernel on stream sockets */
+    wsa->use_sendfile          = !getsockopt( fd, SOL_SOCKET, SO_TYPE, (char *)&sock_type, &optlen ) &&
+                                 sock_type == SOCK_STREAM;
     wsa->flags                 = flags;
     wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
     wsa->write.hSocket         = SOCKET2HANDLE(s);
@@ -3576,6 +4063,7 @@ static BOOL WINAPI WS2_ConnectEx(SOCKET s, const struct WS_sockaddr* name, int n
             wsa->flags       = 0;
             wsa->lpFlags     = &wsa->flags;
             wsa->control     = NULL;
+            wsa->batch_type  = 0;
             wsa->n_iovecs    = sendBuf ? 1 : 0;
             wsa->first_iovec = 0;
             wsa->completion_func = NULL;
@@ -5601,6 +6089,8 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
         wsa->user_overlapped = lpOverlapped;
         wsa->completion_func = lpCompletionRoutine;
+        wsa->batch_type      = 0;
+        if (n == -1) add_batch_async( fd, wsa, ASYNC_TYPE_WRITE );
         release_sock_fd( s, fd );
 
         if (n == -1 || n < totalLength)
@@ -5617,9 +6107,14 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             /* Enable the event only after starting the async. The server will deliver it as soon as
                the async is done. */
-            _enable_event(SOCKET2HANDLE(s), FD_WRITE, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_WRITE);
 
-            if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
+            if (err != STATUS_PENDING)
+            {
+                remove_batch_async( wsa );
+                HeapFree( GetProcessHeap(), 0, wsa );
+            }
+            else start_batch_async( wsa );
             SetLastError(NtStatusToWSAError( err ));
             return SOCKET_ERROR;
         }
@@ -5689,7 +6184,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     else  /* non-blocking */
     {
         if (n < totalLength)
-            _enable_event(SOCKET2HANDLE(s), FD_WRITE, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_WRITE);
         if (n == -1)
         {
             err = WSAEWOULDBLOCK;
@@ -7952,6 +8447,8 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             wsa->user_overlapped = lpOverlapped;
             wsa->completion_func = lpCompletionRoutine;
+            wsa->batch_type      = 0;
+            if (n == -1) add_batch_async( fd, wsa, ASYNC_TYPE_READ );
             release_sock_fd( s, fd );
 
             if (n == -1)
@@ -7966,7 +8463,12 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                     err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
                                           NULL, (void *)cvalue, iosb );
 
-                if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
+                if (err != STATUS_PENDING)
+                {
+                    remove_batch_async( wsa );
+                    HeapFree( GetProcessHeap(), 0, wsa );
+                }
+                else start_batch_async( wsa );
                 SetLastError(NtStatusToWSAError( err ));
                 return SOCKET_ERROR;
             }
@@ -7981,7 +8483,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             }
             else NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)ws2_async_apc,
                                    (ULONG_PTR)wsa, (ULONG_PTR)iosb, 0 );
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_READ);
             return 0;
         }
 
@@ -8014,13 +8516,13 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             {
                 err = WSAETIMEDOUT;
                 /* a timeout is not fatal */
-                _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+                _reenable_event(SOCKET2HANDLE(s), FD_READ);
                 goto error;
             }
         }
         else
         {
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_READ);
             err = WSAEWOULDBLOCK;
             goto error;
         }
@@ -8029,7 +8531,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     TRACE(" -> %i bytes\n", n);
     if (wsa != &localwsa) HeapFree( GetProcessHeap(), 0, wsa );
     release_sock_fd( s, fd );
-    _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+    _reenable_event(SOCKET2HANDLE(s), FD_READ);
     SetLastError(ERROR_SUCCESS);
 
     return 0;
@@ -2334,6 +2334,191 @@ static void test_UDP(void)
     }
 }
 
+static DWORD WINAPI udp_echo_thread( void *param )
+{
+    SOCKET s = (SOCKET)param;
+    struct sockaddr_in addr;
+    char buf[512];
+    int len, ret;
+
+    /* an empty datagram stops the thread */
+    do
+    {
+        len = sizeof(addr);
+        ret = recvfrom( s, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &len );
+        if (ret > 0) sendto( s, buf, ret, 0, (struct sockaddr *)&addr, len );
+    } while (ret > 0);
+    return 0;
+}
+
+static void test_UDP_performance(void)
+{
+    unsigned int i, j, count = winetest_debug > 1 ? 100000 : 1000;
+    struct sockaddr_in addr, echo_addr;
+    u_long nonblocking = 1;
+    SOCKET s, echo;
+    HANDLE thread;
+    WSAEVENT event;
+    char buf[512];
+    DWORD start;
+    int len, ret;
+
+    memset( buf, 0x55, sizeof(buf) );
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr( "127.0.0.1" );
+
+    echo = socket( AF_INET, SOCK_DGRAM, 0 );
+    ok( echo != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError() );
+    s = socket( AF_INET, SOCK_DGRAM, 0 );
+    ok( s != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError() );
+    do_bind( echo, (struct sockaddr *)&addr, sizeof(addr) );
+    do_bind( s, (struct sockaddr *)&addr, sizeof(addr) );
+    len = sizeof(echo_addr);
+    ret = getsockname( echo, (struct sockaddr *)&echo_addr, &len );
+    ok( !ret, "getsockname failed: %d\n", WSAGetLastError() );
+
+    /* ping-pong through an echo thread */
+    thread = CreateThread( NULL, 0, udp_echo_thread, (void *)echo, 0, NULL );
+    ok( thread != NULL, "CreateThread failed: %u\n", GetLastError() );
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        ret = sendto( s, buf, 32, 0, (struct sockaddr *)&echo_addr, sizeof(echo_addr) );
+        ok( ret == 32, "sendto returned %d, error %d\n", ret, WSAGetLastError() );
+        len = sizeof(addr);
+        ret = recvfrom( s, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &len );
+        ok( ret == 32, "recvfrom returned %d, error %d\n", ret, WSAGetLastError() );
+        if (ret != 32) break;
+    }
+    if (winetest_debug > 1)
+        trace( "%u UDP round trips in %u ms\n", count, GetTickCount() - start );
+    ret = sendto( s, buf, 0, 0, (struct sockaddr *)&echo_addr, sizeof(echo_addr) );
+    ok( !ret, "sendto returned %d, error %d\n", ret, WSAGetLastError() );
+    ok( !WaitForSingleObject( thread, 10000 ), "echo thread didn't exit\n" );
+    CloseHandle( thread );
+
+    /* bulk transfer, in bursts small enough to not be dropped */
+    start = GetTickCount();
+    for (i = 0; i < count; i += 64)
+    {
+        for (j = 0; j < 64; j++)
+        {
+            ret = sendto( s, buf, 32, 0, (struct sockaddr *)&echo_addr, sizeof(echo_addr) );
+            ok( ret == 32, "sendto returned %d, error %d\n", ret, WSAGetLastError() );
+        }
+        for (j = 0; j < 64; j++)
+        {
+            len = sizeof(addr);
+            ret = recvfrom( echo, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &len );
+            ok( ret == 32, "recvfrom returned %d, error %d\n", ret, WSAGetLastError() );
+        }
+    }
+    if (winetest_debug > 1)
+        trace( "%u UDP datagrams received in %u ms\n", i, GetTickCount() - start );
+
+    /* the socket state still has to follow ioctlsocket and WSAEventSelect */
+    ret = ioctlsocket( echo, FIONBIO, &nonblocking );
+    ok( !ret, "ioctlsocket failed: %d\n", WSAGetLastError() );
+    ret = recvfrom( echo, buf, sizeof(buf), 0, NULL, NULL );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK,
+        "recvfrom returned %d, error %d\n", ret, WSAGetLastError() );
+
+    event = WSACreateEvent();
+    ret = WSAEventSelect( echo, event, FD_READ );
+    ok( !ret, "WSAEventSelect failed: %d\n", WSAGetLastError() );
+    ok( WaitForSingleObject( event, 0 ) == WAIT_TIMEOUT, "event is signaled\n" );
+    ret = sendto( s, buf, 32, 0, (struct sockaddr *)&echo_addr, sizeof(echo_addr) );
+    ok( ret == 32, "sendto returned %d, error %d\n", ret, WSAGetLastError() );
+    ok( !WaitForSingleObject( event, 1000 ), "event is not signaled\n" );
+    ret = recvfrom( echo, buf, sizeof(buf), 0, NULL, NULL );
+    ok( ret == 32, "recvfrom returned %d, error %d\n", ret, WSAGetLastError() );
+
+    WSACloseEvent( event );
+    closesocket( echo );
+    closesocket( s );
+}
+
+static void test_overlapped_UDP(void)
+{
+    struct sockaddr_in addr, dest_addr, from[4];
+    int fromlen[4], len, ret, i;
+    DWORD num_bytes, flags[4];
+    WSAOVERLAPPED ov[4], *povl;
+    char bufs[4][32], buf[32];
+    WSABUF wsabufs[4];
+    SOCKET s, dest;
+    ULONG_PTR key;
+    HANDLE port;
+    BOOL bret;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr( "127.0.0.1" );
+
+    dest = socket( AF_INET, SOCK_DGRAM, 0 );
+    ok( dest != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError() );
+    s = socket( AF_INET, SOCK_DGRAM, 0 );
+    ok( s != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError() );
+    do_bind( dest, (struct sockaddr *)&addr, sizeof(addr) );
+    do_bind( s, (struct sockaddr *)&addr, sizeof(addr) );
+    len = sizeof(dest_addr);
+    ret = getsockname( dest, (struct sockaddr *)&dest_addr, &len );
+    ok( !ret, "getsockname failed: %d\n", WSAGetLastError() );
+    len = sizeof(addr);
+    ret = getsockname( s, (struct sockaddr *)&addr, &len );
+    ok( !ret, "getsockname failed: %d\n", WSAGetLastError() );
+
+    port = CreateIoCompletionPort( (HANDLE)dest, NULL, 125, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError() );
+
+    /* queue several receives, they get the datagrams in order */
+    for (i = 0; i < 4; i++)
+    {
+        memset( &ov[i], 0, sizeof(ov[i]) );
+        memset( bufs[i], 0, sizeof(bufs[i]) );
+        wsabufs[i].len = sizeof(bufs[i]);
+        wsabufs[i].buf = bufs[i];
+        flags[i] = 0;
+        fromlen[i] = sizeof(from[i]);
+        ret = WSARecvFrom( dest, &wsabufs[i], 1, NULL, &flags[i], (struct sockaddr *)&from[i],
+                           &fromlen[i], &ov[i], NULL );
+        ok( ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+            "WSARecvFrom returned %d, error %d\n", ret, WSAGetLastError() );
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        sprintf( buf, "datagram %d", i );
+        ret = sendto( s, buf, strlen(buf) + 1, 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr) );
+        ok( ret == strlen(buf) + 1, "sendto returned %d, error %d\n", ret, WSAGetLastError() );
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        povl = NULL;
+        bret = GetQueuedCompletionStatus( port, &num_bytes, &key, &povl, 1000 );
+        ok( bret, "GetQueuedCompletionStatus failed: %u\n", GetLastError() );
+        ok( key == 125, "got key %lx\n", key );
+        ok( povl >= ov && povl < ov + 4, "got overlapped %p\n", povl );
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        sprintf( buf, "datagram %d", i );
+        bret = WSAGetOverlappedResult( dest, &ov[i], &num_bytes, FALSE, &flags[i] );
+        ok( bret, "%d: WSAGetOverlappedResult failed: %d\n", i, WSAGetLastError() );
+        ok( num_bytes == strlen(buf) + 1, "%d: got %u bytes\n", i, num_bytes );
+        ok( !strcmp( bufs[i], buf ), "%d: got %s\n", i, bufs[i] );
+        ok( fromlen[i] == sizeof(from[i]), "%d: got address length %d\n", i, fromlen[i] );
+        ok( from[i].sin_port == addr.sin_port, "%d: got port %u\n", i, ntohs(from[i].sin_port) );
+    }
+
+    closesocket( dest );
+    closesocket( s );
+    CloseHandle( port );
+}
+
 static DWORD WINAPI do_getservbyname( void *param )
 {
     struct {
@@ -2942,6 +3127,80 @@ static void test_WSADuplicateSocket(void)
     closesocket(source);
 }
 
+/* the blocking mode belongs to the socket, whichever handle it is changed through */
+static void test_duplicated_socket_state(void)
+{
+    struct sockaddr_in addr;
+    WSAPROTOCOL_INFOA info;
+    DWORD timeout = 100;
+    SOCKET s, dupsock, duphandle;
+    WSAEVENT event;
+    u_long arg;
+    char buf[32];
+    int ret;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr( "127.0.0.1" );
+
+    s = socket( AF_INET, SOCK_DGRAM, 0 );
+    ok( s != INVALID_SOCKET, "socket failed: %d\n", WSAGetLastError() );
+    do_bind( s, (struct sockaddr *)&addr, sizeof(addr) );
+    ret = setsockopt( s, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout) );
+    ok( !ret, "setsockopt failed: %d\n", WSAGetLastError() );
+
+    ret = recv( s, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+
+    ok( !WSADuplicateSocketA( s, GetCurrentProcessId(), &info ), "WSADuplicateSocketA failed\n" );
+    dupsock = WSASocketA( 0, 0, 0, &info, 0, 0 );
+    ok( dupsock != INVALID_SOCKET, "WSASocketA failed: %d\n", WSAGetLastError() );
+    ok( DuplicateHandle( GetCurrentProcess(), (HANDLE)s, GetCurrentProcess(), (HANDLE *)&duphandle,
+                         0, FALSE, DUPLICATE_SAME_ACCESS ), "DuplicateHandle failed: %u\n", GetLastError() );
+    ret = recv( duphandle, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+
+    arg = 1;
+    ret = ioctlsocket( dupsock, FIONBIO, &arg );
+    ok( !ret, "ioctlsocket failed: %d\n", WSAGetLastError() );
+    ret = recv( s, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+    ret = recv( duphandle, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+
+    arg = 0;
+    ret = ioctlsocket( dupsock, FIONBIO, &arg );
+    ok( !ret, "ioctlsocket failed: %d\n", WSAGetLastError() );
+    ret = recv( s, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+    ret = recv( duphandle, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+
+    /* WSAEventSelect makes the socket nonblocking, and the recv calls above must not
+     * have left a stale FD_READ behind */
+    event = WSACreateEvent();
+    ret = WSAEventSelect( duphandle, event, FD_READ );
+    ok( !ret, "WSAEventSelect failed: %d\n", WSAGetLastError() );
+    ok( WaitForSingleObject( event, 0 ) == WAIT_TIMEOUT, "event is signaled\n" );
+    ret = recv( s, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+    ret = recv( dupsock, buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK,
+        "recv returned %d, error %d\n", ret, WSAGetLastError() );
+
+    WSACloseEvent( event );
+    closesocket( duphandle );
+    closesocket( dupsock );
+    closesocket( s );
+}
+
 static void test_WSAEnumNetworkEvents(void)
 {
     SOCKET s, s2;
@@ -11463,6 +11722,7 @@ START_TEST( sock )
     test_getservbyname();
     test_WSASocket();
     test_WSADuplicateSocket();
+    test_duplicated_socket_state();
     test_WSAEnumNetworkEvents();
 
     test_WSAAddressToStringA();
@@ -11520,6 +11780,8 @@ START_TEST( sock )
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
     test_synchronous_WSAIoctl();
+    test_UDP_performance();
+    test_overlapped_UDP();
 
     Exit();
 }
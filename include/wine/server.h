@@ -50,9 +50,11 @@ struct __server_request_info
 };
 
 extern unsigned int wine_server_call( void *req_ptr );
+extern unsigned int CDECL wine_server_call_batch( void **reqs, unsigned int count );
 extern void CDECL wine_server_send_fd( int fd );
 extern int CDECL wine_server_fd_to_handle( int fd, unsigned int access, unsigned int attributes, HANDLE *handle );
 extern int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *unix_fd, unsigned int *options );
+extern void CDECL wine_server_prefetch_fds( const HANDLE *handles, unsigned int count );
 extern void CDECL wine_server_release_fd( HANDLE handle, int unix_fd );
 
 /* do a server call and set the last error code */
@@ -138,5 +140,12 @@ static inline void *wine_server_get_ptr( client_ptr_t ptr )
         while(0); \
     } while(0)
 
+/* initialize a request to be sent with wine_server_call_batch, and return its typed pointer */
+#define SERVER_INIT_BATCH_REQ(info,type) \
+    (memset( &(info)->u.req, 0, sizeof((info)->u.req) ), \
+     (info)->u.req.request_header.req = REQ_##type, \
+     (info)->data_count = 0, \
+     &(info)->u.req.type##_request)
+
 
 #endif  /* __WINE_WINE_SERVER_H */
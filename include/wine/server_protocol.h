@@ -263,6 +263,25 @@ typedef struct
 } async_data_t;
 
 
+typedef struct
+{
+    client_ptr_t    user;
+    apc_param_t     total;
+    unsigned int    status;
+    int             __pad;
+} async_result_t;
+
+
+typedef struct
+{
+    apc_param_t     ckey;
+    apc_param_t     cvalue;
+    apc_param_t     information;
+    unsigned int    status;
+    int             __pad;
+} completion_msg_t;
+
+
 
 struct hardware_msg_data
 {
@@ -716,6 +735,53 @@ struct rawinput_device
 };
 
 
+struct fast_sync_slot
+{
+    __int64        state;
+    int            seq;
+    int            waiters;
+    int            type;
+    unsigned int   max;
+};
+#define FAST_SYNC_NONE          0
+#define FAST_SYNC_AUTO_EVENT    1
+#define FAST_SYNC_MANUAL_EVENT  2
+#define FAST_SYNC_SEMAPHORE     3
+#define FAST_SYNC_MUTEX         4
+
+
+
+#define FAST_SYNC_MUTEX_COUNT_SHIFT 32
+#define FAST_SYNC_MUTEX_COUNT_MAX   0x3fffffff
+
+#define FAST_SYNC_DEMOTED           ((__int64)1 << 62)
+
+
+struct queue_shm
+{
+    int            seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   __pad[3];
+};
+
+
+struct socket_shm
+{
+    int              seq;
+    unsigned int     state;
+    unsigned int     events;
+    unsigned int     __pad;
+    unsigned __int64 ino;
+};
+
+
+
+#define REQUEST_SHM_SIZE 0x10000
+
+
 
 
 
@@ -1417,6 +1483,36 @@ struct open_semaphore_reply
 
 
 
+struct get_fast_sync_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fast_sync_shm_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
+
+struct get_fast_sync_obj_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_fast_sync_obj_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    int          type;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -1720,6 +1816,22 @@ struct enable_socket_event_reply
     struct reply_header __header;
 };
 
+
+
+struct get_socket_shm_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_socket_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t shm_handle;
+    data_size_t  size;
+    unsigned int index;
+    char __pad_20[4];
+};
+
 struct set_socket_deferred_request
 {
     struct request_header __header;
@@ -2984,6 +3096,22 @@ struct get_msg_queue_reply
 
 
 
+struct get_queue_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_queue_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    data_size_t  size;
+    unsigned int index;
+    char __pad_20[4];
+};
+
+
+
 struct set_queue_fd_request
 {
     struct request_header __header;
@@ -3292,6 +3420,22 @@ struct cancel_async_reply
 
 
 
+struct complete_asyncs_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    /* VARARG(results,async_results); */
+};
+struct complete_asyncs_reply
+{
+    struct reply_header __header;
+    unsigned int   completed;
+    char __pad_12[4];
+};
+#define MAX_COMPLETE_ASYNCS 32
+
+
+
 struct get_async_result_request
 {
     struct request_header __header;
@@ -3403,6 +3547,7 @@ struct create_named_pipe_reply
 #define NAMED_PIPE_MESSAGE_STREAM_WRITE 0x0001
 #define NAMED_PIPE_MESSAGE_STREAM_READ  0x0002
 #define NAMED_PIPE_NONBLOCKING_MODE     0x0004
+#define NAMED_PIPE_DIRECT               0x0008  /* byte mode data goes through a socketpair */
 #define NAMED_PIPE_SERVER_END           0x8000
 
 
@@ -5312,6 +5457,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5618,6 +5776,34 @@ struct terminate_job_reply
 };
 
 
+
+struct batch_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_reply
+{
+    struct reply_header __header;
+    /* VARARG(replies,bytes); */
+};
+
+
+
+struct get_request_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_request_shm_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5661,6 +5847,8 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_fast_sync_shm,
+    REQ_get_fast_sync_obj,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5679,6 +5867,7 @@ enum request
     REQ_get_socket_event,
     REQ_get_socket_info,
     REQ_enable_socket_event,
+    REQ_get_socket_shm,
     REQ_set_socket_deferred,
     REQ_alloc_console,
     REQ_free_console,
@@ -5752,6 +5941,7 @@ enum request
     REQ_empty_atom_table,
     REQ_init_atom_table,
     REQ_get_msg_queue,
+    REQ_get_queue_shm,
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
@@ -5770,6 +5960,7 @@ enum request
     REQ_set_serial_info,
     REQ_register_async,
     REQ_cancel_async,
+    REQ_complete_asyncs,
     REQ_get_async_result,
     REQ_read,
     REQ_write,
@@ -5889,6 +6080,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5909,6 +6101,8 @@ enum request
     REQ_set_job_limits,
     REQ_set_job_completion_port,
     REQ_terminate_job,
+    REQ_batch,
+    REQ_get_request_shm,
     REQ_NB_REQUESTS
 };
 
@@ -5957,6 +6151,8 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_fast_sync_shm_request get_fast_sync_shm_request;
+    struct get_fast_sync_obj_request get_fast_sync_obj_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -5975,6 +6171,7 @@ union generic_request
     struct get_socket_event_request get_socket_event_request;
     struct get_socket_info_request get_socket_info_request;
     struct enable_socket_event_request enable_socket_event_request;
+    struct get_socket_shm_request get_socket_shm_request;
     struct set_socket_deferred_request set_socket_deferred_request;
     struct alloc_console_request alloc_console_request;
     struct free_console_request free_console_request;
@@ -6048,6 +6245,7 @@ union generic_request
     struct empty_atom_table_request empty_atom_table_request;
     struct init_atom_table_request init_atom_table_request;
     struct get_msg_queue_request get_msg_queue_request;
+    struct get_queue_shm_request get_queue_shm_request;
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
@@ -6066,6 +6264,7 @@ union generic_request
     struct set_serial_info_request set_serial_info_request;
     struct register_async_request register_async_request;
     struct cancel_async_request cancel_async_request;
+    struct complete_asyncs_request complete_asyncs_request;
     struct get_async_result_request get_async_result_request;
     struct read_request read_request;
     struct write_request write_request;
@@ -6185,6 +6384,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6205,6 +6405,8 @@ union generic_request
     struct set_job_limits_request set_job_limits_request;
     struct set_job_completion_port_request set_job_completion_port_request;
     struct terminate_job_request terminate_job_request;
+    struct batch_request batch_request;
+    struct get_request_shm_request get_request_shm_request;
 };
 union generic_reply
 {
@@ -6251,6 +6453,8 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_fast_sync_shm_reply get_fast_sync_shm_reply;
+    struct get_fast_sync_obj_reply get_fast_sync_obj_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6269,6 +6473,7 @@ union generic_reply
     struct get_socket_event_reply get_socket_event_reply;
     struct get_socket_info_reply get_socket_info_reply;
     struct enable_socket_event_reply enable_socket_event_reply;
+    struct get_socket_shm_reply get_socket_shm_reply;
     struct set_socket_deferred_reply set_socket_deferred_reply;
     struct alloc_console_reply alloc_console_reply;
     struct free_console_reply free_console_reply;
@@ -6342,6 +6547,7 @@ union generic_reply
     struct empty_atom_table_reply empty_atom_table_reply;
     struct init_atom_table_reply init_atom_table_reply;
     struct get_msg_queue_reply get_msg_queue_reply;
+    struct get_queue_shm_reply get_queue_shm_reply;
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
@@ -6360,6 +6566,7 @@ union generic_reply
     struct set_serial_info_reply set_serial_info_reply;
     struct register_async_reply register_async_reply;
     struct cancel_async_reply cancel_async_reply;
+    struct complete_asyncs_reply complete_asyncs_reply;
     struct get_async_result_reply get_async_result_reply;
     struct read_reply read_reply;
     struct write_reply write_reply;
@@ -6479,6 +6686,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6499,8 +6707,10 @@ union generic_reply
     struct set_job_limits_reply set_job_limits_reply;
     struct set_job_completion_port_reply set_job_completion_port_reply;
     struct terminate_job_reply terminate_job_reply;
+    struct batch_reply batch_reply;
+    struct get_request_shm_reply get_request_shm_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 548
+#define SERVER_PROTOCOL_VERSION 556
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -535,6 +535,45 @@ DECL_HANDLER(cancel_async)
     }
 }
 
+/* complete a pending async whose I/O has already been done by the client */
+static int complete_async( struct process *process, struct object *obj, const async_result_t *result )
+{
+    struct async *async;
+
+    LIST_FOR_EACH_ENTRY( async, &process->asyncs, struct async, process_entry )
+    {
+        if (async->data.user != result->user || !async->fd || get_fd_user( async->fd ) != obj) continue;
+
+        if (async->status != STATUS_PENDING)
+        {
+            /* the client callback is already queued or running; if it tries to restart
+             * the async, make it terminate instead so that the client reports the result */
+            if (async->status == STATUS_ALERTED) async->status = result->status;
+            return 0;
+        }
+        async->status = result->status;
+        if (async->iosb && async->iosb->status == STATUS_PENDING) async->iosb->status = result->status;
+        async_set_result( &async->obj, result->status, result->total );
+        async_reselect( async );
+        if (async->queue) release_object( async );
+        return 1;
+    }
+    return 0;
+}
+
+/* complete pending asyncs with the results of I/O done on the client side */
+DECL_HANDLER(complete_asyncs)
+{
+    const async_result_t *results = get_req_data();
+    data_size_t i, count = min( get_req_data_size() / sizeof(*results), MAX_COMPLETE_ASYNCS );
+    struct object *obj = get_handle_obj( current->process, req->handle, 0, NULL );
+
+    if (!obj) return;
+    for (i = 0; i < count; i++)
+        if (complete_async( current->process, obj, &results[i] )) reply->completed |= 1 << i;
+    release_object( obj );
+}
+
 /* get async result from associated iosb */
 DECL_HANDLER(get_async_result)
 {
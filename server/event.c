@@ -41,21 +41,24 @@ struct event
     struct object  obj;             /* object header */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    int            fast_sync;       /* index of the fast sync slot, -1 if none */
 };
 
 static void event_dump( struct object *obj, int verbose );
 static struct object_type *event_get_type( struct object *obj );
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int event_map_access( struct object *obj, unsigned int access );
 static int event_signal( struct object *obj, unsigned int access);
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
     sizeof(struct event),      /* size */
     event_dump,                /* dump */
     event_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
+    event_add_queue,           /* add_queue */
     remove_queue,              /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
@@ -69,7 +72,7 @@ static const struct object_ops event_ops =
     default_unlink_name,       /* unlink_name */
     no_open_file,              /* open_file */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -119,6 +122,7 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            event->fast_sync    = -1;
         }
     }
     return event;
@@ -129,8 +133,24 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+int get_event_fast_sync( struct object *obj )
+{
+    if (obj->ops != &event_ops) return -1;
+    return ((struct event *)obj)->fast_sync;
+}
+
+/* retrieve the state of a client-side event before the server uses it */
+static void event_demote( struct event *event )
+{
+    __int64 state;
+
+    if (event->fast_sync != -1 && demote_fast_sync( event->fast_sync, &state ))
+        event->signaled = state & 1;
+}
+
 void pulse_event( struct event *event )
 {
+    event_demote( event );
     event->signaled = 1;
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
@@ -139,6 +159,7 @@ void pulse_event( struct event *event )
 
 void set_event( struct event *event )
 {
+    event_demote( event );
     event->signaled = 1;
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
@@ -146,6 +167,7 @@ void set_event( struct event *event )
 
 void reset_event( struct event *event )
 {
+    event_demote( event );
     event->signaled = 0;
 }
 
@@ -164,6 +186,14 @@ static struct object_type *event_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    event_demote( event );
+    return add_queue( obj, entry );
+}
+
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
@@ -202,6 +232,13 @@ static int event_signal( struct object *obj, unsigned int access )
     return 1;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->fast_sync != -1) free_fast_sync( event->fast_sync );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -288,8 +325,15 @@ DECL_HANDLER(create_event)
         if (get_error() == STATUS_OBJECT_NAME_EXISTS)
             reply->handle = alloc_handle( current->process, event, req->access, objattr->attributes );
         else
+        {
+            /* unnamed events can be handled on the client side */
+            if (!name.len)
+                event->fast_sync = alloc_fast_sync( event->manual_reset ? FAST_SYNC_MANUAL_EVENT
+                                                                        : FAST_SYNC_AUTO_EVENT,
+                                                    event->signaled, 0 );
             reply->handle = alloc_handle_no_access_check( current->process, event,
                                                           req->access, objattr->attributes );
+        }
         release_object( event );
     }
 
@@ -336,6 +380,7 @@ DECL_HANDLER(query_event)
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
+    event_demote( event );
     reply->manual_reset = event->manual_reset;
     reply->state = event->signaled;
 
@@ -0,0 +1,202 @@
+/*
+ * Server-side support for fast synchronization objects
+ *
+ * Unnamed events, mutexes and semaphores can keep their state in a
+ * shared memory slot that clients manipulate directly, using futexes
+ * to wait. As soon as the server needs to look at the state (mixed
+ * waits, server-side signaling, etc.) it takes over the object by
+ * "demoting" it, and from then on clients go through normal requests.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "thread.h"
+#include "request.h"
+
+#define FAST_SYNC_SLOTS  16384
+
+static int shm_fd = -1;                       /* fd of the shared memory file */
+static struct fast_sync_slot *slots;          /* shared memory slots */
+static unsigned int used_slots;               /* number of slots used so far */
+static int free_slot = -1;                    /* head of the free slots list */
+static int next_free_slot[FAST_SYNC_SLOTS];   /* free slots list */
+
+/* fast synchronization needs futexes, and is only enabled on request */
+static int fast_sync_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+#if defined(__linux__) && defined(HAVE_SYS_MMAN_H)
+        const char *env = getenv( "WINEFASTSYNC" );
+        enabled = env && atoi( env );
+#else
+        enabled = 0;
+#endif
+    }
+    return enabled;
+}
+
+/* create the shared memory on first use */
+static int init_fast_sync_shm(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    void *ptr;
+
+    if (slots) return 1;
+    if (shm_fd != -1 || !fast_sync_enabled()) return 0;  /* already failed */
+
+    if ((shm_fd = create_temp_file( FAST_SYNC_SLOTS * sizeof(*slots) )) == -1) return 0;
+    ptr = mmap( NULL, FAST_SYNC_SLOTS * sizeof(*slots), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map fast sync memory, disabling fast sync\n" );
+        return 0;
+    }
+    slots = ptr;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* bump the sequence count and wake up all the client threads waiting on a slot */
+static void wake_fast_sync( struct fast_sync_slot *slot )
+{
+    interlocked_xchg_add( &slot->seq, 1 );
+#ifdef __linux__
+    if (slot->waiters) syscall( __NR_futex, &slot->seq, 1 /* FUTEX_WAKE */, INT_MAX, NULL, 0, 0 );
+#endif
+}
+
+/* allocate a shared memory slot, return -1 if none is available */
+int alloc_fast_sync( int type, __int64 state, unsigned int max )
+{
+    struct fast_sync_slot *slot;
+    int index;
+
+    if (!init_fast_sync_shm()) return -1;
+
+    if (free_slot != -1)
+    {
+        index = free_slot;
+        free_slot = next_free_slot[index];
+    }
+    else if (used_slots < FAST_SYNC_SLOTS) index = used_slots++;
+    else return -1;
+
+    slot = &slots[index];
+    slot->type  = type;
+    slot->max   = max;
+    slot->state = state;
+    return index;
+}
+
+/* free a shared memory slot when its object is destroyed */
+void free_fast_sync( int index )
+{
+    struct fast_sync_slot *slot = &slots[index];
+
+    slot->type  = FAST_SYNC_NONE;
+    slot->max   = 0;
+    slot->state = FAST_SYNC_DEMOTED;
+    wake_fast_sync( slot );
+    next_free_slot[index] = free_slot;
+    free_slot = index;
+}
+
+/* return the current state of a slot, without taking it over */
+__int64 get_fast_sync_state( int index )
+{
+    return slots[index].state;
+}
+
+/* take over the state of an object, clients have to use requests afterwards */
+/* return 0 if the object has already been demoted, otherwise store its last state */
+int demote_fast_sync( int index, __int64 *state )
+{
+    struct fast_sync_slot *slot = &slots[index];
+    __int64 old, prev = slot->state;
+
+    do
+    {
+        old = prev;
+        if (old & FAST_SYNC_DEMOTED) return 0;
+    } while ((prev = interlocked_cmpxchg64( &slot->state, old | FAST_SYNC_DEMOTED, old )) != old);
+
+    /* wake up client threads so that they retry their wait through the server */
+    wake_fast_sync( slot );
+    *state = old;
+    return 1;
+}
+
+/* map the shared memory of fast synchronization objects in the client */
+DECL_HANDLER(get_fast_sync_shm)
+{
+    if (!init_fast_sync_shm())
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    reply->size = FAST_SYNC_SLOTS * sizeof(*slots);
+    send_client_fd( current->process, shm_fd, 0 );
+}
+
+/* get the slot used by an object that is still handled on the client side */
+DECL_HANDLER(get_fast_sync_obj)
+{
+    struct object *obj;
+    int index;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if ((index = get_event_fast_sync( obj )) == -1 &&
+        (index = get_mutex_fast_sync( obj )) == -1)
+        index = get_semaphore_fast_sync( obj );
+
+    if (index != -1 && !(slots[index].state & FAST_SYNC_DEMOTED))
+    {
+        reply->index  = index;
+        reply->type   = slots[index].type;
+        reply->access = get_handle_access( current->process, req->handle );
+    }
+    else set_error( STATUS_NOT_IMPLEMENTED );
+
+    release_object( obj );
+}
@@ -43,10 +43,13 @@ struct mutex
     unsigned int   count;           /* recursion count */
     int            abandoned;       /* has it been abandoned? */
     struct list    entry;           /* entry in owner thread mutex list */
+    int            fast_sync;       /* index of the fast sync slot, -1 if none */
+    struct list    fast_entry;      /* entry in client-side mutexes list */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
 static struct object_type *mutex_get_type( struct object *obj );
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int mutex_map_access( struct object *obj, unsigned int access );
@@ -58,7 +61,7 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     mutex_dump,                /* dump */
     mutex_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
+    mutex_add_queue,           /* add_queue */
     remove_queue,              /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
@@ -75,6 +78,9 @@ static const struct object_ops mutex_ops =
     mutex_destroy              /* destroy */
 };
 
+/* mutexes whose state is still handled on the client side */
+static struct list fast_mutexes = LIST_INIT( fast_mutexes );
+
 
 /* grab a mutex for a given thread */
 static void do_grab( struct mutex *mutex, struct thread *thread )
@@ -112,16 +118,62 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
+            mutex->fast_sync = -1;
+            list_init( &mutex->fast_entry );
             if (owned) do_grab( mutex, current );
         }
     }
     return mutex;
 }
 
+int get_mutex_fast_sync( struct object *obj )
+{
+    if (obj->ops != &mutex_ops) return -1;
+    return ((struct mutex *)obj)->fast_sync;
+}
+
+/* retrieve the state of a client-side mutex before the server uses it */
+static void mutex_demote( struct mutex *mutex )
+{
+    unsigned int error = get_error();
+    struct thread *owner;
+    __int64 state;
+
+    if (mutex->fast_sync == -1 || !demote_fast_sync( mutex->fast_sync, &state )) return;
+
+    list_remove( &mutex->fast_entry );
+    list_init( &mutex->fast_entry );
+    if (!(mutex->count = (state >> FAST_SYNC_MUTEX_COUNT_SHIFT) & FAST_SYNC_MUTEX_COUNT_MAX)) return;
+
+    if ((owner = get_thread_from_id( (thread_id_t)state )))
+    {
+        if (owner->state != TERMINATED)
+        {
+            mutex->owner = owner;
+            list_add_head( &owner->mutex_list, &mutex->entry );
+        }
+        release_object( owner );
+    }
+    set_error( error );  /* get_thread_from_id may have set it */
+
+    if (!mutex->owner)  /* the owner is gone */
+    {
+        mutex->count = 0;
+        mutex->abandoned = 1;
+    }
+}
+
 void abandon_mutexes( struct thread *thread )
 {
+    struct mutex *mutex, *next;
     struct list *ptr;
 
+    LIST_FOR_EACH_ENTRY_SAFE( mutex, next, &fast_mutexes, struct mutex, fast_entry )
+    {
+        if ((thread_id_t)get_fast_sync_state( mutex->fast_sync ) == thread->id)
+            mutex_demote( mutex );
+    }
+
     while ((ptr = list_head( &thread->mutex_list )) != NULL)
     {
         struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
@@ -146,6 +198,14 @@ static struct object_type *mutex_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    mutex_demote( mutex );
+    return add_queue( obj, entry );
+}
+
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
@@ -182,6 +242,7 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
+    mutex_demote( mutex );
     if (!mutex->count || (mutex->owner != current))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
@@ -196,6 +257,11 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->fast_sync != -1)
+    {
+        list_remove( &mutex->fast_entry );
+        free_fast_sync( mutex->fast_sync );
+    }
     if (!mutex->count) return;
     mutex->count = 0;
     do_release( mutex );
@@ -217,8 +283,23 @@ DECL_HANDLER(create_mutex)
         if (get_error() == STATUS_OBJECT_NAME_EXISTS)
             reply->handle = alloc_handle( current->process, mutex, req->access, objattr->attributes );
         else
+        {
+            /* unnamed mutexes can be handled on the client side */
+            __int64 state = mutex->count ? current->id | ((__int64)1 << FAST_SYNC_MUTEX_COUNT_SHIFT) : 0;
+
+            if (!name.len && (mutex->fast_sync = alloc_fast_sync( FAST_SYNC_MUTEX, state, 0 )) != -1)
+            {
+                if (mutex->count)  /* the initial ownership is now in the shared state */
+                {
+                    mutex->count = 0;
+                    mutex->owner = NULL;
+                    list_remove( &mutex->entry );
+                }
+                list_add_tail( &fast_mutexes, &mutex->fast_entry );
+            }
             reply->handle = alloc_handle_no_access_check( current->process, mutex,
                                                           req->access, objattr->attributes );
+        }
         release_object( mutex );
     }
 
@@ -242,6 +323,7 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
+        mutex_demote( mutex );
         if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
@@ -260,6 +342,7 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
+        mutex_demote( mutex );
         reply->count = mutex->count;
         reply->owned = (mutex->owner == current);
         reply->abandoned = mutex->abandoned;
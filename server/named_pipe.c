@@ -24,10 +24,22 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_FILIO_H
+#include <sys/filio.h>
+#endif
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -67,6 +79,7 @@ struct pipe_end
     unsigned int         flags;      /* pipe flags */
     struct pipe_end     *connection; /* the other end of the pipe */
     data_size_t          buffer_size;/* size of buffered data that doesn't block caller */
+    int                  direct;     /* data goes through a socketpair shared with the other end */
     struct list          message_queue;
     struct async_queue   read_q;     /* read queue */
     struct async_queue   write_q;    /* write queue */
@@ -194,6 +207,22 @@ static const struct fd_ops pipe_server_fd_ops =
     pipe_end_reselect_async       /* reselect_async */
 };
 
+/* server end of a pipe whose data is read and written directly by the clients */
+static const struct fd_ops pipe_server_direct_fd_ops =
+{
+    default_fd_get_poll_events,   /* get_poll_events */
+    default_poll_event,           /* poll_event */
+    pipe_end_get_fd_type,         /* get_fd_type */
+    no_fd_read,                   /* read */
+    no_fd_write,                  /* write */
+    pipe_end_flush,               /* flush */
+    pipe_server_get_file_info,    /* get_file_info */
+    pipe_end_get_volume_info,     /* get_volume_info */
+    pipe_server_ioctl,            /* ioctl */
+    default_fd_queue_async,       /* queue_async */
+    default_fd_reselect_async     /* reselect_async */
+};
+
 /* client end functions */
 static void pipe_client_dump( struct object *obj, int verbose );
 static struct security_descriptor *pipe_client_get_sd( struct object *obj );
@@ -240,6 +269,22 @@ static const struct fd_ops pipe_client_fd_ops =
     pipe_end_reselect_async       /* reselect_async */
 };
 
+/* client end of a pipe whose data is read and written directly by the clients */
+static const struct fd_ops pipe_client_direct_fd_ops =
+{
+    default_fd_get_poll_events,   /* get_poll_events */
+    default_poll_event,           /* poll_event */
+    pipe_end_get_fd_type,         /* get_fd_type */
+    no_fd_read,                   /* read */
+    no_fd_write,                  /* write */
+    pipe_end_flush,               /* flush */
+    pipe_client_get_file_info,    /* get_file_info */
+    pipe_end_get_volume_info,     /* get_volume_info */
+    pipe_client_ioctl,            /* ioctl */
+    default_fd_queue_async,       /* queue_async */
+    default_fd_reselect_async     /* reselect_async */
+};
+
 static void named_pipe_device_dump( struct object *obj, int verbose );
 static struct object_type *named_pipe_device_get_type( struct object *obj );
 static struct fd *named_pipe_device_get_fd( struct object *obj );
@@ -847,6 +892,40 @@ static enum server_fd_type pipe_end_get_fd_type( struct fd *fd )
     return FD_TYPE_PIPE;
 }
 
+/* peek at the data waiting in the socket of a direct pipe end */
+static int pipe_end_direct_peek( struct pipe_end *pipe_end, data_size_t reply_size )
+{
+    FILE_PIPE_PEEK_BUFFER *buffer;
+    char *data = NULL;
+    int unix_fd, avail = 0, ret = 0;
+
+    if ((unix_fd = get_unix_fd( pipe_end->fd )) == -1) return 0;
+    if (ioctl( unix_fd, FIONREAD, &avail ) == -1) avail = 0;
+    if (!avail && !pipe_end->connection)
+    {
+        set_error( STATUS_PIPE_BROKEN );
+        return 0;
+    }
+
+    /* the other process may be reading at the same time, so the data can be shorter than avail */
+    reply_size = min( reply_size, avail );
+    if (reply_size)
+    {
+        if (!(data = mem_alloc( reply_size ))) return 0;
+        if ((ret = recv( unix_fd, data, reply_size, MSG_PEEK | MSG_DONTWAIT )) < 0) ret = 0;
+    }
+    if ((buffer = set_reply_data_size( offsetof( FILE_PIPE_PEEK_BUFFER, Data[ret] ))) && ret)
+        memcpy( buffer->Data, data, ret );
+    free( data );
+    if (!buffer) return 0;
+
+    buffer->NamedPipeState    = 0;  /* FIXME */
+    buffer->ReadDataAvailable = avail;
+    buffer->NumberOfMessages  = 0;
+    buffer->MessageLength     = 0;
+    return 1;
+}
+
 static int pipe_end_peek( struct pipe_end *pipe_end )
 {
     unsigned reply_size = get_reply_max_size();
@@ -862,6 +941,8 @@ static int pipe_end_peek( struct pipe_end *pipe_end )
     }
     reply_size -= offsetof( FILE_PIPE_PEEK_BUFFER, Data );
 
+    if (pipe_end->direct) return pipe_end_direct_peek( pipe_end, reply_size );
+
     if (!pipe_end->connection && list_empty( &pipe_end->message_queue ))
     {
         set_error( STATUS_PIPE_BROKEN );
@@ -955,6 +1036,72 @@ static int pipe_end_ioctl( struct pipe_end *pipe_end, ioctl_code_t code, struct
     }
 }
 
+/* let the two ends of a newly connected byte mode pipe exchange data through a socketpair,
+ * if the process that created the pipe asked for it; message mode pipes, and so the RPC
+ * transport, still go through the message queue, since the message boundaries can't be
+ * kept on a stream socket */
+static void connect_direct_pipe( struct pipe_server *server, struct pipe_client *client,
+                                 unsigned int options )
+{
+#ifdef HAVE_SYS_SOCKET_H
+    struct fd *server_fd, *client_fd;
+    int fds[2];
+
+    if (!(server->pipe->flags & NAMED_PIPE_DIRECT)) return;
+    if (server->pipe->flags & NAMED_PIPE_MESSAGE_STREAM_WRITE) return;  /* message framing is done here */
+
+    if (socketpair( PF_UNIX, SOCK_STREAM, 0, fds ) == -1) return;
+    fcntl( fds[0], F_SETFL, O_NONBLOCK );
+    fcntl( fds[1], F_SETFL, O_NONBLOCK );
+
+    if (!(server_fd = create_anonymous_fd( &pipe_server_direct_fd_ops, fds[0], &server->pipe_end.obj,
+                                           server->options )))
+    {
+        close( fds[1] );
+        return;
+    }
+    if (!(client_fd = create_anonymous_fd( &pipe_client_direct_fd_ops, fds[1], &client->pipe_end.obj,
+                                           options )))
+    {
+        release_object( server_fd );
+        return;
+    }
+    fd_copy_completion( server->pipe_end.fd, server_fd );
+    set_fd_signaled( server_fd, is_fd_signaled( server->pipe_end.fd ));
+    allow_fd_caching( server_fd );
+    allow_fd_caching( client_fd );
+
+    release_object( server->pipe_end.fd );
+    release_object( client->pipe_end.fd );
+    server->pipe_end.fd = server_fd;
+    client->pipe_end.fd = client_fd;
+    server->pipe_end.direct = client->pipe_end.direct = 1;
+    clear_error();
+#endif
+}
+
+/* shut down the socketpair of a server end, it gets a new one on the next connection */
+static int disconnect_direct_pipe( struct pipe_server *server )
+{
+#ifdef HAVE_SYS_SOCKET_H
+    struct fd *fd;
+
+    if (!server->pipe_end.direct) return 1;
+    if (!(fd = alloc_pseudo_fd( &pipe_server_fd_ops, &server->pipe_end.obj, server->options ))) return 0;
+
+    /* the client end is cached by its process, make sure it sees the disconnection */
+    shutdown( get_unix_fd( server->pipe_end.fd ), SHUT_RDWR );
+    fd_async_wake_up( server->pipe_end.fd, ASYNC_TYPE_READ, STATUS_PIPE_DISCONNECTED );
+    fd_async_wake_up( server->pipe_end.fd, ASYNC_TYPE_WRITE, STATUS_PIPE_DISCONNECTED );
+    fd_copy_completion( server->pipe_end.fd, fd );
+    set_fd_signaled( fd, 0 );
+    release_object( server->pipe_end.fd );
+    server->pipe_end.fd = fd;
+    server->pipe_end.direct = 0;
+#endif
+    return 1;
+}
+
 static int pipe_server_ioctl( struct fd *fd, ioctl_code_t code, struct async *async )
 {
     struct pipe_server *server = get_fd_user( fd );
@@ -993,11 +1140,13 @@ static int pipe_server_ioctl( struct fd *fd, ioctl_code_t code, struct async *as
             pipe_end_disconnect( &server->pipe_end, STATUS_PIPE_DISCONNECTED );
             server->client->server = NULL;
             server->client = NULL;
+            if (!disconnect_direct_pipe( server )) return 0;
             set_server_state( server, ps_wait_connect );
             break;
         case ps_wait_disconnect:
             assert( !server->client );
             pipe_end_disconnect( &server->pipe_end, STATUS_PIPE_DISCONNECTED );
+            if (!disconnect_direct_pipe( server )) return 0;
             set_server_state( server, ps_wait_connect );
             break;
         case ps_idle_server:
@@ -1044,6 +1193,7 @@ static void init_pipe_end( struct pipe_end *pipe_end, unsigned int pipe_flags, d
     pipe_end->flags = pipe_flags;
     pipe_end->connection = NULL;
     pipe_end->buffer_size = buffer_size;
+    pipe_end->direct = 0;
     init_async_queue( &pipe_end->read_q );
     init_async_queue( &pipe_end->write_q );
     list_init( &pipe_end->message_queue );
@@ -1169,6 +1319,7 @@ static struct object *named_pipe_open_file( struct object *obj, unsigned int acc
         client->server = server;
         server->pipe_end.connection = &client->pipe_end;
         client->pipe_end.connection = &server->pipe_end;
+        connect_direct_pipe( server, client, options );
     }
     release_object( server );
     return &client->pipe_end.obj;
@@ -1264,7 +1415,7 @@ DECL_HANDLER(create_named_pipe)
         pipe->outsize = req->outsize;
         pipe->maxinstances = req->maxinstances;
         pipe->timeout = req->timeout;
-        pipe->flags = req->flags & NAMED_PIPE_MESSAGE_STREAM_WRITE;
+        pipe->flags = req->flags & (NAMED_PIPE_MESSAGE_STREAM_WRITE | NAMED_PIPE_DIRECT);
         pipe->sharing = req->sharing;
         if (sd) default_set_sd( &pipe->obj, sd, OWNER_SECURITY_INFORMATION |
                                                 GROUP_SECURITY_INFORMATION |
@@ -185,10 +185,23 @@ extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_han
 extern void pulse_event( struct event *event );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern int get_event_fast_sync( struct object *obj );
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern int get_mutex_fast_sync( struct object *obj );
+
+/* semaphore functions */
+
+extern int get_semaphore_fast_sync( struct object *obj );
+
+/* fast synchronization functions */
+
+extern int alloc_fast_sync( int type, __int64 state, unsigned int max );
+extern void free_fast_sync( int index );
+extern __int64 get_fast_sync_state( int index );
+extern int demote_fast_sync( int index, __int64 *state );
 
 /* serial functions */
 
@@ -28,6 +28,9 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -140,6 +143,7 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    int                    shm_index;       /* index of the shared memory slot, -1 if none */
 };
 
 struct hotkey
@@ -267,6 +271,113 @@ static struct thread_input *create_thread_input( struct thread *thread )
     }
     return input;
 }
+#define QUEUE_SHM_SLOTS  16384
+
+static struct queue_shm *queue_shm;                   /* shared memory slots */
+static struct file *queue_shm_file;                   /* file object of the shared memory */
+static unsigned int queue_shm_used;                   /* number of slots used so far */
+static int queue_shm_free = -1;                       /* head of the free slots list */
+static int queue_shm_next_free[QUEUE_SHM_SLOTS];      /* free slots list */
+
+/* publishing the queue status in shared memory can be disabled with WINEQUEUESHM=0 */
+static int queue_shm_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+#ifdef HAVE_SYS_MMAN_H
+        const char *env = getenv( "WINEQUEUESHM" );
+        enabled = !env || atoi( env );
+#else
+        enabled = 0;
+#endif
+    }
+    return enabled;
+}
+
+/* create the shared memory on first use */
+static int init_queue_shm(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    static int failed;
+    void *ptr;
+    int fd;
+
+    if (queue_shm) return 1;
+    if (failed || !queue_shm_enabled()) return 0;
+    failed = 1;
+
+    if ((fd = create_temp_file( QUEUE_SHM_SLOTS * sizeof(*queue_shm) )) == -1) return 0;
+    ptr = mmap( NULL, QUEUE_SHM_SLOTS * sizeof(*queue_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map queue shared memory, disabling it\n" );
+        close( fd );
+        return 0;
+    }
+    if (!(queue_shm_file = create_file_for_fd( fd, FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE )))
+    {
+        munmap( ptr, QUEUE_SHM_SLOTS * sizeof(*queue_shm) );
+        return 0;
+    }
+    make_object_static( (struct object *)queue_shm_file );
+    queue_shm = ptr;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* publish the current status of a queue in its shared memory slot */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    struct queue_shm *shm;
+
+    if (queue->shm_index == -1) return;
+    shm = &queue_shm[queue->shm_index];
+    if (shm->wake_bits == queue->wake_bits && shm->changed_bits == queue->changed_bits &&
+        shm->wake_mask == queue->wake_mask && shm->changed_mask == queue->changed_mask)
+        return;
+
+    interlocked_xchg_add( &shm->seq, 1 );  /* odd, clients have to retry */
+    shm->wake_bits    = queue->wake_bits;
+    shm->changed_bits = queue->changed_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_mask = queue->changed_mask;
+    interlocked_xchg_add( &shm->seq, 1 );
+}
+
+/* allocate the shared memory slot of a queue, return -1 if none is available */
+static int alloc_queue_shm( struct msg_queue *queue )
+{
+    int index;
+
+    if (queue->shm_index != -1) return queue->shm_index;
+    if (!init_queue_shm()) return -1;
+
+    if (queue_shm_free != -1)
+    {
+        index = queue_shm_free;
+        queue_shm_free = queue_shm_next_free[index];
+    }
+    else if (queue_shm_used < QUEUE_SHM_SLOTS) index = queue_shm_used++;
+    else return -1;
+
+    queue->shm_index = index;
+    queue_shm[index].wake_bits = ~queue->wake_bits;  /* force an update */
+    update_queue_shm( queue );
+    return index;
+}
+
+/* free the shared memory slot of a queue */
+static void free_queue_shm( struct msg_queue *queue )
+{
+    if (queue->shm_index == -1) return;
+    queue_shm_next_free[queue->shm_index] = queue_shm_free;
+    queue_shm_free = queue->shm_index;
+    queue->shm_index = -1;
+}
 
 /* create a message queue object */
 static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_input *input )
@@ -298,6 +409,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->shm_index       = -1;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -440,6 +552,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -448,6 +561,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -957,6 +1071,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shm( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -995,6 +1110,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    free_queue_shm( queue );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -2222,6 +2338,24 @@ DECL_HANDLER(get_msg_queue)
 }
 
 
+/* get the shared memory slot publishing the status of the current thread queue */
+DECL_HANDLER(get_queue_shm)
+{
+    struct msg_queue *queue = get_current_queue();
+    int index;
+
+    if (!queue) return;
+    if ((index = alloc_queue_shm( queue )) == -1)
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    reply->handle = alloc_handle_no_access_check( current->process, queue_shm_file, FILE_READ_DATA, 0 );
+    reply->size   = QUEUE_SHM_SLOTS * sizeof(*queue_shm);
+    reply->index  = index;
+}
+
+
 /* set the file descriptor associated to the current thread queue */
 DECL_HANDLER(set_queue_fd)
 {
@@ -2264,6 +2398,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shm( queue );
     }
 }
 
@@ -2277,6 +2412,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2452,6 +2588,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2506,6 +2643,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shm( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
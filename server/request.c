@@ -35,6 +35,9 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 # include <sys/socket.h>
 #endif
@@ -249,8 +252,9 @@ static void send_reply( union generic_reply *reply )
 {
     int ret;
 
-    if (!current->reply_size)
+    if (!current->reply_size || (current->request_shm && current->reply_size <= REQUEST_SHM_SIZE))
     {
+        if (current->reply_size) memcpy( current->request_shm, current->reply_data, current->reply_size );
         if ((ret = write( get_unix_fd( current->reply_fd ),
                           reply, sizeof(*reply) )) != sizeof(*reply)) goto error;
     }
@@ -322,6 +326,22 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* free the variable-size data of the current request of a thread */
+void free_req_data( struct thread *thread )
+{
+    if (thread->req_data != thread->req_buffer) free( thread->req_data );
+    thread->req_data = NULL;
+}
+
+/* free the shared memory used for the data of the requests of a thread */
+void free_request_shm( struct thread *thread )
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (thread->request_shm) munmap( thread->request_shm, REQUEST_SHM_SIZE );
+#endif
+    thread->request_shm = NULL;
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
@@ -329,20 +349,55 @@ void read_request( struct thread *thread )
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
+        struct iovec vec[2];
+
+        /* the client writes the request and its data at once, so try to read everything
+         * with a single call, small data goes directly into the thread buffer */
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_buffer;
+        vec[1].iov_len  = sizeof(thread->req_buffer);
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, 2 )) < (int)sizeof(thread->req))
+            goto error;
+        ret -= sizeof(thread->req);
+
         if (!(thread->req_toread = thread->req.request_header.request_size))
         {
+            if (ret) goto error;
             /* no data, handle request at once */
             call_req_handler( thread );
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        if (ret > thread->req_toread) goto error;
+
+        if (thread->req_toread <= sizeof(thread->req_buffer)) thread->req_data = thread->req_buffer;
+        else if ((thread->req_data = malloc( thread->req_toread )))
+            memcpy( thread->req_data, thread->req_buffer, ret );
+        else
         {
             fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
                                   thread->req_toread, thread->req.request_header.req );
             return;
         }
+
+        if (thread->request_shm && thread->req_toread <= REQUEST_SHM_SIZE)
+        {
+            /* the data has been stored in the shared memory, only the header went through the pipe */
+            if (ret) goto error;
+            memcpy( thread->req_data, thread->request_shm, thread->req_toread );
+            thread->req_toread = 0;
+            call_req_handler( thread );
+            free_req_data( thread );
+            return;
+        }
+
+        if (!(thread->req_toread -= ret))
+        {
+            call_req_handler( thread );
+            free_req_data( thread );
+            return;
+        }
     }
 
     /* read the variable sized data */
@@ -356,8 +411,7 @@ void read_request( struct thread *thread )
         if (!(thread->req_toread -= ret))
         {
             call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            free_req_data( thread );
             return;
         }
     }
@@ -371,6 +425,138 @@ error:
         fatal_protocol_error( thread, "read: %s\n", strerror( errno ));
 }
 
+/* passing data through shared memory is only enabled on request */
+static int request_shm_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINESERVERSHM" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
+/* create the shared memory used to pass the data of the requests of the current thread */
+DECL_HANDLER(get_request_shm)
+{
+#ifdef HAVE_SYS_MMAN_H
+    void *ptr;
+    int fd;
+
+    if (!request_shm_enabled() || current->request_shm)
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    if ((fd = create_temp_file( REQUEST_SHM_SIZE )) == -1) return;
+
+    ptr = mmap( NULL, REQUEST_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr != MAP_FAILED)
+    {
+        send_client_fd( current->process, fd, 0 );
+        /* the reply of this request is still sent through the pipe */
+        current->request_shm = ptr;
+        reply->size = REQUEST_SHM_SIZE;
+    }
+    else file_set_error();
+    close( fd );
+#else
+    set_error( STATUS_NOT_IMPLEMENTED );
+#endif
+}
+
+/* execute several independent requests at once, to save round trips */
+DECL_HANDLER(batch)
+{
+    union generic_request batch_req = current->req;
+    const char *ptr, *end;
+    char *data, *replies, *out;
+    data_size_t size = get_req_data_size(), total = 0;
+
+    /* take over the request data, since the sub-requests replace it */
+    if (current->req_data != current->req_buffer) data = current->req_data;
+    else if (!(data = memdup( current->req_buffer, size ))) return;
+    current->req_data = NULL;
+    end = data + size;
+
+    /* validate the requests and compute the maximum size of the replies */
+    for (ptr = data; ptr < end; )
+    {
+        struct request_header header;
+
+        if (end - ptr < sizeof(union generic_request)) break;
+        memcpy( &header, ptr, sizeof(header) );
+        ptr += sizeof(union generic_request);
+        if (header.request_size > end - ptr) break;
+        ptr += header.request_size;
+        total += sizeof(union generic_reply) + header.reply_size;
+    }
+    if (ptr != end || total > get_reply_max_size())
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        free( data );
+        return;
+    }
+    if (!(replies = out = mem_alloc( total )))
+    {
+        free( data );
+        return;
+    }
+
+    for (ptr = data; ptr < end; )
+    {
+        union generic_reply reply;
+        enum request req;
+
+        memcpy( &current->req, ptr, sizeof(current->req) );
+        ptr += sizeof(current->req);
+        req = current->req.request_header.req;
+        size = current->req.request_header.request_size;
+
+        current->reply_size = 0;
+        clear_error();
+        memset( &reply, 0, sizeof(reply) );
+
+        if (size <= sizeof(current->req_buffer)) current->req_data = memcpy( current->req_buffer, ptr, size );
+        else current->req_data = memdup( ptr, size );
+        ptr += size;
+
+        if (debug_level) trace_request();
+
+        if (size && !current->req_data) set_error( STATUS_NO_MEMORY );
+        else if (req < REQ_NB_REQUESTS && req != REQ_batch && req != REQ_select)
+            req_handlers[req]( &current->req, &reply );
+        else
+            set_error( STATUS_NOT_IMPLEMENTED );
+
+        if (!current) break;  /* the thread has been killed */
+
+        reply.reply_header.error = current->error;
+        reply.reply_header.reply_size = current->reply_size;
+        if (debug_level) trace_reply( req, &reply );
+        memcpy( out, &reply, sizeof(reply) );
+        out += sizeof(reply);
+        if (current->reply_size) memcpy( out, current->reply_data, current->reply_size );
+        out += current->reply_size;
+        free( current->reply_data );
+        current->reply_data = NULL;
+        free_req_data( current );
+    }
+    free( data );
+
+    if (!current)
+    {
+        free( replies );
+        return;
+    }
+    current->req = batch_req;
+    current->reply_size = 0;
+    clear_error();
+    set_reply_data_ptr( replies, out - replies );
+}
+
 /* receive a file descriptor on the process socket */
 int receive_fd( struct process *process )
 {
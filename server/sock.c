@@ -22,6 +22,7 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <assert.h>
 #include <fcntl.h>
@@ -35,6 +36,10 @@
 #endif
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 # include <sys/socket.h>
 #endif
@@ -102,6 +107,7 @@ struct sock
     unsigned int        pmask;       /* pending events */
     unsigned int        flags;       /* socket flags */
     int                 polling;     /* is socket being polled? */
+    int                 shm_index;   /* index of the shared memory slot, -1 if none */
     unsigned short      proto;       /* socket protocol */
     unsigned short      type;        /* socket type */
     unsigned short      family;      /* socket family */
@@ -251,6 +257,136 @@ void sock_init(void)
     }
 }
 
+#define SOCKET_SHM_SLOTS  16384
+
+static struct socket_shm *socket_shm;                 /* shared memory slots */
+static struct file *socket_shm_file;                  /* file object of the shared memory */
+static unsigned int socket_shm_used;                  /* number of slots used so far */
+static int socket_shm_free = -1;                      /* head of the free slots list */
+static int socket_shm_next_free[SOCKET_SHM_SLOTS];    /* free slots list */
+
+/* publishing the socket state in shared memory can be disabled with WINESOCKETSHM=0 */
+static int socket_shm_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+#ifdef HAVE_SYS_MMAN_H
+        const char *env = getenv( "WINESOCKETSHM" );
+        enabled = !env || atoi( env );
+#else
+        enabled = 0;
+#endif
+    }
+    return enabled;
+}
+
+/* create the shared memory on first use */
+static int init_socket_shm(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    static int failed;
+    void *ptr;
+    int fd;
+
+    if (socket_shm) return 1;
+    if (failed || !socket_shm_enabled()) return 0;
+    failed = 1;
+
+    if ((fd = create_temp_file( SOCKET_SHM_SLOTS * sizeof(*socket_shm) )) == -1) return 0;
+    ptr = mmap( NULL, SOCKET_SHM_SLOTS * sizeof(*socket_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        fprintf( stderr, "wineserver: cannot map socket shared memory, disabling it\n" );
+        close( fd );
+        return 0;
+    }
+    if (!(socket_shm_file = create_file_for_fd( fd, FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE )))
+    {
+        munmap( ptr, SOCKET_SHM_SLOTS * sizeof(*socket_shm) );
+        return 0;
+    }
+    make_object_static( (struct object *)socket_shm_file );
+    socket_shm = ptr;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* publish the current state of a socket in its shared memory slot */
+static void update_socket_shm( struct sock *sock )
+{
+    struct socket_shm *shm;
+    unsigned int events;
+
+    if (sock->shm_index == -1) return;
+    shm = &socket_shm[sock->shm_index];
+
+    /* re-enabling an event changes nothing unless it is pending or held, as long as the
+     * socket is polled; before that the reselect in enable_socket_event may start polling */
+    events = sock->polling ? (sock->pmask | sock->hmask) : ~0u;
+    if (shm->state == sock->state && shm->events == events) return;
+
+    interlocked_xchg_add( &shm->seq, 1 );  /* odd, clients have to retry */
+    shm->state  = sock->state;
+    shm->events = events;
+    interlocked_xchg_add( &shm->seq, 1 );
+}
+
+/* publish the inode of the unix socket, clients use it to check which socket a handle refers to */
+static void update_socket_shm_ino( struct sock *sock )
+{
+    struct socket_shm *shm;
+    struct stat st;
+
+    if (sock->shm_index == -1) return;
+    shm = &socket_shm[sock->shm_index];
+
+    interlocked_xchg_add( &shm->seq, 1 );
+    shm->ino = fstat( get_unix_fd( sock->fd ), &st ) ? 0 : st.st_ino;
+    interlocked_xchg_add( &shm->seq, 1 );
+}
+
+/* allocate the shared memory slot of a socket, return -1 if none is available */
+static int alloc_socket_shm( struct sock *sock )
+{
+    int index;
+
+    if (sock->shm_index != -1) return sock->shm_index;
+    if (!init_socket_shm()) return -1;
+
+    if (socket_shm_free != -1)
+    {
+        index = socket_shm_free;
+        socket_shm_free = socket_shm_next_free[index];
+    }
+    else if (socket_shm_used < SOCKET_SHM_SLOTS) index = socket_shm_used++;
+    else return -1;
+
+    sock->shm_index = index;
+    socket_shm[index].state = ~sock->state;  /* force an update */
+    update_socket_shm( sock );
+    update_socket_shm_ino( sock );
+    return index;
+}
+
+/* free the shared memory slot of a socket */
+static void free_socket_shm( struct sock *sock )
+{
+    struct socket_shm *shm;
+
+    if (sock->shm_index == -1) return;
+    shm = &socket_shm[sock->shm_index];
+    interlocked_xchg_add( &shm->seq, 1 );
+    shm->ino = 0;
+    interlocked_xchg_add( &shm->seq, 1 );
+    socket_shm_next_free[sock->shm_index] = socket_shm_free;
+    socket_shm_free = sock->shm_index;
+    sock->shm_index = -1;
+}
+
 static int sock_reselect( struct sock *sock )
 {
     int ev = sock_get_poll_events( sock->fd );
@@ -261,13 +397,18 @@ static int sock_reselect( struct sock *sock )
     if (!sock->polling)  /* FIXME: should find a better way to do this */
     {
         /* previously unconnected socket, is this reselect supposed to connect it? */
-        if (!(sock->state & ~FD_WINE_NONBLOCKING)) return 0;
+        if (!(sock->state & ~FD_WINE_NONBLOCKING))
+        {
+            update_socket_shm( sock );
+            return 0;
+        }
         /* ok, it is, attach it to the wineserver's main poll loop */
         sock->polling = 1;
         allow_fd_caching( sock->fd );
     }
     /* update condition mask */
     set_fd_events( sock->fd, ev );
+    update_socket_shm( sock );
     return ev;
 }
 
@@ -623,6 +764,7 @@ static void sock_destroy( struct object *obj )
     free_async_queue( &sock->write_q );
     free_async_queue( &sock->ifchange_q );
     if (sock->event) release_object( sock->event );
+    free_socket_shm( sock );
     if (sock->fd)
     {
         /* shut the socket down to force pending poll() calls in the client to return */
@@ -638,6 +780,7 @@ static void init_sock(struct sock *sock)
     sock->hmask   = 0;
     sock->pmask   = 0;
     sock->polling = 0;
+    sock->shm_index = -1;
     sock->flags   = 0;
     sock->type    = 0;
     sock->family  = 0;
@@ -787,6 +930,8 @@ static int accept_into_socket( struct sock *sock, struct sock *acceptsock )
 
         set_fd_user( newfd, &sock_fd_ops, &acceptsock->obj );
 
+        /* the unix socket now belongs to acceptsock */
+        free_socket_shm( sock->deferred );
         release_object( sock->deferred );
         sock->deferred = NULL;
     }
@@ -813,6 +958,7 @@ static int accept_into_socket( struct sock *sock, struct sock *acceptsock )
     fd_copy_completion( acceptsock->fd, newfd );
     release_object( acceptsock->fd );
     acceptsock->fd = newfd;
+    update_socket_shm_ino( acceptsock );
 
     clear_error();
     sock->pmask &= ~FD_ACCEPT;
@@ -1250,6 +1396,7 @@ DECL_HANDLER(set_socket_event)
     sock_reselect( sock );
 
     sock->state |= FD_WINE_NONBLOCKING;
+    update_socket_shm( sock );
 
     /* if a network event is pending, signal the event object
        it is possible that FD_CONNECT or FD_ACCEPT network events has happened
@@ -1324,6 +1471,28 @@ DECL_HANDLER(enable_socket_event)
     release_object( &sock->obj );
 }
 
+/* get the shared memory slot publishing the state of a socket */
+DECL_HANDLER(get_socket_shm)
+{
+    struct sock *sock;
+    int index;
+
+    if (!(sock = (struct sock *)get_handle_obj( current->process, req->handle,
+                                                FILE_READ_ATTRIBUTES, &sock_ops )))
+        return;
+
+    if ((index = alloc_socket_shm( sock )) == -1)
+        set_error( STATUS_NOT_IMPLEMENTED );
+    else
+    {
+        reply->shm_handle = alloc_handle_no_access_check( current->process, socket_shm_file,
+                                                          FILE_READ_DATA, 0 );
+        reply->size       = SOCKET_SHM_SLOTS * sizeof(*socket_shm);
+        reply->index      = index;
+    }
+    release_object( &sock->obj );
+}
+
 DECL_HANDLER(set_socket_deferred)
 {
     struct sock *sock, *acceptsock;
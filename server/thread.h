@@ -45,6 +45,7 @@ struct inflight_fd
     int server;  /* fd on the server side */
 };
 #define MAX_INFLIGHT_FDS 16  /* max number of fds in flight per thread */
+#define REQ_BUFFER_SIZE  1024  /* size of the buffer for small request data */
 
 struct thread
 {
@@ -66,10 +67,12 @@ struct thread
     unsigned int           error;         /* current error code */
     union generic_request  req;           /* current request */
     void                  *req_data;      /* variable-size data for request */
+    char                   req_buffer[REQ_BUFFER_SIZE];  /* storage for small request data */
     unsigned int           req_toread;    /* amount of data still to read in request */
     void                  *reply_data;    /* variable-size data for reply */
     unsigned int           reply_size;    /* size of reply data */
     unsigned int           reply_towrite; /* amount of data still to write in reply */
+    void                  *request_shm;   /* shared memory for request and reply data */
     struct fd             *request_fd;    /* fd for receiving client requests */
     struct fd             *reply_fd;      /* fd to send a reply to a client */
     struct fd             *wait_fd;       /* fd to use to wake a sleeping client */